@@ -599,7 +599,7 @@ void CCatchScreenDlg::UpdateMousePointRGBString()
 	BYTE rValue, gValue, bValue;
 	rValue = GetRValue(color);
 	gValue = GetGValue(color);
-	bValue = GetGValue(color);
+	bValue = GetBValue(color);
 
 	//ʽŷַ
 	CString string;
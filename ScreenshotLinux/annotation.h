@@ -0,0 +1,33 @@
+#ifndef ANNOTATION_H
+#define ANNOTATION_H
+
+#include <QColor>
+#include <QList>
+#include <QPoint>
+#include <QRect>
+#include <QString>
+#include <QVector>
+
+// 标注数据模型：与窗口无关，遮罩窗口、合成导出和基准测试共用
+
+enum class DrawMode {
+    None,
+    Rectangle,
+    Circle,
+    Arrow,
+    Text,
+    Brush,
+    Mosaic
+};
+
+struct DrawItem {
+    DrawMode mode;
+    QRect rect;
+    QPoint start;
+    QPoint end;
+    QString text;
+    QColor color;
+    QVector<QPoint> brushPoints; // 存储画笔路径上的点
+};
+
+#endif // ANNOTATION_H
@@ -0,0 +1,104 @@
+#include "annotationrenderer.h"
+#include "imageops.h"
+#include "trace.h"
+#include <QLineF>
+#include <QPolygonF>
+#include <QtMath>
+#include <cmath>
+
+namespace AnnotationRenderer {
+
+void render(QPainter &painter, const QList<DrawItem> &items, const TiledImage &source, const QTransform &toSource)
+{
+    for (const DrawItem &item : items) {
+        switch (item.mode) {
+            case DrawMode::Rectangle: {
+                painter.setPen(QPen(Qt::red, 2));
+                painter.drawRect(item.rect);
+                break;
+            }
+            case DrawMode::Circle: {
+                painter.setPen(QPen(Qt::red, 2));
+                painter.drawEllipse(item.rect);
+                break;
+            }
+            case DrawMode::Arrow: {
+                // 绘制箭头
+                painter.setPen(QPen(Qt::red, 2));
+                painter.drawLine(item.start, item.end);
+                
+                // 计算箭头角度
+                QLineF line(item.end, item.start);
+                double angle = std::atan2(-line.dy(), line.dx());
+                
+                // 绘制箭头头部
+                QPointF arrowP1 = item.end + QPointF(sin(angle + M_PI / 3) * 10,
+                                              cos(angle + M_PI / 3) * 10);
+                QPointF arrowP2 = item.end + QPointF(sin(angle + M_PI - M_PI / 3) * 10,
+                                              cos(angle + M_PI - M_PI / 3) * 10);
+                
+                QPolygonF arrowHead;
+                arrowHead << item.end << arrowP1 << arrowP2;
+                painter.setBrush(Qt::red);
+                painter.drawPolygon(arrowHead);
+                break;
+            }
+            case DrawMode::Text: {
+                painter.setPen(QPen(Qt::red, 2));
+                QFont font = painter.font();
+                font.setPointSize(12);
+                painter.setFont(font);
+                painter.drawText(item.rect.topLeft(), item.text);
+                break;
+            }
+            case DrawMode::Brush: {
+                painter.setPen(QPen(Qt::red, 3, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+                if (item.brushPoints.size() > 1) {
+                    for (int i = 1; i < item.brushPoints.size(); ++i) {
+                        painter.drawLine(item.brushPoints[i-1], item.brushPoints[i]);
+                    }
+                }
+                break;
+            }
+            case DrawMode::Mosaic: {
+                // 马赛克效果实现：直接在原始截图上按块求平均色，不复制区域；
+                // 按截图像素计算，块大小随之缩放，再画回画布坐标
+                int blockSize = qMax(1, qRound(10 * toSource.m11())); // 马赛克块大小
+                QRect rect = toSource.mapRect(item.rect.normalized()).intersected(source.rect());
+                if (!rect.isEmpty()) {
+                    painter.drawImage(toSource.inverted().mapRect(QRectF(rect)), ImageOps::mosaic(source, rect, blockSize));
+                }
+                break;
+            }
+            case DrawMode::None:
+                break;
+        }
+    }
+}
+
+QImage compose(const TiledImage &source, const QRect &rect, const QList<DrawItem> &items, const QTransform &toSource)
+{
+    TRACE_SCOPE("export.compose");
+    // 导出截图像素，不缩放到画布大小
+    const QRect sourceRect = toSource.mapRect(rect);
+    // 没有标注时直接导出截图帧的视图，不复制像素
+    if (items.isEmpty()) {
+        return source.view(sourceRect);
+    }
+    QImage selectedImage = source.copy(sourceRect);
+    
+    // 将绘制的项目应用到截图上
+    QPainter painter(&selectedImage);
+    painter.setRenderHint(QPainter::Antialiasing);
+    
+    // 相对于选择区域调整绘制位置，标注按画布坐标保存，先换算到截图像素
+    painter.translate(-sourceRect.topLeft());
+    painter.setTransform(toSource, true);
+    
+    render(painter, items, source, toSource);
+    painter.end();
+    
+    return selectedImage;
+}
+
+} // namespace AnnotationRenderer
@@ -0,0 +1,27 @@
+#ifndef ANNOTATIONRENDERER_H
+#define ANNOTATIONRENDERER_H
+
+#include "annotation.h"
+#include "tiledimage.h"
+#include <QImage>
+#include <QList>
+#include <QPainter>
+#include <QRect>
+#include <QTransform>
+
+// 标注光栅化：只依赖QtGui，可以画到窗口、QImage或任何QPaintDevice上
+namespace AnnotationRenderer {
+
+// 按画布坐标把标注画到painter上，source是截图原始像素，供马赛克取样；
+// toSource把画布坐标换算到source的像素（截图按设备像素保存时不是恒等变换）
+void render(QPainter &painter, const QList<DrawItem> &items, const TiledImage &source,
+            const QTransform &toSource = QTransform());
+
+// 从source中裁出画布坐标的rect并叠加落在其中的标注，得到导出用的最终图像，保持source的分辨率；
+// 没有标注时返回截图帧的只读视图
+QImage compose(const TiledImage &source, const QRect &rect, const QList<DrawItem> &items,
+               const QTransform &toSource = QTransform());
+
+} // namespace AnnotationRenderer
+
+#endif // ANNOTATIONRENDERER_H
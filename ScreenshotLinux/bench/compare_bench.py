@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+"""比较两次 ScreenshotBench 的 XML 结果（ScreenshotBench -o results.xml,xml）。
+
+用法: compare_bench.py base.xml new.xml [--threshold 0.05]
+输出每个基准的耗时变化，超过阈值的变慢项以非零退出码返回，便于在提交之间比较。
+"""
+import argparse
+import sys
+import xml.etree.ElementTree as ET
+
+
+def load(path):
+    results = {}
+    root = ET.parse(path).getroot()
+    for function in root.iter("TestFunction"):
+        for result in function.iter("BenchmarkResult"):
+            key = "%s(%s)" % (function.get("name"), result.get("tag", ""))
+            value = float(result.get("value"))
+            iterations = max(1, int(result.get("iterations", "1")))
+            # QtTest 的 value 是所有迭代的总和
+            results[key] = (value / iterations, result.get("metric"))
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("base")
+    parser.add_argument("new")
+    parser.add_argument("--threshold", type=float, default=0.05)
+    args = parser.parse_args()
+
+    base = load(args.base)
+    new = load(args.new)
+    regressions = 0
+    for key in sorted(set(base) | set(new)):
+        if key not in base or key not in new:
+            print("%-60s %s" % (key, "仅在新结果中" if key in new else "仅在基准结果中"))
+            continue
+        old_value, metric = base[key]
+        new_value, _ = new[key]
+        change = (new_value - old_value) / old_value if old_value else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  <-- 变慢"
+            regressions += 1
+        print("%-60s %12.4f -> %12.4f %s  %+6.1f%%%s" % (key, old_value, new_value, metric, change * 100, flag))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,634 @@
+// 截图工具性能基准：截图拼接、遮罩绘制、马赛克、合成、编码、分块哈希、GIF帧编码、截图比较、空闲占用
+// 无界面运行（默认使用offscreen平台插件），结果用QtTest输出，例如：
+//   ScreenshotBench -o results.xml,xml
+//   python3 bench/compare_bench.py old.xml results.xml
+#include "screenshotwindow.h"
+#include "imageops.h"
+#include "annotationrenderer.h"
+#include "imageencoder.h"
+#include "edgemap.h"
+#include "captureframe.h"
+#include "processstats.h"
+#include "tilehash.h"
+#include "gifencoder.h"
+#include "scrollstitcher.h"
+#include "historystore.h"
+#include "contentstore.h"
+#include "imagediff.h"
+#include "syntheticcapture.h"
+#include <QApplication>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QtTest>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+struct CaptureLayout {
+    const char *name;
+    QSize screenSize;
+    int screenCount; // 横向排列的屏幕数量
+};
+
+const CaptureLayout kLayouts[] = {
+    { "1080p", QSize(1920, 1080), 1 },
+    { "4K", QSize(3840, 2160), 1 },
+    { "3x4K", QSize(3840, 2160), 3 },
+};
+
+QImage syntheticCapture(const CaptureLayout &layout)
+{
+    QImage capture(layout.screenSize.width() * layout.screenCount, layout.screenSize.height(),
+                   QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&capture);
+    for (int i = 0; i < layout.screenCount; ++i) {
+        painter.drawImage(i * layout.screenSize.width(), 0, syntheticScreen(layout.screenSize, 1000 + i));
+    }
+    painter.end();
+    return capture;
+}
+
+// 选区居中，占截图的一半
+QRect selectionArea(const QImage &capture)
+{
+    return QRect(QPoint(capture.width() / 4, capture.height() / 4),
+                 QPoint(capture.width() * 3 / 4, capture.height() * 3 / 4));
+}
+
+// 各类标注轮流出现，落在area内
+QList<DrawItem> syntheticAnnotations(const QRect &area, int count)
+{
+    QList<DrawItem> items;
+    QRandomGenerator random(42);
+    for (int i = 0; i < count; ++i) {
+        DrawItem item;
+        item.color = Qt::red;
+        const QPoint p1(area.left() + random.bounded(area.width() - 200),
+                        area.top() + random.bounded(area.height() - 200));
+        const QPoint p2 = p1 + QPoint(20 + random.bounded(180), 20 + random.bounded(180));
+        switch (i % 6) {
+            case 0: item.mode = DrawMode::Rectangle; item.rect = QRect(p1, p2); break;
+            case 1: item.mode = DrawMode::Circle; item.rect = QRect(p1, p2); break;
+            case 2: item.mode = DrawMode::Arrow; item.start = p1; item.end = p2; break;
+            case 3: item.mode = DrawMode::Text; item.rect = QRect(p1, p1); item.text = "标注文字"; break;
+            case 4:
+                item.mode = DrawMode::Brush;
+                for (int k = 0; k < 50; ++k) {
+                    item.brushPoints.append(p1 + QPoint(k * 3, int(20 * std::sin(k * 0.3))));
+                }
+                break;
+            default: item.mode = DrawMode::Mosaic; item.rect = QRect(p1, p2); break;
+        }
+        items.append(item);
+    }
+    return items;
+}
+
+} // namespace
+
+class ScreenshotBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void captureCombine_data();
+    void captureCombine();
+
+    void overlayPaint_data();
+    void overlayPaint();
+
+    void mosaic_data();
+    void mosaic();
+
+    void compose_data();
+    void compose();
+
+    void encode_data();
+    void encode();
+
+    void edgeMap_data();
+    void edgeMap();
+
+    void tileHash_data();
+    void tileHash();
+
+    void gifFrame_data();
+    void gifFrame();
+
+    void scrollStitch_data();
+    void scrollStitch();
+
+    void thumbnail_data();
+    void thumbnail();
+
+    void contentHash_data();
+    void contentHash();
+
+    void imageDiff_data();
+    void imageDiff();
+
+    void idleFootprint();
+
+private:
+    void addLayoutAnnotationRows();
+    void loadWindow(ScreenshotWindow &window, const QImage &capture, int annotations);
+
+    QHash<QString, QImage> m_captures;
+};
+
+void ScreenshotBench::initTestCase()
+{
+    for (const CaptureLayout &layout : kLayouts) {
+        m_captures.insert(layout.name, syntheticCapture(layout));
+    }
+}
+
+void ScreenshotBench::addLayoutAnnotationRows()
+{
+    QTest::addColumn<QString>("layout");
+    QTest::addColumn<int>("annotations");
+    for (const CaptureLayout &layout : kLayouts) {
+        for (int annotations : { 0, 10, 100, 1000 }) {
+            QTest::addRow("%s/%d", layout.name, annotations) << QString(layout.name) << annotations;
+        }
+    }
+}
+
+void ScreenshotBench::loadWindow(ScreenshotWindow &window, const QImage &capture, int annotations)
+{
+    window.m_screenImage = TiledImage::fromImage(capture);
+    window.m_isScreenshotMode = true;
+    window.m_hasSelected = true;
+    window.resize(capture.size());
+    window.m_selection.setBounds(capture.rect());
+    window.m_selection.setRect(selectionArea(capture));
+    window.m_drawItems = syntheticAnnotations(window.selectedRect(), annotations);
+}
+
+void ScreenshotBench::captureCombine_data()
+{
+    QTest::addColumn<QString>("layout");
+    QTest::addColumn<bool>("tiled");
+    for (const CaptureLayout &layout : kLayouts) {
+        for (bool tiled : { false, true }) {
+            QTest::addRow("%s/%s", layout.name, tiled ? "tiled" : "flat") << QString(layout.name) << tiled;
+        }
+    }
+}
+
+void ScreenshotBench::captureCombine()
+{
+    // flat是原来的做法：逐屏抓取的QPixmap画到一张透明填充的大图；
+    // tiled与ScreenCapture::grabDesktop()的Qt原生路径相同：逐屏复制到分块图像
+    QFETCH(QString, layout);
+    QFETCH(bool, tiled);
+    const CaptureLayout *info = nullptr;
+    for (const CaptureLayout &candidate : kLayouts) {
+        if (layout == candidate.name) {
+            info = &candidate;
+        }
+    }
+    QVERIFY(info);
+
+    QList<QImage> screens;
+    for (int i = 0; i < info->screenCount; ++i) {
+        screens << syntheticScreen(info->screenSize, 1000 + i);
+    }
+
+    const QSize canvasSize(info->screenSize.width() * info->screenCount, info->screenSize.height());
+    if (tiled) {
+        TiledImage combined;
+        QBENCHMARK {
+            CaptureFrame::resetBytesCopied();
+            combined = TiledImage(canvasSize);
+            for (int i = 0; i < screens.size(); ++i) {
+                combined.paste(QPoint(i * info->screenSize.width(), 0), screens.at(i));
+            }
+        }
+        // 完整落在一屏内的块只是视图，复制的只有跨屏和边缘的块
+        qInfo("%s: %d tiles, %lld bytes, %lld bytes copied", qPrintable(layout), combined.allocatedTiles(),
+              combined.allocatedBytes(), CaptureFrame::bytesCopied());
+        return;
+    }
+
+    QBENCHMARK {
+        QImage combined(canvasSize, QImage::Format_ARGB32_Premultiplied);
+        combined.fill(Qt::transparent);
+        QPainter painter(&combined);
+        for (int i = 0; i < screens.size(); ++i) {
+            painter.drawPixmap(i * info->screenSize.width(), 0, QPixmap::fromImage(screens.at(i)));
+        }
+        painter.end();
+    }
+}
+
+void ScreenshotBench::overlayPaint_data()
+{
+    addLayoutAnnotationRows();
+}
+
+void ScreenshotBench::overlayPaint()
+{
+    QFETCH(QString, layout);
+    QFETCH(int, annotations);
+
+    ScreenshotWindow window;
+    loadWindow(window, m_captures.value(layout), annotations);
+    QImage frame(window.size(), QImage::Format_ARGB32_Premultiplied);
+
+    // render() 走完整的paintEvent，但不需要真实显示窗口
+    QBENCHMARK {
+        window.render(&frame);
+    }
+}
+
+void ScreenshotBench::mosaic_data()
+{
+    QTest::addColumn<QString>("variant");
+    QTest::addColumn<QSize>("regionSize");
+    QTest::addColumn<int>("blockSize");
+    for (const char *variant : { "fast", "reference", "tiled" }) {
+        for (const QSize &size : { QSize(200, 200), QSize(1000, 600) }) {
+            for (int blockSize : { 4, 10, 32 }) {
+                QTest::addRow("%s/%dx%d/%d", variant, size.width(), size.height(), blockSize)
+                    << QString(variant) << size << blockSize;
+            }
+        }
+    }
+}
+
+void ScreenshotBench::mosaic()
+{
+    QFETCH(QString, variant);
+    QFETCH(QSize, regionSize);
+    QFETCH(int, blockSize);
+
+    const QImage &capture = m_captures.value("1080p");
+    const TiledImage tiles = TiledImage::fromImage(capture);
+    const QRect rect(QPoint(100, 100), regionSize);
+    QBENCHMARK {
+        const QImage result = variant == QLatin1String("reference") ? ImageOps::mosaicReference(capture, rect, blockSize)
+                            : variant == QLatin1String("tiled")     ? ImageOps::mosaic(tiles, rect, blockSize)
+                                                                    : ImageOps::mosaic(capture, rect, blockSize);
+        Q_UNUSED(result);
+    }
+
+    // 直接按扫描行和按块读取的两个实现都必须与参考实现逐像素一致
+    const QImage expected = ImageOps::mosaicReference(capture, rect, blockSize);
+    QCOMPARE(ImageOps::mosaic(capture, rect, blockSize), expected);
+    QCOMPARE(ImageOps::mosaic(tiles, rect, blockSize), expected);
+}
+
+void ScreenshotBench::compose_data()
+{
+    addLayoutAnnotationRows();
+}
+
+void ScreenshotBench::compose()
+{
+    QFETCH(QString, layout);
+    QFETCH(int, annotations);
+
+    // 合成只用到核心库，不需要创建窗口
+    const QImage &capture = m_captures.value(layout);
+    const TiledImage tiles = TiledImage::fromImage(capture);
+    const QRect area = selectionArea(capture);
+    const QList<DrawItem> items = syntheticAnnotations(area, annotations);
+    QBENCHMARK {
+        const QImage result = AnnotationRenderer::compose(tiles, area, items);
+        Q_UNUSED(result);
+    }
+}
+
+void ScreenshotBench::encode_data()
+{
+    QTest::addColumn<QString>("layout");
+    QTest::addColumn<int>("profile");
+    const struct { const char *name; ImageEncoder::Profile profile; } profiles[] = {
+        { "png-fast", ImageEncoder::Profile::PngFast },
+        { "png-small", ImageEncoder::Profile::PngSmall },
+        { "jpeg", ImageEncoder::Profile::Jpeg },
+        { "bmp", ImageEncoder::Profile::Bmp },
+    };
+    for (const CaptureLayout &layout : kLayouts) {
+        for (const auto &entry : profiles) {
+            QTest::addRow("%s/%s", layout.name, entry.name) << QString(layout.name) << int(entry.profile);
+        }
+    }
+}
+
+void ScreenshotBench::encode()
+{
+    QFETCH(QString, layout);
+    QFETCH(int, profile);
+
+    const QImage &capture = m_captures.value(layout);
+    QByteArray bytes;
+    QBENCHMARK {
+        bytes = ImageEncoder::encode(capture, ImageEncoder::Profile(profile));
+    }
+    QVERIFY(!bytes.isEmpty());
+}
+
+void ScreenshotBench::edgeMap_data()
+{
+    QTest::addColumn<QString>("layout");
+    QTest::addColumn<int>("threads");
+    for (const CaptureLayout &layout : kLayouts) {
+        for (int threads : { 1, 0 }) {
+            QTest::addRow("%s/%s", layout.name, threads == 1 ? "single" : "all")
+                << QString(layout.name) << threads;
+        }
+    }
+}
+
+void ScreenshotBench::edgeMap()
+{
+    QFETCH(QString, layout);
+    QFETCH(int, threads);
+
+    const QImage &capture = m_captures.value(layout);
+    const TiledImage tiles = TiledImage::fromImage(capture);
+    EdgeMap map;
+    QBENCHMARK {
+        map = EdgeMap::build(tiles, threads);
+    }
+    QCOMPARE(map.width(), capture.width());
+
+    // 合成截图里的色块边缘应该能被吸附到
+    const QRect area = selectionArea(capture);
+    int distance = 0;
+    int snapped = 0;
+    for (int x = area.left(); x < area.right(); x += 4) {
+        map.snap(x, Qt::Horizontal, area.top(), area.top() + 40, 4, &distance);
+        snapped += distance != INT_MAX;
+    }
+    QVERIFY(snapped > 0);
+}
+
+void ScreenshotBench::tileHash_data()
+{
+    QTest::addColumn<QString>("layout");
+    for (const CaptureLayout &layout : kLayouts) {
+        QTest::newRow(layout.name) << QString(layout.name);
+    }
+}
+
+void ScreenshotBench::tileHash()
+{
+    // 定时截图每帧的变化检测：整帧分块哈希并与上一帧比较
+    QFETCH(QString, layout);
+
+    const QImage &capture = m_captures.value(layout);
+    const TileHashes previous = TileHashes::compute(capture);
+    QVector<int> changed;
+    QBENCHMARK {
+        changed = TileHashes::compute(capture).changedTiles(previous);
+    }
+    QVERIFY(changed.isEmpty());
+
+    // 改动一个像素只影响它所在的块
+    QImage modified = capture.copy();
+    const QPoint point(capture.width() / 2, capture.height() / 2);
+    modified.setPixel(point, modified.pixel(point) ^ 0x00ffffff);
+    changed = TileHashes::compute(modified).changedTiles(previous);
+    QCOMPARE(changed.size(), 1);
+    QVERIFY(previous.tileRect(changed.first()).contains(point));
+}
+
+void ScreenshotBench::gifFrame_data()
+{
+    QTest::addColumn<QString>("layout");
+    QTest::addColumn<bool>("delta");
+    for (const CaptureLayout &layout : kLayouts) {
+        if (layout.screenCount > 1) {
+            continue; // 录制的是选区，不会有3x4K的帧
+        }
+        QTest::addRow("%s/full", layout.name) << QString(layout.name) << false;
+        QTest::addRow("%s/delta", layout.name) << QString(layout.name) << true;
+    }
+}
+
+void ScreenshotBench::gifFrame()
+{
+    // 录制时每帧的编码：整帧量化+LZW，或与上一帧相比只有一小块变化（光标、输入框）
+    QFETCH(QString, layout);
+    QFETCH(bool, delta);
+
+    const QImage capture = m_captures.value(layout).convertToFormat(QImage::Format_RGB32);
+    QImage frame = capture;
+    if (delta) {
+        QPainter painter(&frame);
+        painter.fillRect(QRect(selectionArea(capture).topLeft(), QSize(200, 40)), Qt::white);
+    }
+    const QImage previous = delta ? capture : QImage();
+    GifEncoder::Frame encoded;
+    QBENCHMARK {
+        encoded = GifEncoder::encodeFrame(frame, previous);
+    }
+    QVERIFY(!encoded.data.isEmpty());
+    QCOMPARE(encoded.transparent, delta);
+    if (delta) {
+        QVERIFY(encoded.data.size() < capture.width() * capture.height() / 100);
+    }
+}
+
+void ScreenshotBench::scrollStitch_data()
+{
+    QTest::addColumn<QString>("layout");
+    QTest::addColumn<int>("scroll");
+    for (const CaptureLayout &layout : kLayouts) {
+        if (layout.screenCount > 1) {
+            continue; // 长截图的是选区，不会有3x4K的帧
+        }
+        QTest::addRow("%s/40", layout.name) << QString(layout.name) << 40;
+        QTest::addRow("%s/300", layout.name) << QString(layout.name) << 300;
+    }
+}
+
+void ScreenshotBench::scrollStitch()
+{
+    // 长截图的拼接：每帧行哈希、对齐并追加新露出的行，从头拼出一整页
+    QFETCH(QString, layout);
+    QFETCH(int, scroll);
+
+    // 页面由截图竖向重复4次组成，每行开头写入行号，保证没有两行完全相同
+    const QImage &capture = m_captures.value(layout);
+    QImage page(capture.width(), capture.height() * 4, QImage::Format_RGB32);
+    {
+        QPainter painter(&page);
+        for (int i = 0; i < 4; ++i) {
+            painter.drawImage(0, i * capture.height(), capture);
+        }
+    }
+    for (int y = 0; y < page.height(); ++y) {
+        reinterpret_cast<QRgb *>(page.scanLine(y))[0] = qRgb(y & 0xff, (y >> 8) & 0xff, 0);
+    }
+    const int frameHeight = capture.height() / 2;
+    QVector<QImage> frames;
+    for (int top = 0; top + frameHeight <= page.height(); top += scroll) {
+        frames.append(page.copy(0, top, page.width(), frameHeight));
+    }
+
+    ScrollStitcher stitcher;
+    QBENCHMARK {
+        stitcher.reset();
+        for (const QImage &frame : frames) {
+            stitcher.add(frame);
+        }
+    }
+    QCOMPARE(stitcher.height(), (frames.size() - 1) * scroll + frameHeight);
+    QCOMPARE(stitcher.result(),
+             page.copy(0, 0, page.width(), stitcher.height()).convertToFormat(QImage::Format_ARGB32_Premultiplied));
+}
+
+void ScreenshotBench::thumbnail_data()
+{
+    QTest::addColumn<QString>("layout");
+    for (const CaptureLayout &layout : kLayouts) {
+        QTest::newRow(layout.name) << QString(layout.name);
+    }
+}
+
+void ScreenshotBench::thumbnail()
+{
+    // 存入历史时的缩略图：整张截图盒式缩小到图集槽位大小
+    QFETCH(QString, layout);
+
+    const QImage &capture = m_captures.value(layout);
+    const QSize bound(HistoryStore::ThumbnailWidth, HistoryStore::ThumbnailHeight);
+    QImage thumbnail;
+    QBENCHMARK {
+        thumbnail = ImageOps::downscale(capture, bound);
+    }
+    QVERIFY(thumbnail.width() <= bound.width() && thumbnail.height() <= bound.height());
+    QVERIFY(thumbnail.width() == bound.width() || thumbnail.height() == bound.height());
+
+    // 纯色图像缩小后颜色不变
+    QImage solid(capture.size(), QImage::Format_RGB32);
+    solid.fill(qRgb(10, 120, 250));
+    QCOMPARE(ImageOps::downscale(solid, bound).pixel(0, 0), qRgb(10, 120, 250));
+}
+
+void ScreenshotBench::contentHash_data()
+{
+    QTest::addColumn<QString>("layout");
+    for (const CaptureLayout &layout : kLayouts) {
+        QTest::newRow(layout.name) << QString(layout.name);
+    }
+}
+
+void ScreenshotBench::contentHash()
+{
+    // 保存前按像素内容寻址：在合成好的选区上直接计算哈希，不需要编码或解码
+    QFETCH(QString, layout);
+
+    const QImage &capture = m_captures.value(layout);
+    const QImage composed = AnnotationRenderer::compose(TiledImage::fromImage(capture), selectionArea(capture), {});
+    quint64 hash = 0;
+    QBENCHMARK {
+        hash = ContentStore::pixelHash(composed);
+    }
+    // 内容相同的深拷贝得到相同的哈希，改动一个像素则不同
+    QImage copy = composed.copy();
+    QCOMPARE(ContentStore::pixelHash(copy), hash);
+    copy.setPixel(0, 0, copy.pixel(0, 0) ^ 0x00ffffff);
+    QVERIFY(ContentStore::pixelHash(copy) != hash);
+}
+
+void ScreenshotBench::imageDiff_data()
+{
+    QTest::addColumn<QString>("layout");
+    QTest::addColumn<bool>("highlight");
+    for (const CaptureLayout &layout : kLayouts) {
+        QTest::addRow("%s/count", layout.name) << QString(layout.name) << false;
+        QTest::addRow("%s/highlight", layout.name) << QString(layout.name) << true;
+    }
+}
+
+void ScreenshotBench::imageDiff()
+{
+    // 界面回归比较：同一画面改动两处，一处是远离的小块，一处是相邻的两块（应合并为一个区域）
+    QFETCH(QString, layout);
+    QFETCH(bool, highlight);
+
+    const QImage &capture = m_captures.value(layout);
+    QImage changed = capture.copy();
+    {
+        QPainter painter(&changed);
+        painter.fillRect(QRect(100, 100, 50, 30), Qt::red);
+        painter.fillRect(QRect(140, 125, 40, 40), Qt::blue);
+        painter.fillRect(QRect(capture.width() - 50, capture.height() - 40, 10, 10), Qt::green);
+    }
+    ImageDiff::Result result;
+    QBENCHMARK {
+        result = ImageDiff::compare(capture, changed, 8, highlight);
+    }
+    QCOMPARE(result.regions.size(), 2);
+    QVERIFY(QRect(100, 100, 80, 65).contains(result.regions.at(0)));
+    QCOMPARE(result.highlighted.isNull(), !highlight);
+    QVERIFY(ImageDiff::compare(capture, capture.copy(), 0, false).identical());
+    // 改动很小时感知哈希仍然相近
+    QVERIFY(ImageDiff::distance(HistoryStore::perceptualHash(capture), HistoryStore::perceptualHash(changed)) <=
+            ImageDiff::SimilarDistance);
+}
+
+void ScreenshotBench::idleFootprint()
+{
+    // 常驻托盘进程的空闲占用：一次3x4K截图会话结束后进入空闲模式，
+    // 截图和缓存都应释放，之后空闲期间不应有周期性的唤醒
+    ScreenshotWindow window;
+    {
+        // 深拷贝一份并只由窗口持有，否则块只是m_captures中图像的视图，释放后内存不会减少
+        loadWindow(window, m_captures.value("3x4K").copy(), 10);
+        QImage frame(window.size(), QImage::Format_ARGB32_Premultiplied);
+        window.render(&frame);
+    }
+    window.m_isScreenshotMode = false;
+    // 后台分析还在进行时空闲模式会推迟，先等它们完成
+    if (window.m_edgeMapFuture.valid()) {
+        window.m_edgeMapFuture.wait();
+    }
+    if (window.m_windowTreeFuture.valid()) {
+        window.m_windowTreeFuture.wait();
+    }
+
+    const ProcessStats::Snapshot before = ProcessStats::current();
+    window.enterIdleMode();
+    QVERIFY(window.m_idle);
+    const ProcessStats::Snapshot idle = ProcessStats::current();
+    QVERIFY(window.m_screenImage.isNull());
+    // 后备存储已释放，隐藏的遮罩窗口立即重建，下次截图不用再创建原生窗口
+    QVERIFY(!window.m_overlays.isEmpty());
+
+    // 只靠一个单次定时器结束等待，事件循环本身不产生其他唤醒
+    QEventLoop loop;
+    QTimer::singleShot(2000, &loop, &QEventLoop::quit);
+    loop.exec();
+    const ProcessStats::Snapshot after = ProcessStats::current();
+
+    const double wakeupsPerMinute = (after.contextSwitches() - idle.contextSwitches()) * 30.0;
+    qInfo("rss before=%lldKiB idle=%lldKiB wakeups/min=%.1f", before.rssBytes / 1024, idle.rssBytes / 1024,
+          wakeupsPerMinute);
+    if (before.rssBytes >= 0) {
+        QVERIFY(idle.rssBytes < before.rssBytes);
+        // 两秒内只应有结束等待的那一次唤醒，留出其他线程偶发调度的余量
+        QVERIFY(wakeupsPerMinute < 600);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // 基准测试不需要真实显示，默认使用offscreen平台
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    ScreenshotBench bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "screenshotbench.moc"
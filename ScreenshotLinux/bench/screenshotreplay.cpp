@@ -0,0 +1,287 @@
+// 输入回放工具：把 --record-input 录制的事件流注入遮罩窗口，统计帧时间和每帧内存分配次数，
+// 并输出最终合成图像的哈希，用于同时检查绘制改动的速度和正确性。
+// 截图内容是与录制尺寸相同的确定性合成图像，因此同一录制文件在不同提交上可以直接比较。
+//   ScreenshotReplay session.ssir [--frame-interval-us 16667] [--repeat N] [--csv frames.csv]
+#include "screenshotwindow.h"
+#include "inputrecorder.h"
+#include "syntheticcapture.h"
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QTextStream>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// 全局 operator new 计数，只在回放阶段打开，统计每帧的堆分配次数
+namespace {
+
+std::atomic<bool> g_countAllocations{false};
+std::atomic<quint64> g_allocations{0};
+
+void *countedAlloc(std::size_t size)
+{
+    if (g_countAllocations.load(std::memory_order_relaxed)) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void *operator new(std::size_t size) { return countedAlloc(size); }
+void *operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+class ScreenshotReplay
+{
+public:
+    struct Frame {
+        double ms;
+        quint64 allocations;
+        int events;
+    };
+
+    ScreenshotReplay(const QSize &canvasSize, const QVector<RecordedInput> &events)
+        : m_canvasSize(canvasSize)
+        , m_events(events)
+    {
+    }
+
+    // 回放一遍，帧间隔内的事件合并为一帧（与合成器按刷新率绘制一致），0表示每个事件一帧
+    QVector<Frame> run(const QImage &capture, qint64 frameIntervalUs);
+    QByteArray composedHash() const { return m_composedHash; }
+    QSize composedSize() const { return m_composedSize; }
+
+private:
+    bool dispatch(ScreenshotWindow &window, const RecordedInput &input);
+
+    QSize m_canvasSize;
+    QVector<RecordedInput> m_events;
+    QByteArray m_composedHash;
+    QSize m_composedSize;
+};
+
+bool ScreenshotReplay::dispatch(ScreenshotWindow &window, const RecordedInput &input)
+{
+    const auto modifiers = Qt::KeyboardModifiers(quint32(input.modifiers) << 25);
+    switch (input.kind) {
+        case RecordedInput::Kind::MousePress:
+        case RecordedInput::Kind::MouseRelease:
+        case RecordedInput::Kind::MouseMove: {
+            const QEvent::Type type = input.kind == RecordedInput::Kind::MousePress ? QEvent::MouseButtonPress
+                                    : input.kind == RecordedInput::Kind::MouseRelease ? QEvent::MouseButtonRelease
+                                                                                      : QEvent::MouseMove;
+            QMouseEvent event(type, QPointF(input.pos), QPointF(input.pos),
+                              Qt::MouseButton(input.button), Qt::MouseButtons(input.buttons), modifiers);
+            QApplication::sendEvent(&window, &event);
+            return true;
+        }
+        case RecordedInput::Kind::KeyPress:
+        case RecordedInput::Kind::KeyRelease: {
+            // 结束会话的按键会弹出对话框或写剪贴板，回放只关心会话内的绘制
+            const bool control = modifiers == Qt::ControlModifier;
+            if (input.key == Qt::Key_Escape || input.key == Qt::Key_Return || input.key == Qt::Key_Enter ||
+                (control && (input.key == Qt::Key_C || input.key == Qt::Key_S))) {
+                return false;
+            }
+            QKeyEvent event(input.kind == RecordedInput::Kind::KeyPress ? QEvent::KeyPress : QEvent::KeyRelease,
+                            input.key, modifiers, input.text);
+            QApplication::sendEvent(&window, &event);
+            return true;
+        }
+        case RecordedInput::Kind::ToolAction: {
+            QAction *action = window.m_toolBar->actions().value(input.action);
+            // 文字、长截图、保存、取消和完成都会弹出模态对话框或结束会话，跳过
+            if (!action || action == window.m_textAction || action == window.m_scrollAction ||
+                action == window.m_saveAction ||
+                action == window.m_cancelAction || action == window.m_finishAction) {
+                return false;
+            }
+            action->trigger();
+            return true;
+        }
+    }
+    return false;
+}
+
+QVector<ScreenshotReplay::Frame> ScreenshotReplay::run(const QImage &capture, qint64 frameIntervalUs)
+{
+    ScreenshotWindow window;
+    window.m_screenImage = TiledImage::fromImage(capture);
+    window.m_isScreenshotMode = true;
+    window.m_isSelecting = false;
+    window.m_hasSelected = false;
+    window.resize(m_canvasSize);
+
+    QImage target(m_canvasSize, QImage::Format_ARGB32_Premultiplied);
+    window.render(&target); // 首帧：遮罩刚显示时的状态
+
+    QVector<Frame> frames;
+    frames.reserve(m_events.size());
+
+    QElapsedTimer timer;
+    qint64 pendingUs = 0;
+    int pendingEvents = 0;
+    timer.start();
+    g_allocations.store(0, std::memory_order_relaxed);
+    g_countAllocations.store(true, std::memory_order_relaxed);
+
+    for (int i = 0; i < m_events.size(); ++i) {
+        const RecordedInput &input = m_events.at(i);
+        if (dispatch(window, input)) {
+            ++pendingEvents;
+        }
+
+        // 按下和释放总是立即出帧，移动事件按录制时的时间间隔合并
+        const qint64 nextDeltaUs = i + 1 < m_events.size() ? m_events.at(i + 1).deltaUs : frameIntervalUs;
+        pendingUs += nextDeltaUs;
+        const bool flush = input.kind != RecordedInput::Kind::MouseMove || pendingUs >= frameIntervalUs ||
+                           i + 1 == m_events.size();
+        if (!flush || pendingEvents == 0) {
+            continue;
+        }
+
+        window.render(&target);
+
+        g_countAllocations.store(false, std::memory_order_relaxed);
+        frames.append({ timer.nsecsElapsed() / 1e6, g_allocations.load(std::memory_order_relaxed), pendingEvents });
+        pendingUs = 0;
+        pendingEvents = 0;
+        g_allocations.store(0, std::memory_order_relaxed);
+        g_countAllocations.store(true, std::memory_order_relaxed);
+        timer.restart();
+    }
+    g_countAllocations.store(false, std::memory_order_relaxed);
+
+    // 合成结果的哈希按行计算，忽略扫描行末尾的填充字节
+    const QImage composed = window.m_hasSelected ? window.composeSelection() : QImage();
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!composed.isNull()) {
+        const QImage pixels = composed.convertToFormat(QImage::Format_ARGB32);
+        const qsizetype rowBytes = qsizetype(pixels.width()) * 4;
+        for (int y = 0; y < pixels.height(); ++y) {
+            hash.addData(QByteArrayView(reinterpret_cast<const char *>(pixels.constScanLine(y)), rowBytes));
+        }
+    }
+    m_composedHash = hash.result().toHex();
+    m_composedSize = composed.size();
+    return frames;
+}
+
+namespace {
+
+double percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t index = std::min(values.size() - 1, size_t(p * (values.size() - 1) + 0.5));
+    return values[index];
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 回放不需要真实显示，默认使用offscreen平台
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("回放录制的输入事件，统计遮罩窗口的帧时间。");
+    parser.addHelpOption();
+    parser.addPositionalArgument("recording", "--record-input 录制的文件。");
+    const QCommandLineOption intervalOption("frame-interval-us", "合并移动事件的帧间隔，0表示每个事件一帧。",
+                                            "us", "16667");
+    const QCommandLineOption repeatOption("repeat", "重复回放次数，统计所有轮次。", "n", "1");
+    const QCommandLineOption csvOption("csv", "把逐帧数据写到CSV文件。", "file");
+    parser.addOption(intervalOption);
+    parser.addOption(repeatOption);
+    parser.addOption(csvOption);
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(2);
+    }
+
+    QSize canvasSize;
+    QVector<RecordedInput> events;
+    const QString recording = parser.positionalArguments().first();
+    if (!InputRecorder::load(recording, &canvasSize, &events) || canvasSize.isEmpty()) {
+        std::fprintf(stderr, "无法读取录制文件: %s\n", qPrintable(recording));
+        return 1;
+    }
+
+    const qint64 frameIntervalUs = qMax(0LL, parser.value(intervalOption).toLongLong());
+    const int repeat = qMax(1, parser.value(repeatOption).toInt());
+    const QImage capture = syntheticScreen(canvasSize, 1000);
+
+    ScreenshotReplay replay(canvasSize, events);
+    QVector<ScreenshotReplay::Frame> frames;
+    QByteArray hash;
+    for (int i = 0; i < repeat; ++i) {
+        frames += replay.run(capture, frameIntervalUs);
+        // 每轮的合成结果必须一致，否则说明绘制结果依赖于时序或未初始化状态
+        if (i > 0 && replay.composedHash() != hash) {
+            std::fprintf(stderr, "第%d轮回放的合成结果与第1轮不同\n", i + 1);
+            return 1;
+        }
+        hash = replay.composedHash();
+    }
+
+    std::vector<double> times;
+    std::vector<double> allocations;
+    times.reserve(size_t(frames.size()));
+    allocations.reserve(size_t(frames.size()));
+    for (const ScreenshotReplay::Frame &frame : frames) {
+        times.push_back(frame.ms);
+        allocations.push_back(double(frame.allocations));
+    }
+    double allocationSum = 0;
+    for (double value : allocations) {
+        allocationSum += value;
+    }
+
+    std::printf("recording: %s canvas=%dx%d events=%d frames=%d repeat=%d\n",
+                qPrintable(recording), canvasSize.width(), canvasSize.height(),
+                int(events.size()), int(frames.size()) / repeat, repeat);
+    std::printf("frame_ms: p50=%.3f p95=%.3f p99=%.3f max=%.3f\n",
+                percentile(times, 0.50), percentile(times, 0.95), percentile(times, 0.99),
+                percentile(times, 1.0));
+    std::printf("allocations_per_frame: mean=%.1f p95=%.0f max=%.0f\n",
+                frames.isEmpty() ? 0.0 : allocationSum / frames.size(),
+                percentile(allocations, 0.95), percentile(allocations, 1.0));
+    std::printf("composed: %dx%d sha256=%s\n",
+                replay.composedSize().width(), replay.composedSize().height(), hash.constData());
+
+    if (parser.isSet(csvOption)) {
+        QFile file(parser.value(csvOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+            std::fprintf(stderr, "无法写入: %s\n", qPrintable(file.fileName()));
+            return 1;
+        }
+        QTextStream out(&file);
+        out << "frame,ms,allocations,events\n";
+        for (int i = 0; i < frames.size(); ++i) {
+            out << i << ',' << frames.at(i).ms << ',' << frames.at(i).allocations << ',' << frames.at(i).events << '\n';
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef SYNTHETICCAPTURE_H
+#define SYNTHETICCAPTURE_H
+
+// 基准测试和输入回放共用的确定性截图数据，同一尺寸和种子总是得到相同像素
+#include <QImage>
+#include <QLinearGradient>
+#include <QPainter>
+#include <QRandomGenerator>
+
+// 合成一张类似桌面内容的确定性图像：渐变背景、色块和细线文字区域
+inline QImage syntheticScreen(const QSize &size, quint32 seed)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    QLinearGradient gradient(0, 0, size.width(), size.height());
+    gradient.setColorAt(0, QColor(40, 60, 90));
+    gradient.setColorAt(1, QColor(200, 210, 230));
+    painter.fillRect(image.rect(), gradient);
+
+    QRandomGenerator random(seed);
+    for (int i = 0; i < 200; ++i) {
+        const QRect window(random.bounded(size.width()), random.bounded(size.height()),
+                           80 + random.bounded(600), 60 + random.bounded(400));
+        painter.fillRect(window, QColor::fromRgb(random.generate() | 0xff000000));
+        painter.setPen(Qt::black);
+        for (int line = window.top() + 8; line < window.bottom(); line += 14) {
+            painter.drawLine(window.left() + 6, line, window.left() + 6 + random.bounded(window.width()), line);
+        }
+    }
+    painter.end();
+    return image;
+}
+
+#endif // SYNTHETICCAPTURE_H
@@ -0,0 +1,67 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// 固定容量的多生产者多消费者队列，流水线各级之间传递数据
+// 生产者不阻塞：队列满时tryPush()返回false，由调用方决定丢弃（例如录制时丢帧），
+// 内存占用不超过容量；消费者在pop()中等待，close()之后取完剩余元素即返回false
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(int capacity) : m_capacity(size_t(capacity > 0 ? capacity : 1)) {}
+
+    bool tryPush(T value)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_closed || m_items.size() >= m_capacity) {
+                return false;
+            }
+            m_items.push_back(std::move(value));
+        }
+        m_ready.notify_one();
+        return true;
+    }
+
+    bool pop(T *value)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_ready.wait(lock, [this]() { return m_closed || !m_items.empty(); });
+        if (m_items.empty()) {
+            return false;
+        }
+        *value = std::move(m_items.front());
+        m_items.pop_front();
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_ready.notify_all();
+    }
+
+    bool isFull() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_items.size() >= m_capacity;
+    }
+
+    int capacity() const { return int(m_capacity); }
+
+private:
+    const size_t m_capacity;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_ready;
+    std::deque<T> m_items;
+    bool m_closed = false;
+};
+
+#endif // BOUNDEDQUEUE_H
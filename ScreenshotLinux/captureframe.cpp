@@ -0,0 +1,132 @@
+#include "captureframe.h"
+#include <atomic>
+#include <cctype>
+
+namespace {
+
+std::atomic<qint64> g_bytesCopied{0};
+
+void releaseFrame(void *info)
+{
+    CaptureFrame::Release *release = static_cast<CaptureFrame::Release *>(info);
+    if (*release) {
+        (*release)();
+    }
+    delete release;
+}
+
+// 读取PPM头中的一个十进制数，跳过前面的空白和注释
+bool readHeaderNumber(const QByteArray &data, int *offset, int *value)
+{
+    int pos = *offset;
+    while (pos < data.size()) {
+        const char c = data.at(pos);
+        if (c == '#') {
+            while (pos < data.size() && data.at(pos) != '\n') {
+                ++pos;
+            }
+        } else if (std::isspace(static_cast<unsigned char>(c))) {
+            ++pos;
+        } else {
+            break;
+        }
+    }
+    qint64 number = 0;
+    const int begin = pos;
+    while (pos < data.size() && std::isdigit(static_cast<unsigned char>(data.at(pos))) && number <= 1 << 20) {
+        number = number * 10 + (data.at(pos) - '0');
+        ++pos;
+    }
+    if (pos == begin || number > 1 << 20) {
+        return false;
+    }
+    *offset = pos;
+    *value = int(number);
+    return true;
+}
+
+} // namespace
+
+namespace CaptureFrame {
+
+QImage wrap(const uchar *data, const QSize &size, qsizetype bytesPerLine,
+            QImage::Format format, Release release)
+{
+    if (!data || size.isEmpty()) {
+        if (release) {
+            release();
+        }
+        return QImage();
+    }
+    // 构造失败时QImage不会调用清理函数，需要自己释放
+    Release *info = new Release(std::move(release));
+    QImage image(data, size.width(), size.height(), bytesPerLine, format, releaseFrame, info);
+    if (image.isNull()) {
+        releaseFrame(info);
+    }
+    return image;
+}
+
+QImage view(const QImage &frame, const QRect &rect)
+{
+    const QRect area = rect.intersected(frame.rect());
+    if (area.isEmpty()) {
+        return QImage();
+    }
+    if (area == frame.rect()) {
+        return frame;
+    }
+    if (frame.depth() < 16) {
+        QImage copied = frame.copy(area);
+        noteCopy(copied.sizeInBytes());
+        return copied;
+    }
+
+    // 释放函数里持有frame的一份引用，视图存在期间帧不会被释放
+    const uchar *data = frame.constScanLine(area.top()) + area.left() * (frame.depth() / 8);
+    QImage result = wrap(data, area.size(), frame.bytesPerLine(), frame.format(), [frame]() {});
+    result.setDevicePixelRatio(frame.devicePixelRatio());
+    return result;
+}
+
+QImage fromPpm(const QByteArray &data)
+{
+    if (!data.startsWith("P6")) {
+        return QImage();
+    }
+    int offset = 2;
+    int width = 0;
+    int height = 0;
+    int maxValue = 0;
+    if (!readHeaderNumber(data, &offset, &width) ||
+        !readHeaderNumber(data, &offset, &height) ||
+        !readHeaderNumber(data, &offset, &maxValue) || maxValue != 255) {
+        return QImage();
+    }
+    // 头部之后恰好一个空白字符，然后是按行紧密排列的RGB像素
+    ++offset;
+    const qint64 bytesPerLine = qint64(width) * 3;
+    if (width <= 0 || height <= 0 || data.size() - offset < bytesPerLine * height) {
+        return QImage();
+    }
+    // 释放函数持有QByteArray，工具输出的缓冲区就是帧的像素
+    return wrap(reinterpret_cast<const uchar *>(data.constData()) + offset, QSize(width, height),
+                bytesPerLine, QImage::Format_RGB888, [data]() {});
+}
+
+void noteCopy(qint64 bytes)
+{
+    g_bytesCopied.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+qint64 bytesCopied()
+{
+    return g_bytesCopied.load(std::memory_order_relaxed);
+}
+
+void resetBytesCopied()
+{
+    g_bytesCopied.store(0, std::memory_order_relaxed);
+}
+
+} // namespace CaptureFrame
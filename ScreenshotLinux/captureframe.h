@@ -0,0 +1,40 @@
+#ifndef CAPTUREFRAME_H
+#define CAPTUREFRAME_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <functional>
+
+// 截图帧：后端缓冲区（共享内存段、工具输出、解码结果）就是帧本身，不再复制到新图像
+// 通过QImage的外部缓冲区构造函数包装，QImage的隐式共享就是帧的引用计数，
+// 最后一个引用释放时调用release归还缓冲区（解除共享内存映射等）；
+// view()得到的子矩形直接指向同一块内存并持有帧的引用，遮罩的块、导出的选区都是视图
+// 视图是只读的，对它写入时QImage会先复制（写时复制）
+//
+// 帧产生之后的每次像素复制都用noteCopy()记录，正常路径上应接近0；
+// 解码压缩格式得到的图像本身就是帧，不计入
+namespace CaptureFrame {
+
+using Release = std::function<void()>;
+
+// 包装外部缓冲区，data在release被调用之前必须保持有效
+QImage wrap(const uchar *data, const QSize &size, qsizetype bytesPerLine,
+            QImage::Format format, Release release);
+
+// frame中rect部分的只读视图，不复制像素；每像素不足16位的格式退回复制
+QImage view(const QImage &frame, const QRect &rect);
+
+// 二进制PPM（P6，最大值255）直接按RGB888包装data中的像素，不解码不复制；
+// 格式不符时返回空图像
+QImage fromPpm(const QByteArray &data);
+
+// 复制像素的统计，线程安全
+void noteCopy(qint64 bytes);
+qint64 bytesCopied();
+void resetBytesCopied();
+
+} // namespace CaptureFrame
+
+#endif // CAPTUREFRAME_H
@@ -0,0 +1,293 @@
+#include "commandline.h"
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QStringList>
+
+namespace {
+
+// 解析 "x,y,w,h" 格式的区域
+bool parseRegion(const QString &text, QRect *region)
+{
+    const QStringList parts = text.split(',');
+    if (parts.size() != 4) {
+        return false;
+    }
+    int values[4];
+    for (int i = 0; i < 4; ++i) {
+        bool ok = false;
+        values[i] = parts.at(i).trimmed().toInt(&ok);
+        if (!ok) {
+            return false;
+        }
+    }
+    *region = QRect(values[0], values[1], values[2], values[3]);
+    return region->isValid();
+}
+
+} // namespace
+
+CommandLineOptions parseCommandLine(int argc, char *argv[])
+{
+    CommandLineOptions options;
+
+    QStringList arguments;
+    for (int i = 0; i < argc; ++i) {
+        arguments << QString::fromLocal8Bit(argv[i]);
+    }
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Linux截图工具。不带参数运行时常驻系统托盘。");
+    const QCommandLineOption helpOption = parser.addHelpOption();
+    const QCommandLineOption versionOption = parser.addVersionOption();
+
+    const QCommandLineOption regionOption("region", "无界面截取指定区域。", "x,y,w,h");
+    const QCommandLineOption outputOption("output", "无界面截图输出文件，\"-\" 表示标准输出。", "file");
+    const QCommandLineOption formatOption("format", "输出格式：png、jpg或bmp。", "format");
+    const QCommandLineOption timingsOption("timings", "在标准错误输出启动到退出的各阶段耗时。");
+    const QCommandLineOption traceOption("trace", "记录各阶段的追踪区间，写出Chrome Trace Event JSON。", "file");
+    const QCommandLineOption verboseOption("verbose", "输出调试日志（仅Debug构建包含调试输出）。");
+    const QCommandLineOption commandOption("command",
+        "把命令转发给常驻实例后退出：capture-interactive、capture-live、capture-region x,y,w,h [file]、"
+        "capture-last [N] [file]、capture-screen N [file]、record-start [x,y,w,h|last] [file] [fps]、record-stop、"
+        "scroll-start [x,y,w,h|last] [file]、scroll-stop、"
+        "last-result、history、history-similar [N|file] [distance]、metrics、stats、idle、dump-log [file]、"
+        "trace-start、trace-stop [file]、trace-dump [file]。", "command");
+    const QCommandLineOption intervalOption("interval",
+        "每隔指定秒数截取一次区域，保存到 --output 目录；没有变化的帧不保存，少量变化只保存变化的块。", "seconds");
+    const QCommandLineOption countOption("count", "定时截图的帧数，默认一直截取。", "n");
+    const QCommandLineOption recordOption("record",
+        "录制区域指定的秒数，--output 为 .gif 时写出动画GIF，其他后缀通过ffmpeg编码为视频。", "seconds");
+    const QCommandLineOption fpsOption("fps", "录制帧率，默认10。", "n");
+    const QCommandLineOption scrollOption("scroll",
+        "长截图：截取 --region 区域，滚动时逐帧拼接（X11下自动滚动），内容不再变化后写到 --output。");
+    const QCommandLineOption diffOption("diff",
+        "比较两个图片文件：--diff a.png b.png，输出变化区域的矩形，--output 写出标出变化的对比图；"
+        "相同时退出码为0，不同时为1。");
+    const QCommandLineOption toleranceOption("tolerance", "比较时每个通道允许的差（0-255），默认8。", "n");
+    const QCommandLineOption repeatLastOption("repeat-last",
+        "不显示遮罩，重复截取最近一次确定的选区（屏幕布局需与当时相同）。");
+    const QCommandLineOption ipcBenchOption("ipc-bench", "测量与常驻实例的命令往返延迟。", "n");
+    const QCommandLineOption recordInputOption("record-input",
+        "录制截图会话中的鼠标和键盘事件，供 ScreenshotReplay 回放分析帧时间。", "file");
+    parser.addOption(regionOption);
+    parser.addOption(outputOption);
+    parser.addOption(formatOption);
+    parser.addOption(timingsOption);
+    parser.addOption(traceOption);
+    parser.addOption(verboseOption);
+    parser.addOption(commandOption);
+    parser.addOption(intervalOption);
+    parser.addOption(countOption);
+    parser.addOption(recordOption);
+    parser.addOption(fpsOption);
+    parser.addOption(scrollOption);
+    parser.addOption(diffOption);
+    parser.addOption(toleranceOption);
+    parser.addOption(repeatLastOption);
+    parser.addOption(ipcBenchOption);
+    parser.addOption(recordInputOption);
+
+    if (!parser.parse(arguments)) {
+        options.errorText = parser.errorText();
+        return options;
+    }
+
+    options.showHelp = parser.isSet(helpOption);
+    options.showVersion = parser.isSet(versionOption);
+    if (options.showHelp) {
+        options.helpText = parser.helpText();
+    }
+
+    if (parser.isSet(regionOption) && !parseRegion(parser.value(regionOption), &options.region)) {
+        options.errorText = "无效的区域: " + parser.value(regionOption);
+        return options;
+    }
+
+    options.format = parser.value(formatOption).toLower();
+    if (!options.format.isEmpty() &&
+        options.format != "png" && options.format != "jpg" &&
+        options.format != "jpeg" && options.format != "bmp") {
+        options.errorText = "不支持的输出格式: " + options.format;
+        return options;
+    }
+
+    if (parser.isSet(ipcBenchOption)) {
+        bool ok = false;
+        options.ipcBenchIterations = parser.value(ipcBenchOption).toInt(&ok);
+        if (!ok || options.ipcBenchIterations <= 0) {
+            options.errorText = "无效的迭代次数: " + parser.value(ipcBenchOption);
+            return options;
+        }
+    }
+
+    options.command = resolveCommandFile(parser.value(commandOption).trimmed());
+    options.timings = parser.isSet(timingsOption);
+    options.verbose = parser.isSet(verboseOption);
+    options.traceOutput = parser.value(traceOption);
+    options.recordInput = parser.value(recordInputOption);
+    options.headless = parser.isSet(regionOption) || parser.isSet(outputOption);
+    options.output = parser.isSet(outputOption) ? parser.value(outputOption) : QStringLiteral("-");
+    
+    if (parser.isSet(intervalOption)) {
+        bool ok = false;
+        options.intervalSeconds = parser.value(intervalOption).toDouble(&ok);
+        if (!ok || options.intervalSeconds < 0.1) {
+            options.errorText = "无效的截图间隔: " + parser.value(intervalOption);
+            return options;
+        }
+        if (!parser.isSet(outputOption) || options.output == "-") {
+            options.errorText = "定时截图需要用 --output 指定输出目录";
+            return options;
+        }
+        options.intervalCount = parser.value(countOption).toInt();
+        if (options.intervalCount < 0) {
+            options.errorText = "无效的帧数: " + parser.value(countOption);
+            return options;
+        }
+        options.headless = false;
+    }
+    
+    if (parser.isSet(recordOption)) {
+        bool ok = false;
+        options.recordSeconds = parser.value(recordOption).toDouble(&ok);
+        if (!ok || options.recordSeconds <= 0) {
+            options.errorText = "无效的录制时长: " + parser.value(recordOption);
+            return options;
+        }
+        if (!parser.isSet(outputOption) || options.output == "-") {
+            options.errorText = "录制需要用 --output 指定输出文件";
+            return options;
+        }
+        options.headless = false;
+    }
+    if (parser.isSet(fpsOption)) {
+        bool ok = false;
+        options.fps = parser.value(fpsOption).toInt(&ok);
+        if (!ok || options.fps < 1 || options.fps > 60) {
+            options.errorText = "帧率应在1到60之间: " + parser.value(fpsOption);
+            return options;
+        }
+    }
+    
+    if (parser.isSet(scrollOption)) {
+        if (!options.region.isValid()) {
+            options.errorText = "长截图需要用 --region 指定区域";
+            return options;
+        }
+        if (!parser.isSet(outputOption) || options.output == "-") {
+            options.errorText = "长截图需要用 --output 指定输出文件";
+            return options;
+        }
+        options.scroll = true;
+        options.headless = false;
+    }
+    
+    if (parser.isSet(toleranceOption)) {
+        bool ok = false;
+        options.tolerance = parser.value(toleranceOption).toInt(&ok);
+        if (!ok || options.tolerance < 0 || options.tolerance > 255) {
+            options.errorText = "容差应在0到255之间: " + parser.value(toleranceOption);
+            return options;
+        }
+    }
+    if (parser.isSet(diffOption)) {
+        options.diffFiles = parser.positionalArguments();
+        if (options.diffFiles.size() != 2) {
+            options.errorText = "--diff 需要两个图片文件";
+            return options;
+        }
+        if (options.output == "-" && parser.isSet(outputOption)) {
+            options.errorText = "对比图需要用 --output 指定文件";
+            return options;
+        }
+        if (!parser.isSet(outputOption)) {
+            options.output.clear();
+        }
+        options.headless = false;
+    }
+    
+    // 重复截取先交给常驻实例（选区记录和后台编码都在那里），没有实例时再走无界面模式；
+    // 输出到标准输出时常驻实例无法代写，直接无界面截取
+    options.repeatLast = parser.isSet(repeatLastOption);
+    if (options.repeatLast) {
+        if (parser.isSet(regionOption)) {
+            options.errorText = "--repeat-last 不能与 --region 同时使用";
+            return options;
+        }
+        options.headless = options.output == "-" && parser.isSet(outputOption);
+        if (!options.headless) {
+            options.command = parser.isSet(outputOption) ? "capture-last " + QFileInfo(options.output).absoluteFilePath()
+                                                         : QStringLiteral("capture-last");
+        }
+    }
+    return options;
+}
+
+QString commandRest(const QString &command, int skip)
+{
+    int pos = 0;
+    for (int i = 0; i < skip; ++i) {
+        while (pos < command.size() && command.at(pos) == ' ') {
+            ++pos;
+        }
+        while (pos < command.size() && command.at(pos) != ' ') {
+            ++pos;
+        }
+    }
+    return command.mid(pos).trimmed();
+}
+
+bool takeTrailingNumber(QString *text, int *value)
+{
+    // 只有一个参数时它就是文件，不当作数字
+    const int space = text->lastIndexOf(' ');
+    if (space < 0) {
+        return false;
+    }
+    bool ok = false;
+    const int number = text->mid(space + 1).toInt(&ok);
+    if (!ok) {
+        return false;
+    }
+    *value = number;
+    *text = text->left(space).trimmed();
+    return true;
+}
+
+QString resolveCommandFile(const QString &command)
+{
+    // 与ScreenshotWindow::executeCommand()中各命令的参数位置一致
+    const QStringList args = command.split(' ', Qt::SkipEmptyParts);
+    const QString name = args.value(0);
+    bool isIndex = false;
+    args.value(1).toInt(&isIndex);
+    int skip = 0;
+    bool trailingNumber = false;
+    if (name == "capture-region" || name == "capture-screen" || name == "scroll-start") {
+        skip = 2;
+    } else if (name == "record-start") {
+        skip = 2;
+        trailingNumber = true;
+    } else if (name == "capture-last") {
+        skip = isIndex ? 2 : 1;
+    } else if (name == "history-similar" && !isIndex) {
+        skip = 1;
+        trailingNumber = true;
+    } else if (name == "dump-log" || name == "trace-stop" || name == "trace-dump") {
+        skip = 1;
+    } else {
+        return command;
+    }
+
+    QString file = commandRest(command, skip);
+    int number = 0;
+    const bool hasNumber = trailingNumber && takeTrailingNumber(&file, &number);
+    if (file.isEmpty()) {
+        return command;
+    }
+    QString resolved = args.mid(0, skip).join(' ') + ' ' + QFileInfo(file).absoluteFilePath();
+    if (hasNumber) {
+        resolved += ' ' + QString::number(number);
+    }
+    return resolved;
+}
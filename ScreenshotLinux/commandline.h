@@ -0,0 +1,44 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include <QRect>
+#include <QString>
+#include <QStringList>
+
+// 命令行参数，在创建QApplication之前解析，以便无界面模式选择更轻量的启动路径
+struct CommandLineOptions {
+    bool headless = false;   // 无界面截图模式：不创建托盘图标、工具栏和遮罩窗口
+    QRect region;            // 截图区域（虚拟桌面逻辑坐标），无效表示全部屏幕
+    QString output;          // 输出文件，"-" 表示写到标准输出
+    QString format;          // 输出格式（png/jpg/bmp），为空时根据文件后缀判断
+    bool timings = false;    // 退出前在标准错误输出各阶段耗时
+    QString traceOutput;     // 非空时记录追踪区间并写出Chrome Trace JSON
+    bool verbose = false;    // 打开调试输出（仅Debug构建有效）
+    QString command;         // 转发给常驻实例的命令
+    int ipcBenchIterations = 0; // 大于0时测量与常驻实例的命令往返延迟
+    QString recordInput;     // 非空时把每次截图会话的鼠标/键盘事件录制到该文件
+    double intervalSeconds = 0; // 大于0时按此间隔定时截图到output目录，跳过没有变化的帧
+    int intervalCount = 0;   // 定时截图的帧数，0表示一直截取
+    double recordSeconds = 0; // 大于0时录制区域这么多秒，写出GIF或视频
+    int fps = 10;            // 录制帧率
+    bool scroll = false;     // 长截图：截取区域并在滚动时拼接，写到output文件
+    bool repeatLast = false; // 重复截取最近一次确定的选区：有常驻实例时转发，否则在本进程内截取
+    QStringList diffFiles;   // 两个图片文件时比较它们，对比图写到output（可省略）
+    int tolerance = 8;       // 比较时每个通道允许的差，抗锯齿和有损编码的细小差别不算变化
+
+    bool showHelp = false;
+    bool showVersion = false;
+    QString helpText;
+    QString errorText;       // 参数错误信息，非空表示解析失败
+};
+
+CommandLineOptions parseCommandLine(int argc, char *argv[]);
+
+// 转发给常驻实例的命令中，文件参数是跳过前skip个以空格分隔的参数后的剩余部分，路径可以带空格
+QString commandRest(const QString &command, int skip);
+// text末尾有以空格分隔的整数参数（录制帧率、近似距离）时去掉它并写到value
+bool takeTrailingNumber(QString *text, int *value);
+// 命令中的文件参数换成绝对路径：常驻实例的工作目录与客户端不同
+QString resolveCommandFile(const QString &command);
+
+#endif // COMMANDLINE_H
@@ -0,0 +1,192 @@
+#include "contentstore.h"
+#include "fasthash.h"
+#include "trace.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <atomic>
+#include <cerrno>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kSettingsName[] = "ScreenshotLinux";
+
+// 同一进程里并发创建链接和对象时临时文件名不冲突
+std::atomic<quint32> g_linkCounter{0};
+// 按哈希分段加锁，同一哈希的对象在进程内串行创建：
+// 保存文件和记入历史常在两个线程上同时存同一张截图，后到的等先到的写完后直接链接，只编码一次
+const int kCreateLocks = 16;
+std::mutex g_createLocks[kCreateLocks];
+
+bool writeDirect(const QImage &image, const QString &target, ImageEncoder::Profile profile)
+{
+    QSaveFile file(target);
+    return file.open(QIODevice::WriteOnly) && ImageEncoder::encode(image, &file, profile) && file.commit();
+}
+
+// 两个路径（不存在时取所在目录）是否在同一文件系统上
+bool sameDevice(const QString &a, const QString &b)
+{
+    struct stat first;
+    struct stat second;
+    const QByteArray pathA = QFile::encodeName(QFileInfo::exists(a) ? a : QFileInfo(a).absolutePath());
+    const QByteArray pathB = QFile::encodeName(QFileInfo::exists(b) ? b : QFileInfo(b).absolutePath());
+    return ::stat(pathA.constData(), &first) == 0 && ::stat(pathB.constData(), &second) == 0 &&
+           first.st_dev == second.st_dev;
+}
+
+} // namespace
+
+namespace ContentStore {
+
+QString defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/ScreenshotLinux/objects";
+}
+
+bool enabledInSettings()
+{
+    QSettings settings(kSettingsName, kSettingsName);
+    return settings.value("storage/dedup", true).toBool();
+}
+
+quint64 pixelHash(const QImage &image)
+{
+    if (image.isNull()) {
+        return 0;
+    }
+    TRACE_SCOPE("store.hash");
+    // 尺寸和格式作为种子，同样的字节换一种排列不会得到相同的哈希
+    quint64 hash = (quint64(image.width()) << 40) ^ (quint64(image.height()) << 16) ^ quint64(image.format());
+    // 逐行哈希，每行的结果作为下一行的种子：视图和有行填充的图像与连续存储的深拷贝得到相同的结果
+    // 一行有几KB，XXH64的四路累加在每行内都能跑满
+    const size_t rowBytes = size_t(image.width()) * size_t(image.depth()) / 8;
+    for (int y = 0; y < image.height(); ++y) {
+        hash = FastHash::hash64(image.constScanLine(y), rowBytes, hash);
+    }
+    return hash;
+}
+
+QString objectPath(quint64 hash, ImageEncoder::Profile profile, const QString &root)
+{
+    const QString name = QString("%1").arg(hash, 16, 16, QLatin1Char('0'));
+    return root + '/' + name.left(2) + '/' + name.mid(2) + '.' + ImageEncoder::fileSuffix(profile);
+}
+
+QString store(const QImage &image, quint64 hash, ImageEncoder::Profile profile, bool *created, const QString &root)
+{
+    if (created) {
+        *created = false;
+    }
+    const QString path = objectPath(hash, profile, root);
+    const QByteArray objectName = QFile::encodeName(path);
+    std::lock_guard<std::mutex> lock(g_createLocks[hash % kCreateLocks]);
+    struct stat info;
+    if (::stat(objectName.constData(), &info) == 0) {
+        if ((info.st_mode & 0222) == 0) {
+            return path;
+        }
+        // 可写的对象（旧版本写入的，或被改回可写）可能已被原地修改，不再按哈希复用：
+        // 只删除对象这个名字，已有的链接保留各自的内容，下面重新写入
+        ::unlink(objectName.constData());
+    }
+    TRACE_SCOPE("store.object", path);
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return QString();
+    }
+    // 先写到临时文件并设为只读（所有链接共享权限，保存的文件不能被原地改写），再链接到对象名；
+    // 其他进程同时创建了同一个对象时链接失败，直接使用已有的对象
+    const QString temporary = path + QString(".%1.%2.tmp").arg(::getpid()).arg(++g_linkCounter);
+    const QByteArray temporaryName = QFile::encodeName(temporary);
+    QFile file(temporary);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::NewOnly)) {
+        return QString();
+    }
+    const bool written = ImageEncoder::encode(image, &file, profile) && file.flush();
+    file.close();
+    if (!written || ::chmod(temporaryName.constData(), 0444) != 0) {
+        ::unlink(temporaryName.constData());
+        return QString();
+    }
+    const bool published = ::link(temporaryName.constData(), objectName.constData()) == 0;
+    const int error = errno;
+    ::unlink(temporaryName.constData());
+    if (!published && error != EEXIST) {
+        return QString();
+    }
+    if (created) {
+        *created = published;
+    }
+    return path;
+}
+
+bool link(const QString &object, const QString &target)
+{
+    const QByteArray source = QFile::encodeName(object);
+    const QByteArray destination = QFile::encodeName(target);
+    struct stat objectInfo;
+    struct stat targetInfo;
+    if (::stat(source.constData(), &objectInfo) != 0) {
+        return false;
+    }
+    if (::stat(destination.constData(), &targetInfo) == 0 && targetInfo.st_dev == objectInfo.st_dev &&
+        targetInfo.st_ino == objectInfo.st_ino) {
+        return true;
+    }
+    // 先链接到同目录下的临时名字再改名，已有的文件被原子替换，不会出现写了一半的文件
+    const QByteArray temporary = destination + QString(".%1.%2.lnk").arg(::getpid()).arg(++g_linkCounter).toLatin1();
+    if (::link(source.constData(), temporary.constData()) != 0) {
+        return false;
+    }
+    if (::rename(temporary.constData(), destination.constData()) != 0) {
+        ::unlink(temporary.constData());
+        return false;
+    }
+    return true;
+}
+
+void release(const QString &object)
+{
+    struct stat info;
+    const QByteArray path = QFile::encodeName(object);
+    if (::stat(path.constData(), &info) == 0 && info.st_nlink <= 1) {
+        ::unlink(path.constData());
+    }
+}
+
+int collectGarbage(const QString &root)
+{
+    TRACE_SCOPE("store.gc");
+    int removed = 0;
+    QDirIterator it(root, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QByteArray path = QFile::encodeName(it.next());
+        struct stat info;
+        if (::stat(path.constData(), &info) == 0 && info.st_nlink <= 1 && ::unlink(path.constData()) == 0) {
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+bool save(const QImage &image, const QString &target, ImageEncoder::Profile profile, const QString &root)
+{
+    if (!QDir().mkpath(root) || !sameDevice(root, target)) {
+        return writeDirect(image, target, profile);
+    }
+    const QString object = store(image, pixelHash(image), profile, nullptr, root);
+    if (!object.isEmpty() && link(object, target)) {
+        return true;
+    }
+    // 文件系统不支持硬链接等：直接写，没有被链接的对象由collectGarbage()清理
+    return writeDirect(image, target, profile);
+}
+
+} // namespace ContentStore
@@ -0,0 +1,45 @@
+#ifndef CONTENTSTORE_H
+#define CONTENTSTORE_H
+
+#include <QImage>
+#include <QString>
+#include "imageencoder.h"
+
+// 按内容寻址的截图存储：以解码后像素的64位哈希为名，放在
+// $XDG_DATA_HOME/ScreenshotLinux/objects/ab/cdef0123456789.png，相同内容只编码、只存一份
+// 保存的文件和历史记录都是指向对象的硬链接，对象不再被任何链接引用时删除
+// 哈希直接在已经合成好的截图上计算，不需要再解码一次
+// 对象和目标不在同一文件系统等无法硬链接的情况下退回直接写文件
+namespace ContentStore {
+
+// $XDG_DATA_HOME/ScreenshotLinux/objects
+QString defaultDirectory();
+// 配置文件 [storage] dedup，默认打开
+bool enabledInSettings();
+
+// 像素内容的哈希，尺寸和格式也参与计算；只与像素有关，与是否为视图、行宽无关
+quint64 pixelHash(const QImage &image);
+
+QString objectPath(quint64 hash, ImageEncoder::Profile profile, const QString &root = defaultDirectory());
+
+// 已有相同内容的对象时直接返回路径，否则编码写入；失败返回空字符串
+// 对象写入后是只读的，可写的对象视为可能被修改过，重新写入；同一哈希并发调用时只编码一次
+QString store(const QImage &image, quint64 hash, ImageEncoder::Profile profile, bool *created = nullptr,
+              const QString &root = defaultDirectory());
+
+// 在target处创建指向object的硬链接，原子替换已有的文件；无法链接时返回false
+bool link(const QString &object, const QString &target);
+
+// 对象只剩自身这一个链接时删除
+void release(const QString &object);
+
+// 删除所有不再被引用的对象，返回删除的个数
+int collectGarbage(const QString &root = defaultDirectory());
+
+// 保存截图到target：与对象在同一文件系统时存为对象的硬链接，否则直接编码写入
+bool save(const QImage &image, const QString &target, ImageEncoder::Profile profile,
+          const QString &root = defaultDirectory());
+
+} // namespace ContentStore
+
+#endif // CONTENTSTORE_H
@@ -0,0 +1,73 @@
+#include "diffcommand.h"
+#include "commandline.h"
+#include "historystore.h"
+#include "imagediff.h"
+#include "imageencoder.h"
+#include <QGuiApplication>
+#include <QImage>
+#include <QSaveFile>
+#include <cstdio>
+#include <future>
+
+namespace DiffCommand {
+
+int run(int argc, char *argv[], const CommandLineOptions &options, const QElapsedTimer &startupTimer)
+{
+    // 只读写图片文件，不连接显示服务器
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    qputenv("QT_QPA_PLATFORMTHEME", "");
+    QGuiApplication app(argc, argv);
+    const double startupMs = startupTimer.nsecsElapsed() / 1e6;
+
+    // 两张图同时解码，PNG解码通常比比较本身慢得多
+    QElapsedTimer timer;
+    timer.start();
+    auto load = [](const QString &path) {
+        return QImage(path);
+    };
+    std::future<QImage> second = std::async(std::launch::async, load, options.diffFiles.at(1));
+    const QImage first = load(options.diffFiles.at(0));
+    const QImage secondImage = second.get();
+    const double loadMs = timer.nsecsElapsed() / 1e6;
+    if (first.isNull() || secondImage.isNull()) {
+        std::fprintf(stderr, "无法读取图片: %s\n", qPrintable(options.diffFiles.at(first.isNull() ? 0 : 1)));
+        return 2;
+    }
+
+    timer.restart();
+    const bool highlight = !options.output.isEmpty();
+    const ImageDiff::Result result = ImageDiff::compare(first, secondImage, options.tolerance, highlight);
+    const double compareMs = timer.nsecsElapsed() / 1e6;
+    // 与截图历史相同的感知哈希，距离可以直接与 history-similar 的结果对照
+    const int hashDistance = ImageDiff::distance(HistoryStore::perceptualHash(first), HistoryStore::perceptualHash(secondImage));
+
+    // 第一行是摘要，之后每行一个区域 x,y,w,h，便于脚本处理
+    std::fprintf(stdout, "%s: pixels=%lld regions=%d hash_distance=%d\n",
+                 result.identical() ? "identical" : "different", result.changedPixels,
+                 int(result.regions.size()), hashDistance);
+    for (const QRect &region : result.regions) {
+        std::fprintf(stdout, "%d,%d,%d,%d\n", region.x(), region.y(), region.width(), region.height());
+    }
+
+    double encodeMs = 0;
+    if (highlight) {
+        timer.restart();
+        QSaveFile out(options.output);
+        if (!out.open(QIODevice::WriteOnly) ||
+            !ImageEncoder::encode(result.highlighted, &out, ImageEncoder::profileForFileName(options.output)) ||
+            !out.commit()) {
+            std::fprintf(stderr, "无法写入对比图: %s\n", qPrintable(options.output));
+            return 2;
+        }
+        encodeMs = timer.nsecsElapsed() / 1e6;
+    }
+    if (options.timings) {
+        std::fprintf(stderr, "timings: startup=%.2fms load=%.2fms compare=%.2fms encode=%.2fms\n",
+                     startupMs, loadMs, compareMs, encodeMs);
+    }
+    return result.identical() ? 0 : 1;
+}
+
+} // namespace DiffCommand
@@ -0,0 +1,16 @@
+#ifndef DIFFCOMMAND_H
+#define DIFFCOMMAND_H
+
+#include <QElapsedTimer>
+
+struct CommandLineOptions;
+
+// 命令行图片比较：--diff a.png b.png，在标准输出列出变化区域，可选写出对比图（见ImageDiff）
+namespace DiffCommand {
+
+// 相同返回0，不同返回1，读写失败返回2
+int run(int argc, char *argv[], const CommandLineOptions &options, const QElapsedTimer &startupTimer);
+
+} // namespace DiffCommand
+
+#endif // DIFFCOMMAND_H
@@ -0,0 +1,229 @@
+#include "edgemap.h"
+#include "logging.h"
+#include "parallelrows.h"
+#include "trace.h"
+#include <QElapsedTimer>
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+// 量化后的梯度达到该值算强边缘，约等于相邻像素亮度差16
+const int kStrongEdge = 4;
+const int kMaxLevel = 15;
+// 边界至少要连续覆盖跨度的这个比例，才算值得吸附
+const int kMinCoverageDivisor = 3;
+const int kMinRun = 8;
+
+// 一行像素转亮度，整数近似 0.30R + 0.59G + 0.11B；按块读取，未分配的块按黑色处理
+void lumaRow(const TiledImage &image, int y, quint8 *out)
+{
+    for (const TiledImage::Span &span : image.spans(QRect(0, y, image.width(), 1))) {
+        quint8 *dst = out + span.rect.left();
+        const int count = span.rect.width();
+        const QRgb *in = span.scanLine(y);
+        if (!in) {
+            std::fill_n(dst, count, quint8(0));
+            continue;
+        }
+        for (int x = 0; x < count; ++x) {
+            const QRgb p = in[x];
+            dst[x] = quint8((qRed(p) * 77 + qGreen(p) * 150 + qBlue(p) * 29) >> 8);
+        }
+    }
+}
+
+} // namespace
+
+EdgeMap EdgeMap::build(const TiledImage &image, int threadCount)
+{
+    TRACE_SCOPE("capture.edgeMap");
+    EdgeMap map;
+    if (image.width() < 3 || image.height() < 3) {
+        return map;
+    }
+    QElapsedTimer timer;
+    timer.start();
+
+    // 分块截图总是32位格式，不需要转换
+    const TiledImage &pixels = image;
+    const int width = pixels.width();
+    const int height = pixels.height();
+    map.m_width = width;
+    map.m_height = height;
+    map.m_edges.reset(new quint8[size_t(width) * size_t(height)]);
+    std::fill_n(map.m_edges.get(), width, quint8(0));
+    std::fill_n(map.m_edges.get() + size_t(height - 1) * size_t(width), width, quint8(0));
+    map.m_rowStrong.assign(size_t(height), 0);
+    map.m_columnStrong.assign(size_t(width), 0);
+
+    // 默认留出一个核心给界面线程
+    threadCount = ParallelRows::threadCount(height, threadCount, 1);
+
+    // 每个线程有自己的列计数，最后合并，避免线程间写同一块内存
+    std::vector<std::vector<quint32>> columnCounts(size_t(threadCount), std::vector<quint32>(size_t(width), 0));
+    const int innerRows = height - 2;
+
+    auto work = [&](int band) {
+        const int begin = 1 + innerRows * band / threadCount;
+        const int end = 1 + innerRows * (band + 1) / threadCount;
+        quint32 *columns = columnCounts[size_t(band)].data();
+
+        // 滚动保存上中下三行亮度，分块边界多算一行，不依赖其他线程
+        std::vector<quint8> luma(size_t(width) * 3);
+        quint8 *above = luma.data();
+        quint8 *middle = above + width;
+        quint8 *below = middle + width;
+        lumaRow(pixels, begin - 1, above);
+        lumaRow(pixels, begin, middle);
+
+        const int lastColumn = width - 1;
+        for (int y = begin; y < end; ++y) {
+            lumaRow(pixels, y + 1, below);
+            quint8 *edges = map.m_edges.get() + size_t(y) * size_t(width);
+            edges[0] = 0;
+            edges[lastColumn] = 0;
+
+            // 简单的整数循环，没有分支，编译器可以自动向量化；
+            // 梯度和计数分成两个循环，否则指针别名检查太多，编译器放弃向量化
+            for (int x = 1; x < lastColumn; ++x) {
+                const int gx = (above[x + 1] - above[x - 1]) + 2 * (middle[x + 1] - middle[x - 1])
+                             + (below[x + 1] - below[x - 1]);
+                const int gy = (below[x - 1] + 2 * below[x] + below[x + 1])
+                             - (above[x - 1] + 2 * above[x] + above[x + 1]);
+                const int vx = qMin(kMaxLevel, (gx < 0 ? -gx : gx) >> 4);
+                const int hy = qMin(kMaxLevel, (gy < 0 ? -gy : gy) >> 4);
+                edges[x] = quint8((vx << 4) | hy);
+            }
+            quint32 rowCount = 0;
+            for (int x = 1; x < lastColumn; ++x) {
+                columns[x] += quint32(edges[x] >= (kStrongEdge << 4));
+                rowCount += quint32((edges[x] & 0x0f) >= kStrongEdge);
+            }
+            map.m_rowStrong[size_t(y)] = rowCount;
+
+            quint8 *recycled = above;
+            above = middle;
+            middle = below;
+            below = recycled;
+        }
+    };
+
+    ParallelRows::run(threadCount, work);
+
+    for (const std::vector<quint32> &counts : columnCounts) {
+        for (int x = 0; x < width; ++x) {
+            map.m_columnStrong[size_t(x)] += counts[size_t(x)];
+        }
+    }
+
+    qCDebug(lcCapture) << "边缘图:" << width << "x" << height << threadCount << "线程"
+                       << timer.nsecsElapsed() / 1e6 << "ms";
+    return map;
+}
+
+void EdgeMap::setCanvasScale(qreal scaleX, qreal scaleY)
+{
+    m_scaleX = scaleX;
+    m_scaleY = scaleY;
+}
+
+int EdgeMap::snap(int value, Qt::Orientation orientation, int spanBegin, int spanEnd,
+                  int maxDistance, int *distance) const
+{
+    const qreal scale = orientation == Qt::Horizontal ? m_scaleX : m_scaleY;
+    const qreal spanScale = orientation == Qt::Horizontal ? m_scaleY : m_scaleX;
+    if (scale == 1 && spanScale == 1) {
+        return snapPixels(value, orientation, spanBegin, spanEnd, maxDistance, distance);
+    }
+    const int pixel = qRound(value * scale);
+    const int snapped = snapPixels(pixel, orientation, qRound(spanBegin * spanScale), qRound(spanEnd * spanScale),
+                                   qRound(maxDistance * scale), distance);
+    if (*distance == INT_MAX) {
+        return value;
+    }
+    *distance = qRound(*distance / scale);
+    return qRound(snapped / scale);
+}
+
+int EdgeMap::snapPixels(int value, Qt::Orientation orientation, int spanBegin, int spanEnd,
+                        int maxDistance, int *distance) const
+{
+    *distance = INT_MAX;
+    if (isNull()) {
+        return value;
+    }
+
+    const bool horizontal = orientation == Qt::Horizontal;
+    const int extent = horizontal ? m_width : m_height;      // 候选所在的轴
+    const int spanExtent = horizontal ? m_height : m_width;  // 沿边界方向的轴
+    if (spanBegin > spanEnd) {
+        std::swap(spanBegin, spanEnd);
+    }
+    spanBegin = qMax(spanBegin, 0);
+    spanEnd = qMin(spanEnd, spanExtent - 1);
+    const int spanLength = spanEnd - spanBegin + 1;
+    const int required = qMax(kMinRun, spanLength / kMinCoverageDivisor);
+    if (spanLength < required) {
+        return value;
+    }
+
+    const int low = qMax(1, value - maxDistance);
+    const int high = qMin(extent - 2, value + maxDistance);
+    if (low > high) {
+        return value;
+    }
+
+    // 整列/整行的强边缘数都不够时不可能满足要求，不用逐像素统计
+    const std::vector<quint32> &profile = horizontal ? m_columnStrong : m_rowStrong;
+    int first = high + 1;
+    int last = low - 1;
+    for (int c = low; c <= high; ++c) {
+        if (profile[size_t(c)] >= quint32(required)) {
+            first = qMin(first, c);
+            last = qMax(last, c);
+        }
+    }
+    if (first > last) {
+        return value;
+    }
+
+    // 统计每个候选位置在跨度内的强边缘像素数，按行顺序访问内存
+    std::vector<int> scores(size_t(last - first + 1), 0);
+    if (horizontal) {
+        for (int y = spanBegin; y <= spanEnd; ++y) {
+            const quint8 *row = m_edges.get() + size_t(y) * size_t(m_width);
+            for (int c = first; c <= last; ++c) {
+                scores[size_t(c - first)] += row[c] >= (kStrongEdge << 4);
+            }
+        }
+    } else {
+        for (int c = first; c <= last; ++c) {
+            const quint8 *row = m_edges.get() + size_t(c) * size_t(m_width);
+            int score = 0;
+            for (int x = spanBegin; x <= spanEnd; ++x) {
+                score += (row[x] & 0x0f) >= kStrongEdge;
+            }
+            scores[size_t(c - first)] = score;
+        }
+    }
+
+    // 覆盖最多的边界优先，一样多时取更近的
+    int best = value;
+    int bestScore = required - 1;
+    int bestDistance = INT_MAX;
+    for (int c = first; c <= last; ++c) {
+        const int score = scores[size_t(c - first)];
+        const int d = qAbs(c - value);
+        if (score > bestScore || (score == bestScore && score >= required && d < bestDistance)) {
+            best = c;
+            bestScore = score;
+            bestDistance = d;
+        }
+    }
+    if (bestScore >= required) {
+        *distance = bestDistance;
+        return best;
+    }
+    return value;
+}
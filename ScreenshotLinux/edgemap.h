@@ -0,0 +1,58 @@
+#ifndef EDGEMAP_H
+#define EDGEMAP_H
+
+#include <QtGlobal>
+#include <Qt>
+#include <memory>
+#include <vector>
+#include "tiledimage.h"
+
+// 截图的边缘图，用于选区边吸附到界面元素的边界（面板、按钮、表格线）
+// Sobel梯度按方向量化到4位，两个方向合在一个字节里：竖直边界看水平梯度（高4位），
+// 水平边界看竖直梯度（低4位），4K截图约8MB；
+// 另外统计每列/每行的强边缘像素数（投影直方图），查询时先用它排除不可能的候选
+// 截图显示后在后台线程构建，构建完成前吸附只使用窗口和屏幕边
+class EdgeMap
+{
+public:
+    EdgeMap() = default;
+
+    // 按行分块多线程计算，threadCount为0时使用除界面线程外的全部核心
+    static EdgeMap build(const TiledImage &image, int threadCount = 0);
+
+    bool isNull() const { return m_width == 0; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    // 梯度强度，已量化到0..15
+    int verticalEdgeAt(int x, int y) const { return m_edges[size_t(y) * size_t(m_width) + size_t(x)] >> 4; }
+    int horizontalEdgeAt(int x, int y) const { return m_edges[size_t(y) * size_t(m_width) + size_t(x)] & 0x0f; }
+    const std::vector<quint32> &columnProfile() const { return m_columnStrong; }
+    const std::vector<quint32> &rowProfile() const { return m_rowStrong; }
+
+    // 截图按设备像素构建、调用方用画布坐标时，画布坐标乘以这个比例得到边缘图的像素；
+    // snap()的参数、返回值和距离都按画布坐标换算
+    void setCanvasScale(qreal scaleX, qreal scaleY);
+
+    // 在value两侧maxDistance内找沿[spanBegin, spanEnd]最连续的边界：
+    // Qt::Horizontal时value是x坐标、跨度是行范围，Qt::Vertical时相反
+    // 找不到时返回value，distance设为INT_MAX
+    int snap(int value, Qt::Orientation orientation, int spanBegin, int spanEnd,
+             int maxDistance, int *distance) const;
+
+private:
+    // 与snap()相同，坐标都是边缘图的像素
+    int snapPixels(int value, Qt::Orientation orientation, int spanBegin, int spanEnd,
+                   int maxDistance, int *distance) const;
+
+    int m_width = 0;
+    int m_height = 0;
+    qreal m_scaleX = 1;
+    qreal m_scaleY = 1;
+    // 不用vector，省掉整块清零；构建时每个字节都会写到
+    std::unique_ptr<quint8[]> m_edges;
+    std::vector<quint32> m_columnStrong; // 每列竖直强边缘像素数
+    std::vector<quint32> m_rowStrong;    // 每行水平强边缘像素数
+};
+
+#endif // EDGEMAP_H
@@ -0,0 +1,106 @@
+#include "fasthash.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+const quint64 kPrime1 = 11400714785074694791ULL;
+const quint64 kPrime2 = 14029467366897019727ULL;
+const quint64 kPrime3 = 1609587929392839161ULL;
+const quint64 kPrime4 = 9650029242287828579ULL;
+const quint64 kPrime5 = 2870177450012600261ULL;
+
+inline quint64 rotl(quint64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// 按小端读取，像素数据没有对齐保证，memcpy由编译器优化成一次加载
+inline quint64 read64(const uchar *p)
+{
+    quint64 value;
+    std::memcpy(&value, p, sizeof(value));
+    return qFromLittleEndian(value);
+}
+
+inline quint32 read32(const uchar *p)
+{
+    quint32 value;
+    std::memcpy(&value, p, sizeof(value));
+    return qFromLittleEndian(value);
+}
+
+inline quint64 round(quint64 acc, quint64 input)
+{
+    acc += input * kPrime2;
+    acc = rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+inline quint64 mergeRound(quint64 acc, quint64 value)
+{
+    acc ^= round(0, value);
+    return acc * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+namespace FastHash {
+
+quint64 hash64(const void *data, size_t length, quint64 seed)
+{
+    const uchar *p = static_cast<const uchar *>(data);
+    const uchar *const end = p + length;
+    quint64 hash;
+
+    if (length >= 32) {
+        // 四路独立累加，每轮32字节，相互之间没有数据依赖
+        quint64 v1 = seed + kPrime1 + kPrime2;
+        quint64 v2 = seed + kPrime2;
+        quint64 v3 = seed;
+        quint64 v4 = seed - kPrime1;
+        const uchar *const limit = end - 32;
+        do {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        hash = mergeRound(hash, v1);
+        hash = mergeRound(hash, v2);
+        hash = mergeRound(hash, v3);
+        hash = mergeRound(hash, v4);
+    } else {
+        hash = seed + kPrime5;
+    }
+    hash += quint64(length);
+
+    while (p + 8 <= end) {
+        hash ^= round(0, read64(p));
+        hash = rotl(hash, 27) * kPrime1 + kPrime4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        hash ^= quint64(read32(p)) * kPrime1;
+        hash = rotl(hash, 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    while (p < end) {
+        hash ^= quint64(*p) * kPrime5;
+        hash = rotl(hash, 11) * kPrime1;
+        ++p;
+    }
+
+    // 最后打散，使输入的每一位都影响输出的所有位
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+} // namespace FastHash
@@ -0,0 +1,15 @@
+#ifndef FASTHASH_H
+#define FASTHASH_H
+
+#include <QtGlobal>
+#include <cstddef>
+
+// 非加密的64位哈希，用于比较像素块、行是否变化，不用于安全场景
+// 算法与XXH64相同（相同输入和种子得到与xxhash库一致的结果），不依赖外部库
+namespace FastHash {
+
+quint64 hash64(const void *data, size_t length, quint64 seed = 0);
+
+} // namespace FastHash
+
+#endif // FASTHASH_H
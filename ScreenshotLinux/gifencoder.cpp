@@ -0,0 +1,376 @@
+#include "gifencoder.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const int kTransparentIndex = 255;
+const int kMaxCode = 4095;
+const int kMinCodeSize = 8; // 调色板总是256项，最小码长固定为8
+
+void appendWord(QByteArray *out, int value)
+{
+    out->append(char(value & 0xff));
+    out->append(char((value >> 8) & 0xff));
+}
+
+// 只比较RGB，XShm等后端给出的RGB32帧alpha字节不一定是0xff
+inline bool sameColor(QRgb a, QRgb b)
+{
+    return ((a ^ b) & 0x00ffffff) == 0;
+}
+
+// 5:5:5 颜色直方图的格子
+inline int binOf(QRgb color)
+{
+    return ((qRed(color) >> 3) << 10) | ((qGreen(color) >> 3) << 5) | (qBlue(color) >> 3);
+}
+
+struct Bin {
+    quint32 count;
+    quint64 red;
+    quint64 green;
+    quint64 blue;
+};
+
+// 中位切分：每次把颜色范围最大的盒子按像素数的中位数一分为二，
+// 调色板取盒子内实际颜色的加权平均，颜色少于maxColors时就是原色
+class Palette
+{
+public:
+    void build(const std::vector<QRgb> &pixels, int maxColors)
+    {
+        m_bins.assign(32768, Bin{ 0, 0, 0, 0 });
+        for (QRgb color : pixels) {
+            Bin &bin = m_bins[size_t(binOf(color))];
+            ++bin.count;
+            bin.red += quint64(qRed(color));
+            bin.green += quint64(qGreen(color));
+            bin.blue += quint64(qBlue(color));
+        }
+        std::vector<int> used;
+        for (int i = 0; i < 32768; ++i) {
+            if (m_bins[size_t(i)].count) {
+                used.push_back(i);
+            }
+        }
+
+        struct Box { size_t begin; size_t end; };
+        std::vector<Box> boxes;
+        if (!used.empty()) {
+            boxes.push_back(Box{ 0, used.size() });
+        }
+        while (int(boxes.size()) < maxColors) {
+            // 找出某个通道范围最大的盒子
+            int bestBox = -1;
+            int bestChannel = 0;
+            int bestRange = 0;
+            for (size_t b = 0; b < boxes.size(); ++b) {
+                if (boxes[b].end - boxes[b].begin < 2) {
+                    continue;
+                }
+                for (int channel = 0; channel < 3; ++channel) {
+                    int low = 31;
+                    int high = 0;
+                    for (size_t i = boxes[b].begin; i < boxes[b].end; ++i) {
+                        const int value = (used[i] >> (10 - channel * 5)) & 31;
+                        low = qMin(low, value);
+                        high = qMax(high, value);
+                    }
+                    if (high - low > bestRange) {
+                        bestRange = high - low;
+                        bestBox = int(b);
+                        bestChannel = channel;
+                    }
+                }
+            }
+            if (bestBox < 0) {
+                break;
+            }
+
+            const Box box = boxes[size_t(bestBox)];
+            const int shift = 10 - bestChannel * 5;
+            std::sort(used.begin() + box.begin, used.begin() + box.end, [shift](int a, int b) {
+                return ((a >> shift) & 31) < ((b >> shift) & 31);
+            });
+            quint64 total = 0;
+            for (size_t i = box.begin; i < box.end; ++i) {
+                total += m_bins[size_t(used[i])].count;
+            }
+            quint64 running = 0;
+            size_t split = box.begin + 1;
+            for (size_t i = box.begin; i < box.end - 1; ++i) {
+                running += m_bins[size_t(used[i])].count;
+                split = i + 1;
+                if (running * 2 >= total) {
+                    break;
+                }
+            }
+            boxes[size_t(bestBox)] = Box{ box.begin, split };
+            boxes.push_back(Box{ split, box.end });
+        }
+
+        m_colors.assign(256, qRgb(0, 0, 0));
+        m_indexOfBin.assign(32768, 0);
+        for (size_t b = 0; b < boxes.size(); ++b) {
+            quint64 count = 0;
+            quint64 red = 0;
+            quint64 green = 0;
+            quint64 blue = 0;
+            for (size_t i = boxes[b].begin; i < boxes[b].end; ++i) {
+                const Bin &bin = m_bins[size_t(used[i])];
+                count += bin.count;
+                red += bin.red;
+                green += bin.green;
+                blue += bin.blue;
+                m_indexOfBin[size_t(used[i])] = quint8(b);
+            }
+            m_colors[b] = qRgb(int(red / count), int(green / count), int(blue / count));
+        }
+    }
+
+    quint8 indexOf(QRgb color) const { return m_indexOfBin[size_t(binOf(color))]; }
+    const std::vector<QRgb> &colors() const { return m_colors; }
+
+private:
+    std::vector<Bin> m_bins;
+    std::vector<quint8> m_indexOfBin;
+    std::vector<QRgb> m_colors;
+};
+
+// 变长码按低位在前打包，每255字节一个子块
+class CodeWriter
+{
+public:
+    explicit CodeWriter(QByteArray *out) : m_out(out) {}
+
+    void write(int code, int size)
+    {
+        m_bits |= quint32(code) << m_bitCount;
+        m_bitCount += size;
+        while (m_bitCount >= 8) {
+            pushByte(quint8(m_bits & 0xff));
+            m_bits >>= 8;
+            m_bitCount -= 8;
+        }
+    }
+
+    void finish()
+    {
+        if (m_bitCount > 0) {
+            pushByte(quint8(m_bits & 0xff));
+        }
+        flushBlock();
+        m_out->append('\0'); // 块结束
+    }
+
+private:
+    void pushByte(quint8 byte)
+    {
+        m_block[m_blockSize++] = byte;
+        if (m_blockSize == 255) {
+            flushBlock();
+        }
+    }
+
+    void flushBlock()
+    {
+        if (m_blockSize > 0) {
+            m_out->append(char(m_blockSize));
+            m_out->append(reinterpret_cast<const char *>(m_block), m_blockSize);
+            m_blockSize = 0;
+        }
+    }
+
+    QByteArray *m_out;
+    quint32 m_bits = 0;
+    int m_bitCount = 0;
+    quint8 m_block[255];
+    int m_blockSize = 0;
+};
+
+// GIF的LZW压缩：字典用 [前缀码][下一个字节] 的表，码表满4096时发清除码重新开始
+void compress(const std::vector<quint8> &indices, QByteArray *out)
+{
+    const int clearCode = 1 << kMinCodeSize;
+    // 每个线程一张表（4096×256个码，2MB），不必每帧分配
+    thread_local std::vector<quint16> next;
+    next.assign(size_t(kMaxCode + 1) * 256, 0);
+
+    out->append(char(kMinCodeSize));
+    CodeWriter writer(out);
+    int codeSize = kMinCodeSize + 1;
+    int maxCode = clearCode + 1;
+    writer.write(clearCode, codeSize);
+
+    int current = -1;
+    for (quint8 value : indices) {
+        if (current < 0) {
+            current = value;
+            continue;
+        }
+        quint16 &entry = next[size_t(current) * 256 + value];
+        if (entry) {
+            current = entry;
+            continue;
+        }
+        writer.write(current, codeSize);
+        entry = quint16(++maxCode);
+        if (maxCode >= (1 << codeSize)) {
+            ++codeSize;
+        }
+        if (maxCode == kMaxCode) {
+            writer.write(clearCode, codeSize);
+            std::fill(next.begin(), next.end(), quint16(0));
+            codeSize = kMinCodeSize + 1;
+            maxCode = clearCode + 1;
+        }
+        current = value;
+    }
+    if (current >= 0) {
+        writer.write(current, codeSize);
+    }
+    writer.write(clearCode, codeSize);
+    writer.write(clearCode + 1, kMinCodeSize + 1);
+    writer.finish();
+}
+
+void appendImage(QByteArray *out, const QRect &rect, const Palette &palette, const std::vector<quint8> &indices)
+{
+    out->append(char(0x2c));
+    appendWord(out, rect.x());
+    appendWord(out, rect.y());
+    appendWord(out, rect.width());
+    appendWord(out, rect.height());
+    out->append(char(0x87)); // 局部调色板，2^(7+1) = 256项
+    for (QRgb color : palette.colors()) {
+        out->append(char(qRed(color)));
+        out->append(char(qGreen(color)));
+        out->append(char(qBlue(color)));
+    }
+    compress(indices, out);
+}
+
+// 与上一帧不同的像素的外接矩形，完全相同时返回空矩形
+QRect changedRect(const QImage &frame, const QImage &previous)
+{
+    int top = -1;
+    int bottom = -1;
+    int left = frame.width();
+    int right = -1;
+    for (int y = 0; y < frame.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(frame.constScanLine(y));
+        const QRgb *old = reinterpret_cast<const QRgb *>(previous.constScanLine(y));
+        if (std::memcmp(line, old, size_t(frame.width()) * sizeof(QRgb)) == 0) {
+            continue;
+        }
+        int first = 0;
+        while (first < frame.width() && sameColor(line[first], old[first])) {
+            ++first;
+        }
+        if (first == frame.width()) {
+            continue;
+        }
+        int last = frame.width() - 1;
+        while (sameColor(line[last], old[last])) {
+            --last;
+        }
+        if (top < 0) {
+            top = y;
+        }
+        bottom = y;
+        left = qMin(left, first);
+        right = qMax(right, last);
+    }
+    return top < 0 ? QRect() : QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+} // namespace
+
+namespace GifEncoder {
+
+QByteArray header(const QSize &size)
+{
+    QByteArray out("GIF89a");
+    appendWord(&out, size.width());
+    appendWord(&out, size.height());
+    out.append(char(0x00)); // 没有全局调色板
+    out.append(char(0x00)); // 背景色
+    out.append(char(0x00)); // 像素宽高比
+    // NETSCAPE2.0扩展：循环次数0表示无限循环
+    out.append("\x21\xff\x0bNETSCAPE2.0\x03\x01", 16);
+    appendWord(&out, 0);
+    out.append('\0');
+    return out;
+}
+
+Frame encodeFrame(const QImage &image, const QImage &previousImage)
+{
+    // 截图后端给出的格式不一，统一转成32位再比较和量化；忽略alpha
+    const QImage frame = image.format() == QImage::Format_RGB32 ? image : image.convertToFormat(QImage::Format_RGB32);
+    QImage previous;
+    if (!previousImage.isNull() && previousImage.size() == frame.size()) {
+        previous = previousImage.format() == QImage::Format_RGB32 ? previousImage
+                                                                 : previousImage.convertToFormat(QImage::Format_RGB32);
+    }
+
+    Frame result;
+    QRect rect = frame.rect();
+    if (!previous.isNull()) {
+        rect = changedRect(frame, previous);
+        result.transparent = true;
+        if (rect.isEmpty()) {
+            // 没有变化：一个透明像素，只用来占住这一帧的显示时长
+            Palette empty;
+            empty.build({}, 1);
+            appendImage(&result.data, QRect(0, 0, 1, 1), empty, { quint8(kTransparentIndex) });
+            return result;
+        }
+    }
+
+    // 只用变化的像素建立调色板，透明色占最后一项
+    std::vector<QRgb> pixels;
+    pixels.reserve(size_t(rect.width()) * size_t(rect.height()));
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(frame.constScanLine(y));
+        const QRgb *old = previous.isNull() ? nullptr : reinterpret_cast<const QRgb *>(previous.constScanLine(y));
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+            if (!old || !sameColor(line[x], old[x])) {
+                pixels.push_back(line[x]);
+            }
+        }
+    }
+    Palette palette;
+    palette.build(pixels, result.transparent ? kTransparentIndex : 256);
+
+    std::vector<quint8> indices;
+    indices.reserve(size_t(rect.width()) * size_t(rect.height()));
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(frame.constScanLine(y));
+        const QRgb *old = previous.isNull() ? nullptr : reinterpret_cast<const QRgb *>(previous.constScanLine(y));
+        for (int x = rect.left(); x <= rect.right(); ++x) {
+            indices.push_back(old && sameColor(line[x], old[x]) ? quint8(kTransparentIndex) : palette.indexOf(line[x]));
+        }
+    }
+    appendImage(&result.data, rect, palette, indices);
+    return result;
+}
+
+QByteArray graphicControl(int delayCentiseconds, bool transparent)
+{
+    QByteArray out("\x21\xf9\x04", 3);
+    // 处置方式1：保留这一帧，下一帧画在它上面
+    out.append(char((1 << 2) | (transparent ? 1 : 0)));
+    appendWord(&out, qBound(0, delayCentiseconds, 0xffff));
+    out.append(char(transparent ? kTransparentIndex : 0));
+    out.append('\0');
+    return out;
+}
+
+QByteArray trailer()
+{
+    return QByteArray(1, char(0x3b));
+}
+
+} // namespace GifEncoder
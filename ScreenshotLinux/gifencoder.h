@@ -0,0 +1,33 @@
+#ifndef GIFENCODER_H
+#define GIFENCODER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QSize>
+
+// 动画GIF编码，用于录制
+// 每帧单独量化出局部调色板（中位切分，最多256色，不抖动，界面截图的纯色区域保持干净），
+// 并与上一帧比较，只编码变化像素的外接矩形；矩形内没有变化的像素写成透明，压缩得更小
+// 各帧互相独立，可以在多个线程上并行编码，再按顺序加上图形控制扩展写出
+namespace GifEncoder {
+
+// 一帧的图像描述符、局部调色板和LZW数据，不含图形控制扩展
+struct Frame {
+    QByteArray data;
+    bool transparent = false; // 是否使用透明色表示没有变化的像素
+};
+
+// GIF89a文件头（逻辑屏幕大小、无全局调色板）和无限循环的NETSCAPE2.0扩展
+QByteArray header(const QSize &size);
+
+// previous为空或尺寸不同时编码整帧；与上一帧完全相同时编码1×1的透明像素
+Frame encodeFrame(const QImage &frame, const QImage &previous);
+
+// 帧的显示时长（1/100秒）和透明色，写在该帧的数据之前；保留上一帧，不清除
+QByteArray graphicControl(int delayCentiseconds, bool transparent);
+
+QByteArray trailer();
+
+} // namespace GifEncoder
+
+#endif // GIFENCODER_H
@@ -0,0 +1,171 @@
+#include "headlesscapture.h"
+#include "commandline.h"
+#include "screencapture.h"
+#include "imageencoder.h"
+#include "captureframe.h"
+#include "recentregions.h"
+#include "trace.h"
+#include <QGuiApplication>
+#include <QFile>
+#include <QList>
+#include <QSaveFile>
+#include <cstdio>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// 重新运行时设置，避免再次选择offscreen
+const char kNoOffscreenVariable[] = "SCREENSHOT_NO_OFFSCREEN";
+
+bool g_chosenOffscreen = false;
+QList<QByteArray> g_arguments;
+
+} // namespace
+
+namespace HeadlessCapture {
+
+void preparePlatform(int argc, char *argv[], bool allowOffscreen)
+{
+    g_arguments.clear();
+    for (int i = 0; i < argc; ++i) {
+        g_arguments.append(QByteArray(argv[i]));
+    }
+    g_chosenOffscreen = allowOffscreen && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM") &&
+                        qEnvironmentVariableIsEmpty(kNoOffscreenVariable) && ScreenCapture::hasExternalRegionTool();
+    if (g_chosenOffscreen) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    qputenv("QT_QPA_PLATFORMTHEME", "");
+}
+
+void rerunWithoutOffscreen()
+{
+    if (!g_chosenOffscreen || g_arguments.isEmpty()) {
+        return;
+    }
+    std::fprintf(stderr, "外部截图工具失败，改用显示服务器重新截图\n");
+    std::fflush(stdout);
+    std::fflush(stderr);
+    qunsetenv("QT_QPA_PLATFORM");
+    qputenv(kNoOffscreenVariable, "1");
+    std::vector<char *> arguments;
+    for (QByteArray &argument : g_arguments) {
+        arguments.push_back(argument.data());
+    }
+    arguments.push_back(nullptr);
+    ::execv("/proc/self/exe", arguments.data());
+    // exec失败时按原来的结果报告
+}
+
+void checkOffscreenCapture(const QRect &region)
+{
+    if (g_chosenOffscreen && ScreenCapture::grabRegion(region).isNull()) {
+        rerunWithoutOffscreen();
+    }
+}
+
+double elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1e6;
+}
+
+ImageEncoder::Profile outputProfile(const QString &format, const QString &fileName)
+{
+    if (format == "jpg" || format == "jpeg") {
+        return ImageEncoder::Profile::Jpeg;
+    }
+    if (format == "bmp") {
+        return ImageEncoder::Profile::Bmp;
+    }
+    if (format == "png" || fileName.isEmpty() || fileName == "-") {
+        return ImageEncoder::Profile::PngSmall;
+    }
+    return ImageEncoder::profileForFileName(fileName);
+}
+
+int run(int argc, char *argv[], const CommandLineOptions &options, const QElapsedTimer &startupTimer)
+{
+    // 重复截取最近选区要比较真实的屏幕布局，不能使用offscreen
+    preparePlatform(argc, argv, !options.repeatLast);
+
+    if (!options.traceOutput.isEmpty()) {
+        Trace::setEnabled(true);
+    }
+    const int64_t processStartUs = Trace::nowUs() - startupTimer.nsecsElapsed() / 1000;
+
+    QGuiApplication app(argc, argv);
+    const double startupMs = elapsedMs(startupTimer);
+    if (Trace::isEnabled()) {
+        Trace::addComplete("app.startup", processStartUs, Trace::nowUs() - processStartUs);
+    }
+
+    QRect region = options.region;
+    if (options.repeatLast) {
+        RecentRegions recent;
+        recent.load();
+        region = recent.regionFor(RecentRegions::currentLayout());
+        if (!region.isValid()) {
+            std::fprintf(stderr, "没有与当前屏幕布局匹配的最近选区\n");
+            return 1;
+        }
+    }
+
+    QElapsedTimer stageTimer;
+    stageTimer.start();
+    QString backend;
+    const QImage image = ScreenCapture::grabRegion(region, &backend);
+    const double captureMs = elapsedMs(stageTimer);
+
+    if (image.isNull()) {
+        rerunWithoutOffscreen();
+        std::fprintf(stderr, "截图失败：没有可用的截图后端\n");
+        return 1;
+    }
+
+    stageTimer.restart();
+    ImageEncoder::Profile profile = outputProfile(options.format, options.output);
+    if (options.repeatLast && profile == ImageEncoder::Profile::PngSmall) {
+        // 与常驻实例的重复截取一致，PNG使用低压缩级别
+        profile = ImageEncoder::Profile::PngFast;
+    }
+    bool written = false;
+    if (options.output == "-") {
+        // 直接编码到标准输出，不在内存中保存完整的编码结果
+        QFile out;
+        if (out.open(stdout, QIODevice::WriteOnly)) {
+            written = ImageEncoder::encode(image, &out, profile);
+            out.flush();
+        }
+    } else {
+        QSaveFile out(options.output);
+        if (out.open(QIODevice::WriteOnly)) {
+            written = ImageEncoder::encode(image, &out, profile) && out.commit();
+        }
+    }
+    const double encodeMs = elapsedMs(stageTimer);
+
+    if (!written) {
+        std::fprintf(stderr, "无法写入截图: %s\n", qPrintable(options.output));
+        return 1;
+    }
+
+    if (Trace::isEnabled()) {
+        Trace::addComplete("app.total", processStartUs, Trace::nowUs() - processStartUs);
+        if (!Trace::writeChromeTrace(options.traceOutput)) {
+            std::fprintf(stderr, "无法写入追踪文件: %s\n", qPrintable(options.traceOutput));
+        }
+    }
+
+    if (options.timings) {
+        std::fprintf(stderr,
+                     "timings: startup=%.2fms capture=%.2fms encode=%.2fms total=%.2fms "
+                     "backend=%s platform=%s size=%dx%d copied=%lld\n",
+                     startupMs, captureMs, encodeMs, elapsedMs(startupTimer),
+                     qPrintable(backend), qPrintable(QGuiApplication::platformName()),
+                     image.width(), image.height(), CaptureFrame::bytesCopied());
+    }
+    return 0;
+}
+
+} // namespace HeadlessCapture
@@ -0,0 +1,38 @@
+#ifndef HEADLESSCAPTURE_H
+#define HEADLESSCAPTURE_H
+
+#include <QElapsedTimer>
+#include <QRect>
+#include <QString>
+#include "imageencoder.h"
+
+struct CommandLineOptions;
+
+// 无界面截图：截取区域、编码输出后立即退出
+// 不创建QApplication/托盘/遮罩窗口，只使用QGuiApplication
+namespace HeadlessCapture {
+
+// startupTimer 在main()入口启动，用于统计启动到退出的耗时
+int run(int argc, char *argv[], const CommandLineOptions &options, const QElapsedTimer &startupTimer);
+
+// 以下供各个无界面模式（截图、定时截图、录制、长截图）共用
+
+// 在创建QGuiApplication之前调用：有外部区域截图工具时不需要连接显示服务器，使用offscreen平台插件，启动最快；
+// allowOffscreen为false时（例如要比较真实的屏幕布局）使用正常的平台插件。不加载桌面环境的平台主题插件
+// 保存一份命令行参数，QGuiApplication会从argv中去掉它认识的参数
+void preparePlatform(int argc, char *argv[], bool allowOffscreen = true);
+
+// offscreen平台下只有外部工具可用；工具失败（没有权限、门户拒绝等）时去掉offscreen，
+// 用相同的参数重新运行本进程，改用Qt自带的截图方法。成功时不返回；没有使用offscreen时直接返回
+void rerunWithoutOffscreen();
+// 持续截图的模式在开始前试截一帧，失败时同上重新运行；没有使用offscreen时不截图
+void checkOffscreenCapture(const QRect &region);
+
+double elapsedMs(const QElapsedTimer &timer);
+
+// --format优先，否则按文件后缀；没有文件名或写到标准输出（"-"）时为PNG
+ImageEncoder::Profile outputProfile(const QString &format, const QString &fileName = QString());
+
+} // namespace HeadlessCapture
+
+#endif // HEADLESSCAPTURE_H
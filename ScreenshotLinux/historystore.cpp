@@ -0,0 +1,479 @@
+#include "historystore.h"
+#include "contentstore.h"
+#include "imagediff.h"
+#include "imageencoder.h"
+#include "imageops.h"
+#include "trace.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstring>
+
+// 文件格式使用本机字节序，历史只在本机使用
+struct HistoryStore::IndexHeader {
+    char magic[4];          // "SSHI"
+    quint32 version;
+    quint32 recordSize;
+    quint32 reserved;
+    quint64 first;          // 第一条保留的记录下标
+    quint64 end;            // 已写入的记录下标上界
+    quint64 nextSequence;   // 下一条截图的序号，从1开始
+    qint64 totalBytes;      // 保留的截图文件总大小
+    quint8 padding[16];
+};
+
+struct HistoryStore::IndexRecord {
+    quint64 sequence;
+    qint64 timeMs;          // 自1970年起的毫秒数
+    qint64 bytes;
+    qint32 width;
+    qint32 height;
+    quint64 contentHash;    // 文件是内容存储中对象的硬链接时为对象的哈希，否则为0
+    char fileName[80];      // files/ 下的文件名，UTF-8，以0结尾
+    quint64 perceptualHash; // 缩略图的dHash；第1版中是文件名的最后8字节，升级时清为0
+};
+
+struct HistoryStore::ThumbnailHeader {
+    char magic[4];          // "SSHT"
+    quint32 version;
+    quint32 slots;
+    quint16 width;
+    quint16 height;
+    quint8 padding[16];
+};
+
+struct HistoryStore::ThumbnailSlot {
+    quint64 sequence;       // 占用这个槽位的截图序号，0为空
+    qint32 width;
+    qint32 height;
+    quint8 padding[16];
+    QRgb pixels[ThumbnailWidth * ThumbnailHeight]; // 预乘ARGB，行宽固定为ThumbnailWidth
+};
+
+namespace {
+
+const char kSettingsName[] = "ScreenshotLinux";
+const char kIndexMagic[4] = { 'S', 'S', 'H', 'I' };
+const char kThumbnailMagic[4] = { 'S', 'S', 'H', 'T' };
+// 索引第2版在记录末尾加了感知哈希，记录大小不变，第1版的索引打开时原地升级
+const quint32 kIndexVersion = 2;
+const quint32 kLegacyIndexVersion = 1;
+const quint32 kThumbnailVersion = 1;
+// 索引按这么多条记录一次扩大，避免每次追加都重新映射
+const qint64 kGrowRecords = 256;
+// 跳过的记录达到这么多且超过一半时重写索引
+const quint64 kCompactThreshold = 1024;
+
+} // namespace
+
+QString HistoryStore::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/ScreenshotLinux/history";
+}
+
+bool HistoryStore::enabledInSettings()
+{
+    QSettings settings(kSettingsName, kSettingsName);
+    return settings.value("history/enabled", true).toBool();
+}
+
+HistoryStore::Retention HistoryStore::retentionFromSettings()
+{
+    QSettings settings(kSettingsName, kSettingsName);
+    Retention retention;
+    retention.maxEntries = qMax(1, settings.value("history/maxEntries", retention.maxEntries).toInt());
+    retention.maxBytes = qMax<qint64>(1, settings.value("history/maxMegabytes", retention.maxBytes >> 20).toLongLong()) << 20;
+    return retention;
+}
+
+HistoryStore::HistoryStore(const QString &directory)
+    : m_directory(directory)
+    , m_contentDirectory(ContentStore::defaultDirectory())
+{
+}
+
+HistoryStore::~HistoryStore()
+{
+    close();
+}
+
+bool HistoryStore::open()
+{
+    static_assert(sizeof(IndexHeader) == 64, "索引文件头应为64字节");
+    static_assert(sizeof(IndexRecord) == 128, "索引记录应为128字节");
+    static_assert(sizeof(ThumbnailHeader) == 32, "图集文件头应为32字节");
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_index && m_thumbnails) {
+        return true;
+    }
+    TRACE_SCOPE("history.open");
+    if (!QDir().mkpath(m_directory + "/files")) {
+        return false;
+    }
+
+    // 索引：只检查文件头，不读取任何记录
+    m_indexFile.setFileName(m_directory + "/index.bin");
+    if (!m_indexFile.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    const qint64 indexSize = m_indexFile.size();
+    bool valid = indexSize >= qint64(sizeof(IndexHeader)) && mapIndex(indexSize);
+    if (valid) {
+        const IndexHeader *header = indexHeader();
+        valid = std::memcmp(header->magic, kIndexMagic, 4) == 0 &&
+                (header->version == kIndexVersion || header->version == kLegacyIndexVersion) &&
+                header->recordSize == sizeof(IndexRecord) && header->first <= header->end &&
+                qint64(sizeof(IndexHeader) + header->end * sizeof(IndexRecord)) <= indexSize;
+    }
+    if (valid && indexHeader()->version == kLegacyIndexVersion) {
+        // 第1版的文件名字段长88字节，程序生成的文件名远短于80字节；旧记录没有感知哈希
+        IndexHeader *header = indexHeader();
+        for (quint64 position = header->first; position < header->end; ++position) {
+            IndexRecord *legacy = record(position);
+            legacy->fileName[sizeof(legacy->fileName) - 1] = 0;
+            legacy->perceptualHash = 0;
+        }
+        header->version = kIndexVersion;
+    }
+    if (!valid) {
+        if (m_index) {
+            m_indexFile.unmap(m_index);
+            m_index = nullptr;
+        }
+        m_indexFile.resize(0);
+        if (!mapIndex(qint64(sizeof(IndexHeader)) + kGrowRecords * qint64(sizeof(IndexRecord)))) {
+            m_indexFile.close();
+            return false;
+        }
+        IndexHeader *header = indexHeader();
+        std::memset(header, 0, sizeof(IndexHeader));
+        std::memcpy(header->magic, kIndexMagic, 4);
+        header->version = kIndexVersion;
+        header->recordSize = sizeof(IndexRecord);
+        header->nextSequence = 1;
+    }
+
+    if (!mapThumbnails()) {
+        m_indexFile.unmap(m_index);
+        m_index = nullptr;
+        m_indexFile.close();
+        return false;
+    }
+    return true;
+}
+
+void HistoryStore::close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_index) {
+        m_indexFile.unmap(m_index);
+        m_index = nullptr;
+    }
+    m_indexFile.close();
+    if (m_thumbnails) {
+        m_thumbnailFile.unmap(m_thumbnails);
+        m_thumbnails = nullptr;
+    }
+    m_thumbnailFile.close();
+}
+
+bool HistoryStore::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index && m_thumbnails;
+}
+
+void HistoryStore::setRetention(const Retention &retention)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_retention = retention;
+    if (m_index) {
+        applyRetention();
+    }
+}
+
+int HistoryStore::count() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index ? int(indexHeader()->end - indexHeader()->first) : 0;
+}
+
+qint64 HistoryStore::totalBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index ? indexHeader()->totalBytes : 0;
+}
+
+HistoryStore::Entry HistoryStore::entry(int index) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_index || index < 0 || quint64(index) >= indexHeader()->end - indexHeader()->first) {
+        return Entry();
+    }
+    return entryFromRecord(*record(indexHeader()->end - 1 - quint64(index)));
+}
+
+QImage HistoryStore::thumbnail(int index) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_index || !m_thumbnails || index < 0 || quint64(index) >= indexHeader()->end - indexHeader()->first) {
+        return QImage();
+    }
+    return thumbnailFor(record(indexHeader()->end - 1 - quint64(index))->sequence);
+}
+
+QVector<HistoryStore::Recent> HistoryStore::recent(int maxCount) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    QVector<Recent> items;
+    if (!m_index) {
+        return items;
+    }
+    const IndexHeader *header = indexHeader();
+    const quint64 count = qMin(header->end - header->first, quint64(qMax(0, maxCount)));
+    items.reserve(int(count));
+    for (quint64 i = 0; i < count; ++i) {
+        const IndexRecord *entryRecord = record(header->end - 1 - i);
+        items.append(Recent{ entryFromRecord(*entryRecord), m_thumbnails ? thumbnailFor(entryRecord->sequence) : QImage() });
+    }
+    return items;
+}
+
+QImage HistoryStore::thumbnailFor(quint64 sequence) const
+{
+    const ThumbnailSlot *thumbnail = slot(sequence);
+    if (thumbnail->sequence != sequence || thumbnail->width <= 0 || thumbnail->height <= 0) {
+        return QImage();
+    }
+    // 映射的内存随后可能被新的截图覆盖，交出去的是副本（一张缩略图只有几十KB）
+    return QImage(reinterpret_cast<const uchar *>(thumbnail->pixels), thumbnail->width, thumbnail->height,
+                  ThumbnailWidth * 4, QImage::Format_ARGB32_Premultiplied).copy();
+}
+
+quint64 HistoryStore::perceptualHash(const QImage &image)
+{
+    // 与add()相同，在缩略图上计算，外部的图片与历史中的截图可以直接比较
+    return ImageDiff::differenceHash(ImageOps::downscale(image, QSize(ThumbnailWidth, ThumbnailHeight)));
+}
+
+QVector<HistoryStore::Match> HistoryStore::findSimilar(quint64 hash, int maxDistance, quint64 excludeSequence) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    QVector<Match> matches;
+    if (!m_index) {
+        return matches;
+    }
+    TRACE_SCOPE("history.similar");
+    // 每条记录只读8字节的哈希算一次popcount，保留的历史只有几百条，线性扫描映射的索引即可
+    const IndexHeader *header = indexHeader();
+    for (quint64 position = header->end; position > header->first; --position) {
+        const IndexRecord *candidate = record(position - 1);
+        if (candidate->sequence == excludeSequence) {
+            continue;
+        }
+        const int distance = ImageDiff::distance(hash, candidate->perceptualHash);
+        if (distance <= maxDistance) {
+            matches.append(Match{ entryFromRecord(*candidate), distance });
+        }
+    }
+    // 距离相同时新的在前
+    std::stable_sort(matches.begin(), matches.end(), [](const Match &a, const Match &b) {
+        return a.distance < b.distance;
+    });
+    return matches;
+}
+
+bool HistoryStore::add(const QImage &image, const QDateTime &time, Entry *added)
+{
+    if (image.isNull()) {
+        return false;
+    }
+    TRACE_SCOPE("history.add");
+    quint64 sequence = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_index) {
+            return false;
+        }
+        sequence = indexHeader()->nextSequence++;
+    }
+
+    // 编码和缩放不持有锁，多个截图可以同时写入
+    // 打开内容存储时文件是对象的硬链接，已经保存过的相同截图不再编码
+    const QString fileName = time.toString("yyyyMMdd-HHmmss-zzz") + QString("-%1.png").arg(sequence);
+    const QString filePath = m_directory + "/files/" + fileName;
+    quint64 contentHash = 0;
+    if (m_deduplicate) {
+        const quint64 hash = ContentStore::pixelHash(image);
+        const QString object = ContentStore::store(image, hash, ImageEncoder::Profile::PngFast, nullptr, m_contentDirectory);
+        if (!object.isEmpty() && ContentStore::link(object, filePath)) {
+            contentHash = hash;
+        }
+    }
+    if (contentHash == 0) {
+        QSaveFile file(filePath);
+        if (!file.open(QIODevice::WriteOnly) ||
+            !ImageEncoder::encode(image, &file, ImageEncoder::Profile::PngFast) || !file.commit()) {
+            return false;
+        }
+    }
+    // 保留的总大小按每条记录的文件大小计算，重复的截图虽然共用一份也各算一次，删除时不会少算
+    const qint64 bytes = QFileInfo(filePath).size();
+    const QImage thumbnail = ImageOps::downscale(image, QSize(ThumbnailWidth, ThumbnailHeight));
+    const quint64 perceptual = ImageDiff::differenceHash(thumbnail);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_index || !m_thumbnails) {
+        QFile::remove(filePath);
+        return false;
+    }
+    // 记录写完再推进文件头的上界，中途退出时这条记录不可见
+    const qint64 capacity = (m_indexFile.size() - qint64(sizeof(IndexHeader))) / qint64(sizeof(IndexRecord));
+    if (qint64(indexHeader()->end) >= capacity &&
+        !mapIndex(m_indexFile.size() + kGrowRecords * qint64(sizeof(IndexRecord)))) {
+        QFile::remove(filePath);
+        return false;
+    }
+    IndexRecord *entryRecord = record(indexHeader()->end);
+    std::memset(entryRecord, 0, sizeof(IndexRecord));
+    entryRecord->sequence = sequence;
+    entryRecord->timeMs = time.toMSecsSinceEpoch();
+    entryRecord->bytes = bytes;
+    entryRecord->width = image.width();
+    entryRecord->height = image.height();
+    entryRecord->contentHash = contentHash;
+    entryRecord->perceptualHash = perceptual;
+    const QByteArray name = fileName.toUtf8();
+    std::memcpy(entryRecord->fileName, name.constData(), size_t(qMin<qsizetype>(name.size(), sizeof(entryRecord->fileName) - 1)));
+    if (added) {
+        *added = entryFromRecord(*entryRecord);
+    }
+    indexHeader()->end += 1;
+    indexHeader()->totalBytes += bytes;
+
+    // 缩略图槽位先清掉序号，写完像素再填上，读到一半写入的槽位时序号不匹配
+    ThumbnailSlot *target = slot(sequence);
+    target->sequence = 0;
+    target->width = thumbnail.width();
+    target->height = thumbnail.height();
+    for (int y = 0; y < thumbnail.height(); ++y) {
+        std::memcpy(target->pixels + y * ThumbnailWidth, thumbnail.constScanLine(y), size_t(thumbnail.width()) * 4);
+    }
+    target->sequence = sequence;
+
+    applyRetention();
+    return true;
+}
+
+bool HistoryStore::mapIndex(qint64 size)
+{
+    if (m_index) {
+        m_indexFile.unmap(m_index);
+        m_index = nullptr;
+    }
+    if (m_indexFile.size() < size && !m_indexFile.resize(size)) {
+        return false;
+    }
+    m_index = m_indexFile.map(0, size);
+    return m_index != nullptr;
+}
+
+bool HistoryStore::mapThumbnails()
+{
+    // 图集大小固定，新建时是稀疏文件，只有写过的槽位占用磁盘
+    const qint64 size = qint64(sizeof(ThumbnailHeader)) + qint64(ThumbnailSlots) * qint64(sizeof(ThumbnailSlot));
+    m_thumbnailFile.setFileName(m_directory + "/thumbs.bin");
+    if (!m_thumbnailFile.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    const bool exists = m_thumbnailFile.size() == size;
+    if (!exists) {
+        m_thumbnailFile.resize(0);
+        if (!m_thumbnailFile.resize(size)) {
+            m_thumbnailFile.close();
+            return false;
+        }
+    }
+    m_thumbnails = m_thumbnailFile.map(0, size);
+    if (!m_thumbnails) {
+        m_thumbnailFile.close();
+        return false;
+    }
+    ThumbnailHeader *header = reinterpret_cast<ThumbnailHeader *>(m_thumbnails);
+    const bool valid = exists && std::memcmp(header->magic, kThumbnailMagic, 4) == 0 && header->version == kThumbnailVersion &&
+                       header->slots == ThumbnailSlots && header->width == ThumbnailWidth &&
+                       header->height == ThumbnailHeight;
+    if (!valid) {
+        std::memset(m_thumbnails, 0, size_t(size));
+        std::memcpy(header->magic, kThumbnailMagic, 4);
+        header->version = kThumbnailVersion;
+        header->slots = ThumbnailSlots;
+        header->width = ThumbnailWidth;
+        header->height = ThumbnailHeight;
+    }
+    return true;
+}
+
+HistoryStore::IndexHeader *HistoryStore::indexHeader() const
+{
+    return reinterpret_cast<IndexHeader *>(m_index);
+}
+
+HistoryStore::IndexRecord *HistoryStore::record(quint64 position) const
+{
+    return reinterpret_cast<IndexRecord *>(m_index + sizeof(IndexHeader)) + position;
+}
+
+HistoryStore::ThumbnailSlot *HistoryStore::slot(quint64 sequence) const
+{
+    return reinterpret_cast<ThumbnailSlot *>(m_thumbnails + sizeof(ThumbnailHeader)) + sequence % ThumbnailSlots;
+}
+
+HistoryStore::Entry HistoryStore::entryFromRecord(const IndexRecord &record) const
+{
+    Entry entry;
+    entry.sequence = record.sequence;
+    entry.time = QDateTime::fromMSecsSinceEpoch(record.timeMs);
+    entry.filePath = m_directory + "/files/" +
+                     QString::fromUtf8(record.fileName, int(qstrnlen(record.fileName, sizeof(record.fileName))));
+    entry.size = QSize(record.width, record.height);
+    entry.bytes = record.bytes;
+    entry.perceptualHash = record.perceptualHash;
+    return entry;
+}
+
+void HistoryStore::applyRetention()
+{
+    IndexHeader *header = indexHeader();
+    // 至少保留最新的一条，即使它本身就超过了大小上限
+    while (header->end - header->first > 1 &&
+           (header->end - header->first > quint64(m_retention.maxEntries) || header->totalBytes > m_retention.maxBytes)) {
+        const IndexRecord *oldestRecord = record(header->first);
+        const Entry oldest = entryFromRecord(*oldestRecord);
+        QFile::remove(oldest.filePath);
+        if (oldestRecord->contentHash != 0) {
+            ContentStore::release(ContentStore::objectPath(oldestRecord->contentHash, ImageEncoder::Profile::PngFast,
+                                                          m_contentDirectory));
+        }
+        header->totalBytes -= oldest.bytes;
+        header->first += 1;
+    }
+    if (header->first >= kCompactThreshold && header->first * 2 >= header->end) {
+        compact();
+    }
+}
+
+void HistoryStore::compact()
+{
+    TRACE_SCOPE("history.compact");
+    // 保留的记录不多于跳过的记录，搬到开头时源和目标不重叠；
+    // 文件头最后更新，搬到一半退出时旧的记录仍然完整
+    IndexHeader *header = indexHeader();
+    const quint64 live = header->end - header->first;
+    std::memcpy(record(0), record(header->first), size_t(live) * sizeof(IndexRecord));
+    header->end = live;
+    header->first = 0;
+}
@@ -0,0 +1,115 @@
+#ifndef HISTORYSTORE_H
+#define HISTORYSTORE_H
+
+#include <QDateTime>
+#include <QFile>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <QVector>
+#include <mutex>
+
+// 截图历史：复制或保存过的截图留一份在 $XDG_DATA_HOME/ScreenshotLinux/history 下
+//   index.bin   只追加的定长记录，整个文件内存映射，打开时只读文件头，
+//               条数、总字节数都在文件头里，与历史长度无关
+//   thumbs.bin  定长槽位的缩略图图集，同样内存映射，按序号轮流使用槽位，
+//               托盘菜单直接从映射的内存取缩略图，不解码原图
+//               每条记录带缩略图的感知哈希，查找近似的截图只扫描索引
+//   files/      截图文件本身，内容相同的截图是同一个对象的硬链接（见ContentStore）
+// 超出条数或总大小的上限时从最旧的开始删除：文件头的起始下标后移，
+// 被跳过的记录积累到一半以上时才重写索引，均摊O(1)
+// 可以在多个线程上同时调用，add()的编码和缩放在调用线程上进行，只有追加记录时加锁
+class HistoryStore
+{
+public:
+    enum { ThumbnailWidth = 128, ThumbnailHeight = 80, ThumbnailSlots = 256 };
+
+    struct Entry {
+        quint64 sequence = 0;
+        QDateTime time;
+        QString filePath;
+        QSize size;
+        qint64 bytes = 0;
+        quint64 perceptualHash = 0; // 缩略图的dHash（见ImageDiff），升级前写入的记录为0
+    };
+
+    struct Match {
+        Entry entry;      // 查找时的记录，不用下标：其他线程追加截图后下标会移动
+        int distance = 0; // 感知哈希的汉明距离
+    };
+
+    struct Recent {
+        Entry entry;
+        QImage thumbnail; // 槽位已被更新的截图占用时为空
+    };
+
+    struct Retention {
+        int maxEntries = 200;
+        qint64 maxBytes = 512ll * 1024 * 1024;
+    };
+
+    // $XDG_DATA_HOME/ScreenshotLinux/history
+    static QString defaultDirectory();
+    // 配置文件 [history]：enabled、maxEntries、maxMegabytes
+    static bool enabledInSettings();
+    static Retention retentionFromSettings();
+
+    explicit HistoryStore(const QString &directory = defaultDirectory());
+    ~HistoryStore();
+
+    // 打开或创建索引和缩略图图集；文件头不符时重建（历史丢失，截图文件不删除）
+    bool open();
+    void close();
+    bool isOpen() const;
+    QString directory() const { return m_directory; }
+
+    void setRetention(const Retention &retention);
+    // 截图文件存为内容存储中对象的硬链接（见ContentStore），相同的截图只存一份；默认打开
+    void setDeduplicate(bool deduplicate) { m_deduplicate = deduplicate; }
+    // 内容存储的对象目录，默认ContentStore::defaultDirectory()；在open()之前设置
+    void setContentDirectory(const QString &directory) { m_contentDirectory = directory; }
+
+    int count() const;       // 保留的条数
+    qint64 totalBytes() const; // 保留的截图文件总大小
+    Entry entry(int index) const; // 0为最新的一条
+    // 缩略图的副本；槽位已被更新的截图占用时返回空图像
+    QImage thumbnail(int index) const;
+    // 最新的最多maxCount条及其缩略图，在同一次加锁中读取，条目和缩略图不会错位
+    QVector<Recent> recent(int maxCount) const;
+
+    // 与记录中相同算法的感知哈希，用于把任意图片和历史比较
+    static quint64 perceptualHash(const QImage &image);
+    // 感知哈希距离不超过maxDistance的记录，按距离从近到远；excludeSequence用于排除作为查询的那一条
+    QVector<Match> findSimilar(quint64 hash, int maxDistance, quint64 excludeSequence = 0) const;
+
+    // 编码保存截图、生成缩略图并追加一条记录，按保留策略删除旧的；在调用线程上完成
+    bool add(const QImage &image, const QDateTime &time = QDateTime::currentDateTime(), Entry *added = nullptr);
+
+private:
+    struct IndexHeader;
+    struct IndexRecord;
+    struct ThumbnailHeader;
+    struct ThumbnailSlot;
+
+    bool mapIndex(qint64 size);
+    bool mapThumbnails();
+    IndexHeader *indexHeader() const;
+    IndexRecord *record(quint64 position) const;
+    ThumbnailSlot *slot(quint64 sequence) const;
+    Entry entryFromRecord(const IndexRecord &record) const;
+    QImage thumbnailFor(quint64 sequence) const; // 调用方已加锁
+    void applyRetention();
+    void compact();
+
+    QString m_directory;
+    Retention m_retention;
+    bool m_deduplicate = true;
+    QString m_contentDirectory;
+    mutable std::mutex m_mutex;
+    QFile m_indexFile;
+    uchar *m_index = nullptr;
+    QFile m_thumbnailFile;
+    uchar *m_thumbnails = nullptr;
+};
+
+#endif // HISTORYSTORE_H
@@ -0,0 +1,258 @@
+#include "imagediff.h"
+#include "parallelrows.h"
+#include "trace.h"
+#include <QPainter>
+#include <climits>
+#include <vector>
+
+namespace {
+
+// 变化的像素标成红色，区域框用深一些的红色
+const QRgb kHighlight = 0xffff2020;
+const QRgb kFrame = 0xffc00000;
+
+// 截图都是这两种格式，其他格式先转换
+QImage to32Bit(const QImage &image)
+{
+    if (image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32_Premultiplied) {
+        return image;
+    }
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+// 一个格子内变化像素的范围，right < 0 表示没有变化
+struct Cell {
+    int left = INT_MAX;
+    int top = INT_MAX;
+    int right = -1;
+    int bottom = -1;
+};
+
+} // namespace
+
+namespace ImageDiff {
+
+quint64 differenceHash(const QImage &image)
+{
+    if (image.isNull()) {
+        return 0;
+    }
+    // 9×8个格子，每格是对应源矩形亮度的平均值；比9×8还小的图先放大，保证每格至少有一个像素
+    enum { Columns = 9, Rows = 8 };
+    QImage pixels = to32Bit(image);
+    if (pixels.width() < Columns || pixels.height() < Rows) {
+        pixels = pixels.scaled(qMax(int(Columns), pixels.width()), qMax(int(Rows), pixels.height()));
+    }
+    const int width = pixels.width();
+    const int height = pixels.height();
+
+    std::vector<int> column(size_t(width), 0);
+    for (int x = 0; x < width; ++x) {
+        column[size_t(x)] = int(qint64(x) * Columns / width);
+    }
+    quint64 sums[Rows][Columns] = {};
+    quint64 counts[Rows][Columns] = {};
+    for (int y = 0; y < height; ++y) {
+        const int row = int(qint64(y) * Rows / height);
+        const quint32 *line = reinterpret_cast<const quint32 *>(pixels.constScanLine(y));
+        for (int x = 0; x < width; ++x) {
+            const quint32 pixel = line[x];
+            // BT.601亮度的整数近似
+            sums[row][column[size_t(x)]] += ((pixel >> 16) & 0xff) * 77 + ((pixel >> 8) & 0xff) * 150 + (pixel & 0xff) * 29;
+            counts[row][column[size_t(x)]] += 1;
+        }
+    }
+
+    quint64 hash = 0;
+    for (int row = 0; row < Rows; ++row) {
+        for (int x = 0; x < Columns - 1; ++x) {
+            // 比较平均值时交叉相乘，不做除法
+            const bool brighter = sums[row][x] * counts[row][x + 1] > sums[row][x + 1] * counts[row][x];
+            hash = (hash << 1) | quint64(brighter);
+        }
+    }
+    return hash;
+}
+
+int distance(quint64 first, quint64 second)
+{
+    return __builtin_popcountll(first ^ second);
+}
+
+Result compare(const QImage &first, const QImage &second, int tolerance, bool highlight, int threadCount)
+{
+    TRACE_SCOPE("diff.compare");
+    Result result;
+    if (first.isNull() || second.isNull()) {
+        return result;
+    }
+    const QImage a = to32Bit(first);
+    const QImage b = to32Bit(second);
+    const int width = qMin(a.width(), b.width());
+    const int height = qMin(a.height(), b.height());
+    const QSize full(qMax(a.width(), b.width()), qMax(a.height(), b.height()));
+    result.size = QSize(width, height);
+    tolerance = qBound(0, tolerance, 255);
+    // 任一张是不透明格式时alpha字节可能是任意值，不参与比较
+    const quint32 alphaMask = a.format() == QImage::Format_RGB32 || b.format() == QImage::Format_RGB32 ? 0u : 0xff000000u;
+
+    // 两张图不重合的部分在对比图中整块标红
+    if (highlight) {
+        result.highlighted = QImage(full, QImage::Format_RGB32);
+        if (full != result.size) {
+            result.highlighted.fill(kHighlight);
+        }
+    }
+
+    const int cellColumns = (width + CellSize - 1) / CellSize;
+    const int cellRows = (height + CellSize - 1) / CellSize;
+    std::vector<Cell> cells(size_t(cellColumns) * size_t(cellRows));
+
+    threadCount = ParallelRows::threadCount(height, threadCount);
+    threadCount = qMin(threadCount, qMax(1, cellRows));
+    std::vector<qint64> changed(size_t(threadCount), 0);
+    // 在开线程之前取对比图的指针，scanLine()会检查分离，不能在多个线程上同时调用
+    uchar *const outBits = highlight ? result.highlighted.bits() : nullptr;
+    const qsizetype outStride = highlight ? result.highlighted.bytesPerLine() : 0;
+
+    // 每个线程负责整行的格子，只写自己的格子和对比图中自己的行，不需要加锁
+    auto work = [&](int band) {
+        const int firstCellRow = cellRows * band / threadCount;
+        const int endCellRow = cellRows * (band + 1) / threadCount;
+        const int begin = firstCellRow * CellSize;
+        const int end = qMin(height, endCellRow * CellSize);
+        std::vector<quint8> mask(size_t(width), 0);
+        quint8 *const flags = mask.data();
+        const int columns = width;
+        const int threshold = tolerance;
+        const quint32 alpha = alphaMask;
+        qint64 count = 0;
+
+        for (int y = begin; y < end; ++y) {
+            const quint32 *left = reinterpret_cast<const quint32 *>(a.constScanLine(y));
+            const quint32 *right = reinterpret_cast<const quint32 *>(b.constScanLine(y));
+
+            // 各通道差的最大值与容差比较，结果写成0或0xff；
+            // 简单的整数循环，没有分支，编译器可以自动向量化
+            for (int x = 0; x < columns; ++x) {
+                const quint32 p = left[x];
+                const quint32 q = right[x];
+                const int db = int(p & 0xff) - int(q & 0xff);
+                const int dg = int((p >> 8) & 0xff) - int((q >> 8) & 0xff);
+                const int dr = int((p >> 16) & 0xff) - int((q >> 16) & 0xff);
+                const int da = int((p & alpha) >> 24) - int((q & alpha) >> 24);
+                const int mb = db < 0 ? -db : db;
+                const int mg = dg < 0 ? -dg : dg;
+                const int mr = dr < 0 ? -dr : dr;
+                const int ma = da < 0 ? -da : da;
+                const int m = qMax(qMax(mb, mg), qMax(mr, ma));
+                flags[x] = quint8(m > threshold ? 0xff : 0);
+            }
+            quint32 rowCount = 0;
+            for (int x = 0; x < columns; ++x) {
+                rowCount += flags[x] & 1u;
+            }
+            count += rowCount;
+
+            // 只有这一行有变化时才逐格查找变化的列范围
+            if (rowCount > 0) {
+                Cell *cellRow = cells.data() + size_t(y / CellSize) * size_t(cellColumns);
+                for (int column = 0; column < cellColumns; ++column) {
+                    const int x0 = column * CellSize;
+                    const int x1 = qMin(width, x0 + CellSize);
+                    quint32 any = 0;
+                    for (int x = x0; x < x1; ++x) {
+                        any |= flags[x];
+                    }
+                    if (!any) {
+                        continue;
+                    }
+                    int firstChanged = x0;
+                    while (!flags[firstChanged]) {
+                        ++firstChanged;
+                    }
+                    int lastChanged = x1 - 1;
+                    while (!flags[lastChanged]) {
+                        --lastChanged;
+                    }
+                    Cell &cell = cellRow[column];
+                    cell.left = qMin(cell.left, firstChanged);
+                    cell.right = qMax(cell.right, lastChanged);
+                    cell.top = qMin(cell.top, y);
+                    cell.bottom = y;
+                }
+            }
+
+            if (highlight) {
+                // 第二张图按不透明处理、向白色变淡作底，变化的像素换成标记色
+                quint32 *out = reinterpret_cast<quint32 *>(outBits + y * outStride);
+                for (int x = 0; x < columns; ++x) {
+                    const quint32 q = right[x];
+                    const quint32 faded = 0xff000000u | ((160u + ((((q >> 16) & 0xff) * 96u) >> 8)) << 16) |
+                                          ((160u + ((((q >> 8) & 0xff) * 96u) >> 8)) << 8) |
+                                          (160u + (((q & 0xff) * 96u) >> 8));
+                    const quint32 select = quint32(flags[x]) * 0x01010101u;
+                    out[x] = (faded & ~select) | (kHighlight & select);
+                }
+            }
+        }
+        changed[size_t(band)] = count;
+    };
+
+    ParallelRows::run(threadCount, work);
+    for (qint64 count : changed) {
+        result.changedPixels += count;
+    }
+
+    // 相邻（含对角）的变化格子合并为一个区域，区域是各格子中变化像素范围的并集；
+    // 按行优先的顺序取种子，区域自然按上、左排列
+    std::vector<quint8> visited(cells.size(), 0);
+    std::vector<int> stack;
+    for (int seed = 0; seed < int(cells.size()); ++seed) {
+        if (visited[size_t(seed)] || cells[size_t(seed)].right < 0) {
+            continue;
+        }
+        Cell bounds;
+        visited[size_t(seed)] = 1;
+        stack.push_back(seed);
+        while (!stack.empty()) {
+            const int index = stack.back();
+            stack.pop_back();
+            const Cell &cell = cells[size_t(index)];
+            bounds.left = qMin(bounds.left, cell.left);
+            bounds.top = qMin(bounds.top, cell.top);
+            bounds.right = qMax(bounds.right, cell.right);
+            bounds.bottom = qMax(bounds.bottom, cell.bottom);
+            const int row = index / cellColumns;
+            const int column = index % cellColumns;
+            for (int ny = qMax(0, row - 1); ny <= qMin(cellRows - 1, row + 1); ++ny) {
+                for (int nx = qMax(0, column - 1); nx <= qMin(cellColumns - 1, column + 1); ++nx) {
+                    const int neighbour = ny * cellColumns + nx;
+                    if (!visited[size_t(neighbour)] && cells[size_t(neighbour)].right >= 0) {
+                        visited[size_t(neighbour)] = 1;
+                        stack.push_back(neighbour);
+                    }
+                }
+            }
+        }
+        result.regions.append(QRect(QPoint(bounds.left, bounds.top), QPoint(bounds.right, bounds.bottom)));
+    }
+    if (full.width() > width) {
+        result.regions.append(QRect(width, 0, full.width() - width, full.height()));
+    }
+    if (full.height() > height) {
+        result.regions.append(QRect(0, height, width, full.height() - height));
+    }
+
+    if (highlight && !result.regions.isEmpty()) {
+        QPainter painter(&result.highlighted);
+        painter.setPen(QPen(QColor(kFrame), 2));
+        painter.setBrush(Qt::NoBrush);
+        for (const QRect &region : result.regions) {
+            painter.drawRect(region.adjusted(-2, -2, 1, 1));
+        }
+    }
+    return result;
+}
+
+} // namespace ImageDiff
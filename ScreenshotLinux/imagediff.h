@@ -0,0 +1,36 @@
+#ifndef IMAGEDIFF_H
+#define IMAGEDIFF_H
+
+#include <QImage>
+#include <QRect>
+#include <QVector>
+
+// 截图比较，用于界面回归：
+//   differenceHash  感知哈希（dHash），缩小到9×8的亮度后比较左右相邻像素，
+//                   内容相近的截图汉明距离小，用于在截图历史中找近似的截图
+//   compare         逐像素比较两张截图，任一通道差超过容差即为变化，
+//                   输出变化区域的外接矩形和标出变化的对比图
+namespace ImageDiff {
+
+struct Result {
+    QSize size;                // 比较的范围：两张图的交集
+    qint64 changedPixels = 0;  // 交集内变化的像素数
+    QVector<QRect> regions;    // 连通的变化区域的外接矩形，按从上到下、从左到右排列；尺寸不同时多出的部分也算一个区域
+    QImage highlighted;        // 第二张图变淡作底、变化的像素标红、区域画框；不需要时为空
+    bool identical() const { return changedPixels == 0 && regions.isEmpty(); }
+};
+
+// 变化的像素按CellSize×CellSize的格子汇总，相邻（含对角）的格子合并为一个区域
+enum { CellSize = 16 };
+
+// 64位dHash；两张截图的哈希距离不超过SimilarDistance时视为近似
+enum { SimilarDistance = 10 };
+quint64 differenceHash(const QImage &image);
+int distance(quint64 first, quint64 second);
+
+// 按行分块多线程比较，threadCount为0时使用全部核心；内层循环没有分支，编译器可以自动向量化
+Result compare(const QImage &first, const QImage &second, int tolerance, bool highlight = true, int threadCount = 0);
+
+} // namespace ImageDiff
+
+#endif // IMAGEDIFF_H
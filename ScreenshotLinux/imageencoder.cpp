@@ -0,0 +1,90 @@
+#include "imageencoder.h"
+#include "captureframe.h"
+#include "trace.h"
+#include <QBuffer>
+#include <QFileInfo>
+#include <QImageWriter>
+
+namespace ImageEncoder {
+
+const char *formatName(Profile profile)
+{
+    switch (profile) {
+        case Profile::PngFast:
+        case Profile::PngSmall:
+            return "png";
+        case Profile::Jpeg:
+            return "jpeg";
+        case Profile::Bmp:
+            return "bmp";
+    }
+    return "png";
+}
+
+QString mimeType(Profile profile)
+{
+    return QStringLiteral("image/") + QLatin1String(formatName(profile));
+}
+
+QString fileSuffix(Profile profile)
+{
+    return profile == Profile::Jpeg ? QStringLiteral("jpg") : QLatin1String(formatName(profile));
+}
+
+Profile profileForFileName(const QString &fileName)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == "jpg" || suffix == "jpeg") {
+        return Profile::Jpeg;
+    }
+    if (suffix == "bmp") {
+        return Profile::Bmp;
+    }
+    return Profile::PngSmall;
+}
+
+bool encode(const QImage &image, QIODevice *device, Profile profile)
+{
+    if (image.isNull() || !device) {
+        return false;
+    }
+
+    TRACE_SCOPE("export.encode", QLatin1String(formatName(profile)));
+
+    QImageWriter writer(device, formatName(profile));
+    switch (profile) {
+        case Profile::PngFast:
+            // PNG的quality映射为zlib压缩级别：越大压缩越少、速度越快
+            writer.setQuality(90);
+            break;
+        case Profile::PngSmall:
+            writer.setQuality(0);
+            break;
+        case Profile::Jpeg:
+            writer.setQuality(90);
+            break;
+        case Profile::Bmp:
+            break;
+    }
+
+    // JPEG不支持透明通道，提前转换避免写入器内部再做一次全图转换
+    if (profile == Profile::Jpeg && image.hasAlphaChannel()) {
+        const QImage opaque = image.convertToFormat(QImage::Format_RGB32);
+        CaptureFrame::noteCopy(opaque.sizeInBytes());
+        return writer.write(opaque);
+    }
+    return writer.write(image);
+}
+
+QByteArray encode(const QImage &image, Profile profile)
+{
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    if (!encode(image, &buffer, profile)) {
+        return QByteArray();
+    }
+    return bytes;
+}
+
+} // namespace ImageEncoder
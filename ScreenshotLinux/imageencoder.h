@@ -0,0 +1,33 @@
+#ifndef IMAGEENCODER_H
+#define IMAGEENCODER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+
+class QIODevice;
+
+// 截图编码配置，统一剪贴板、保存文件等出口使用的编码参数
+namespace ImageEncoder {
+
+enum class Profile {
+    PngFast,   // 低压缩级别的PNG，适合剪贴板这类对延迟敏感的场景
+    PngSmall,  // 高压缩级别的PNG，适合落盘保存
+    Jpeg,      // 有损JPEG，体积最小
+    Bmp        // 未压缩位图
+};
+
+const char *formatName(Profile profile);   // Qt图像格式名，如 "png"
+QString mimeType(Profile profile);         // MIME类型，如 "image/png"
+QString fileSuffix(Profile profile);       // 文件后缀（不带点）
+
+// 根据文件名后缀选择编码配置，未知后缀返回 PngSmall
+Profile profileForFileName(const QString &fileName);
+
+// 直接编码到设备（文件、标准输出等），不经过中间缓冲区
+bool encode(const QImage &image, QIODevice *device, Profile profile);
+QByteArray encode(const QImage &image, Profile profile);
+
+} // namespace ImageEncoder
+
+#endif // IMAGEENCODER_H
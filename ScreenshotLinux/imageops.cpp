@@ -0,0 +1,215 @@
+#include "imageops.h"
+#include <QColor>
+#include <QPainter>
+#include <algorithm>
+#include <vector>
+
+namespace ImageOps {
+
+namespace {
+
+// 马赛克的核心：rowAt(y)返回区域内第y行（相对区域顶部）的像素指针，
+// 整张图和分块图只是取行的方式不同
+template <typename RowAt>
+QImage mosaicRows(const QSize &areaSize, int blockSize, RowAt rowAt)
+{
+    QImage result(areaSize, QImage::Format_RGB32);
+    const int blocksX = (areaSize.width() + blockSize - 1) / blockSize;
+
+    // 每个块列的RGB累加值，一次处理一行块
+    std::vector<quint32> sums(size_t(blocksX) * 3);
+
+    for (int blockTop = 0; blockTop < areaSize.height(); blockTop += blockSize) {
+        const int blockHeight = qMin(blockSize, areaSize.height() - blockTop);
+        std::fill(sums.begin(), sums.end(), 0);
+
+        for (int y = 0; y < blockHeight; ++y) {
+            const QRgb *line = rowAt(blockTop + y);
+            for (int bx = 0; bx < blocksX; ++bx) {
+                const int begin = bx * blockSize;
+                const int end = qMin(begin + blockSize, areaSize.width());
+                quint32 r = 0, g = 0, b = 0;
+                for (int x = begin; x < end; ++x) {
+                    r += qRed(line[x]);
+                    g += qGreen(line[x]);
+                    b += qBlue(line[x]);
+                }
+                quint32 *sum = &sums[size_t(bx) * 3];
+                sum[0] += r;
+                sum[1] += g;
+                sum[2] += b;
+            }
+        }
+
+        for (int bx = 0; bx < blocksX; ++bx) {
+            const int blockWidth = qMin(blockSize, areaSize.width() - bx * blockSize);
+            const quint32 count = quint32(blockWidth * blockHeight);
+            const quint32 *sum = &sums[size_t(bx) * 3];
+            const QRgb average = qRgb(sum[0] / count, sum[1] / count, sum[2] / count);
+
+            for (int y = 0; y < blockHeight; ++y) {
+                QRgb *out = reinterpret_cast<QRgb *>(result.scanLine(blockTop + y)) + bx * blockSize;
+                std::fill(out, out + blockWidth, average);
+            }
+        }
+    }
+
+    return result;
+}
+
+} // namespace
+
+QImage mosaic(const QImage &source, const QRect &rect, int blockSize)
+{
+    const QRect area = rect.normalized().intersected(source.rect());
+    if (area.isEmpty() || blockSize <= 0) {
+        return QImage();
+    }
+
+    // 统一到32位格式，只转换需要的区域
+    QImage pixels = source;
+    QPoint origin = area.topLeft();
+    if (pixels.format() != QImage::Format_RGB32 &&
+        pixels.format() != QImage::Format_ARGB32 &&
+        pixels.format() != QImage::Format_ARGB32_Premultiplied) {
+        pixels = source.copy(area).convertToFormat(QImage::Format_RGB32);
+        origin = QPoint(0, 0);
+    }
+
+    return mosaicRows(area.size(), blockSize, [&](int y) {
+        return reinterpret_cast<const QRgb *>(pixels.constScanLine(origin.y() + y)) + origin.x();
+    });
+}
+
+QImage mosaic(const TiledImage &source, const QRect &rect, int blockSize)
+{
+    const QRect area = rect.normalized().intersected(source.rect());
+    if (area.isEmpty() || blockSize <= 0) {
+        return QImage();
+    }
+
+    // 一行只落在一个块里时直接用块的扫描行，跨块时拼到行缓冲里
+    std::vector<QRgb> row(size_t(area.width()));
+    return mosaicRows(area.size(), blockSize, [&](int y) -> const QRgb * {
+        const QRect line(area.left(), area.top() + y, area.width(), 1);
+        for (const TiledImage::Span &span : source.spans(line)) {
+            if (span.rect == line && span.tile) {
+                return span.scanLine(line.top());
+            }
+            QRgb *out = row.data() + (span.rect.left() - area.left());
+            if (span.tile) {
+                std::copy_n(span.scanLine(line.top()), span.rect.width(), out);
+            } else {
+                std::fill_n(out, span.rect.width(), QRgb(0));
+            }
+        }
+        return row.data();
+    });
+}
+
+QImage mosaicReference(const QImage &source, const QRect &rect, int blockSize)
+{
+    const QRect area = rect.normalized().intersected(source.rect());
+    if (area.isEmpty() || blockSize <= 0) {
+        return QImage();
+    }
+
+    QImage result(area.size(), QImage::Format_RGB32);
+    result.fill(Qt::transparent);
+    QPainter painter(&result);
+    painter.translate(-area.topLeft());
+
+    for (int y = area.top(); y <= area.bottom(); y += blockSize) {
+        for (int x = area.left(); x <= area.right(); x += blockSize) {
+            const int w = qMin(blockSize, area.right() - x + 1);
+            const int h = qMin(blockSize, area.bottom() - y + 1);
+            const QRect block(x, y, w, h);
+
+            QImage blockImage = source.copy(block);
+            int r = 0, g = 0, b = 0, count = 0;
+            for (int by = 0; by < blockImage.height(); ++by) {
+                for (int bx = 0; bx < blockImage.width(); ++bx) {
+                    QColor pixelColor = blockImage.pixelColor(bx, by);
+                    r += pixelColor.red();
+                    g += pixelColor.green();
+                    b += pixelColor.blue();
+                    count++;
+                }
+            }
+            if (count > 0) {
+                painter.fillRect(block, QColor(r / count, g / count, b / count));
+            }
+        }
+    }
+    painter.end();
+    return result;
+}
+
+QImage downscale(const QImage &source, const QSize &bound)
+{
+    if (source.isNull() || bound.isEmpty()) {
+        return QImage();
+    }
+    const QSize target = source.size().scaled(bound, Qt::KeepAspectRatio)
+                             .boundedTo(source.size()).expandedTo(QSize(1, 1));
+
+    // 截图都是这两种格式，其他格式先转换；不透明格式的alpha字节可能是任意值，输出时固定为255
+    QImage pixels = source;
+    if (pixels.format() != QImage::Format_RGB32 && pixels.format() != QImage::Format_ARGB32_Premultiplied) {
+        pixels = source.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    const bool opaque = pixels.format() == QImage::Format_RGB32;
+    const int width = pixels.width();
+    const int height = pixels.height();
+    QImage result(target, pixels.format());
+
+    // 每个目标列对应的源列范围
+    std::vector<int> columnStart(size_t(target.width()) + 1);
+    for (int x = 0; x <= target.width(); ++x) {
+        columnStart[size_t(x)] = int(qint64(x) * width / target.width());
+    }
+
+    // 四个通道各一个平面的列和
+    std::vector<quint32> sums(size_t(width) * 4);
+    quint32 *blue = sums.data();
+    quint32 *green = blue + width;
+    quint32 *red = green + width;
+    quint32 *alpha = red + width;
+
+    for (int ty = 0; ty < target.height(); ++ty) {
+        const int top = int(qint64(ty) * height / target.height());
+        const int bottom = int(qint64(ty + 1) * height / target.height());
+        std::fill(sums.begin(), sums.end(), 0);
+        for (int y = top; y < bottom; ++y) {
+            const quint32 *line = reinterpret_cast<const quint32 *>(pixels.constScanLine(y));
+            for (int x = 0; x < width; ++x) {
+                const quint32 pixel = line[x];
+                blue[x] += pixel & 0xff;
+                green[x] += (pixel >> 8) & 0xff;
+                red[x] += (pixel >> 16) & 0xff;
+                alpha[x] += pixel >> 24;
+            }
+        }
+
+        QRgb *out = reinterpret_cast<QRgb *>(result.scanLine(ty));
+        for (int tx = 0; tx < target.width(); ++tx) {
+            const int begin = columnStart[size_t(tx)];
+            const int end = columnStart[size_t(tx) + 1];
+            quint64 b = 0, g = 0, r = 0, a = 0;
+            for (int x = begin; x < end; ++x) {
+                b += blue[x];
+                g += green[x];
+                r += red[x];
+                a += alpha[x];
+            }
+            const quint64 count = quint64(bottom - top) * quint64(end - begin);
+            const quint64 half = count / 2;
+            const quint32 averageAlpha = opaque ? 255u : quint32((a + half) / count);
+            out[tx] = (averageAlpha << 24) | (quint32((r + half) / count) << 16) |
+                      (quint32((g + half) / count) << 8) | quint32((b + half) / count);
+        }
+    }
+    return result;
+}
+
+} // namespace ImageOps
@@ -0,0 +1,28 @@
+#ifndef IMAGEOPS_H
+#define IMAGEOPS_H
+
+#include <QImage>
+#include <QRect>
+#include "tiledimage.h"
+
+// 图像处理内核，不依赖任何窗口，便于基准测试和复用
+namespace ImageOps {
+
+// 马赛克：把source中rect区域按blockSize分块，每块填充块内平均色
+// 返回rect大小的图像，由调用方绘制到rect.topLeft()
+// 直接按扫描行累加，每个源像素只读取一次
+QImage mosaic(const QImage &source, const QRect &rect, int blockSize);
+// 同上，直接按块读取分块截图，不拼接整张图
+QImage mosaic(const TiledImage &source, const QRect &rect, int blockSize);
+
+// 参考实现：逐块复制再用pixelColor取色，与最初的实现一致，仅用于基准对比
+QImage mosaicReference(const QImage &source, const QRect &rect, int blockSize);
+
+// 盒式缩小：保持宽高比缩小到bound以内，每个目标像素是对应源矩形的平均值（按预乘颜色平均）
+// 先纵向把一行目标像素覆盖的源行按通道累加到分平面的列和里，内层循环没有分支，
+// 编译器可以自动向量化；每个源像素只读取一次。用于缩略图，不放大
+QImage downscale(const QImage &source, const QSize &bound);
+
+} // namespace ImageOps
+
+#endif // IMAGEOPS_H
@@ -0,0 +1,175 @@
+#include "inputrecorder.h"
+#include "logging.h"
+#include <QKeyEvent>
+#include <QMouseEvent>
+
+namespace {
+
+const quint32 kMagic = 0x53534952; // "SSIR"
+const quint16 kVersion = 1;
+
+} // namespace
+
+InputRecorder::InputRecorder(QObject *parent)
+    : QObject(parent)
+    , m_lastEventNs(0)
+{
+}
+
+InputRecorder::~InputRecorder()
+{
+    stop();
+}
+
+bool InputRecorder::start(const QString &filePath, const QSize &canvasSize)
+{
+    stop();
+
+    m_file.setFileName(filePath);
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(lcOverlay) << "无法创建输入录制文件:" << filePath;
+        return false;
+    }
+
+    m_stream.setDevice(&m_file);
+    m_stream.setByteOrder(QDataStream::LittleEndian);
+    m_stream << kMagic << kVersion << qint32(canvasSize.width()) << qint32(canvasSize.height());
+
+    m_clock.start();
+    m_lastEventNs = 0;
+    qCDebug(lcOverlay) << "开始录制输入事件:" << filePath;
+    return true;
+}
+
+void InputRecorder::stop()
+{
+    if (m_file.isOpen()) {
+        m_stream.setDevice(nullptr);
+        m_file.close();
+    }
+}
+
+void InputRecorder::recordToolAction(int index)
+{
+    if (!isRecording()) {
+        return;
+    }
+    RecordedInput input;
+    input.kind = RecordedInput::Kind::ToolAction;
+    input.action = quint8(index);
+    write(input);
+}
+
+bool InputRecorder::eventFilter(QObject *watched, QEvent *event)
+{
+    if (!isRecording()) {
+        return QObject::eventFilter(watched, event);
+    }
+
+    RecordedInput input;
+    switch (event->type()) {
+        case QEvent::MouseButtonPress:
+        case QEvent::MouseButtonRelease:
+        case QEvent::MouseMove: {
+            auto *mouse = static_cast<QMouseEvent *>(event);
+            input.kind = event->type() == QEvent::MouseButtonPress ? RecordedInput::Kind::MousePress
+                       : event->type() == QEvent::MouseButtonRelease ? RecordedInput::Kind::MouseRelease
+                                                                     : RecordedInput::Kind::MouseMove;
+            input.pos = mouse->position().toPoint();
+            input.button = quint8(mouse->button());
+            input.buttons = quint8(mouse->buttons());
+            input.modifiers = quint8(quint32(mouse->modifiers()) >> 25);
+            write(input);
+            break;
+        }
+        case QEvent::KeyPress:
+        case QEvent::KeyRelease: {
+            auto *key = static_cast<QKeyEvent *>(event);
+            input.kind = event->type() == QEvent::KeyPress ? RecordedInput::Kind::KeyPress
+                                                           : RecordedInput::Kind::KeyRelease;
+            input.key = key->key();
+            input.modifiers = quint8(quint32(key->modifiers()) >> 25);
+            input.text = key->text();
+            write(input);
+            break;
+        }
+        default:
+            break;
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void InputRecorder::write(const RecordedInput &input)
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    const quint32 deltaUs = quint32(qMin<qint64>((now - m_lastEventNs) / 1000, 0xffffffff));
+    m_lastEventNs = now;
+
+    m_stream << quint8(input.kind) << deltaUs;
+    switch (input.kind) {
+        case RecordedInput::Kind::MousePress:
+        case RecordedInput::Kind::MouseRelease:
+        case RecordedInput::Kind::MouseMove:
+            m_stream << qint16(input.pos.x()) << qint16(input.pos.y())
+                     << input.button << input.buttons << input.modifiers;
+            break;
+        case RecordedInput::Kind::KeyPress:
+        case RecordedInput::Kind::KeyRelease:
+            m_stream << input.key << input.modifiers << input.text;
+            break;
+        case RecordedInput::Kind::ToolAction:
+            m_stream << input.action;
+            break;
+    }
+}
+
+bool InputRecorder::load(const QString &filePath, QSize *canvasSize, QVector<RecordedInput> *events)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    quint32 magic = 0;
+    quint16 version = 0;
+    qint32 width = 0, height = 0;
+    stream >> magic >> version >> width >> height;
+    if (magic != kMagic || version != kVersion) {
+        return false;
+    }
+    *canvasSize = QSize(width, height);
+
+    events->clear();
+    while (!stream.atEnd() && stream.status() == QDataStream::Ok) {
+        RecordedInput input;
+        quint8 kind = 0;
+        stream >> kind >> input.deltaUs;
+        input.kind = RecordedInput::Kind(kind);
+        switch (input.kind) {
+            case RecordedInput::Kind::MousePress:
+            case RecordedInput::Kind::MouseRelease:
+            case RecordedInput::Kind::MouseMove: {
+                qint16 x = 0, y = 0;
+                stream >> x >> y >> input.button >> input.buttons >> input.modifiers;
+                input.pos = QPoint(x, y);
+                break;
+            }
+            case RecordedInput::Kind::KeyPress:
+            case RecordedInput::Kind::KeyRelease:
+                stream >> input.key >> input.modifiers >> input.text;
+                break;
+            case RecordedInput::Kind::ToolAction:
+                stream >> input.action;
+                break;
+            default:
+                return false;
+        }
+        if (stream.status() != QDataStream::Ok) {
+            break;
+        }
+        events->append(input);
+    }
+    return true;
+}
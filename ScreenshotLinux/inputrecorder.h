@@ -0,0 +1,66 @@
+#ifndef INPUTRECORDER_H
+#define INPUTRECORDER_H
+
+#include <QObject>
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QPoint>
+#include <QSize>
+#include <QString>
+#include <QVector>
+
+// 录制的一条输入事件
+struct RecordedInput {
+    enum class Kind : quint8 {
+        MousePress = 1,
+        MouseRelease = 2,
+        MouseMove = 3,
+        KeyPress = 4,
+        KeyRelease = 5,
+        ToolAction = 6 // 工具栏动作，action 为其在工具栏中的序号
+    };
+
+    Kind kind = Kind::MouseMove;
+    quint32 deltaUs = 0;   // 距上一条事件的时间
+    QPoint pos;
+    quint8 button = 0;     // Qt::MouseButton
+    quint8 buttons = 0;    // Qt::MouseButtons
+    quint8 modifiers = 0;  // Qt::KeyboardModifiers 右移25位后的值
+    qint32 key = 0;
+    QString text;
+    quint8 action = 0;
+};
+
+// 把遮罩窗口上的鼠标/键盘事件流录制到紧凑的二进制文件，供回放工具做帧时间分析
+// 文件格式：魔数 "SSIR"、版本、画布尺寸，之后是逐条事件
+class InputRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InputRecorder(QObject *parent = nullptr);
+    ~InputRecorder() override;
+
+    bool start(const QString &filePath, const QSize &canvasSize);
+    void stop();
+    bool isRecording() const { return m_file.isOpen(); }
+
+    void recordToolAction(int index);
+
+    // 读取录制文件，失败返回false
+    static bool load(const QString &filePath, QSize *canvasSize, QVector<RecordedInput> *events);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void write(const RecordedInput &input);
+
+    QFile m_file;
+    QDataStream m_stream;
+    QElapsedTimer m_clock;
+    qint64 m_lastEventNs;
+};
+
+#endif // INPUTRECORDER_H
@@ -0,0 +1,127 @@
+#include "instanceclient.h"
+#include "instanceserver.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+int connectToServer()
+{
+    const QByteArray path = QFile::encodeName(InstanceServer::socketPath());
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= int(sizeof(address.sun_path))) {
+        return -1;
+    }
+    std::memcpy(address.sun_path, path.constData(), path.size());
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool writeAll(int fd, const QByteArray &data)
+{
+    qsizetype written = 0;
+    while (written < data.size()) {
+        const ssize_t n = ::write(fd, data.constData() + written, data.size() - written);
+        if (n <= 0) {
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+} // namespace
+
+namespace InstanceClient {
+
+bool sendCommand(const QByteArray &command, QByteArray *reply, int timeoutMs)
+{
+    const int fd = connectToServer();
+    if (fd < 0) {
+        return false;
+    }
+
+    if (!writeAll(fd, command + '\n')) {
+        ::close(fd);
+        return false;
+    }
+
+    // 服务端回复一行后关闭连接，读到EOF或换行即结束
+    QByteArray buffer;
+    char chunk[512];
+    pollfd pfd{ fd, POLLIN, 0 };
+    while (!buffer.contains('\n') && ::poll(&pfd, 1, timeoutMs) > 0) {
+        const ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n <= 0) {
+            break;
+        }
+        buffer.append(chunk, n);
+    }
+    ::close(fd);
+
+    if (reply) {
+        *reply = buffer.trimmed();
+    }
+    return !buffer.isEmpty();
+}
+
+bool isServerRunning()
+{
+    const int fd = connectToServer();
+    if (fd < 0) {
+        return false;
+    }
+    ::close(fd);
+    return true;
+}
+
+int benchmark(int iterations)
+{
+    std::vector<qint64> samples;
+    samples.reserve(iterations);
+
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        QByteArray reply;
+        if (!sendCommand("ping", &reply) || !reply.startsWith("ok")) {
+            std::fprintf(stderr, "第%d次往返失败，实例未运行？\n", i + 1);
+            return 1;
+        }
+        samples.push_back(timer.nsecsElapsed());
+    }
+    if (samples.empty()) {
+        return 1;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        const size_t index = std::min(samples.size() - 1, size_t(p * samples.size()));
+        return samples[index] / 1000.0;
+    };
+    std::printf("ipc round-trip: n=%d min=%.1fus p50=%.1fus p95=%.1fus p99=%.1fus max=%.1fus\n",
+                iterations, samples.front() / 1000.0, percentile(0.50), percentile(0.95),
+                percentile(0.99), samples.back() / 1000.0);
+    return 0;
+}
+
+} // namespace InstanceClient
@@ -0,0 +1,21 @@
+#ifndef INSTANCECLIENT_H
+#define INSTANCECLIENT_H
+
+#include <QByteArray>
+
+// 轻量客户端：直接用POSIX套接字连接常驻实例，不创建任何Qt应用对象，
+// 保证热键守护进程调用时毫秒级返回
+namespace InstanceClient {
+
+// 发送一行命令并等待回复，连接失败返回false
+bool sendCommand(const QByteArray &command, QByteArray *reply, int timeoutMs = 2000);
+
+// 只尝试连接，判断是否已有实例在运行
+bool isServerRunning();
+
+// 测量命令往返延迟（包括建立连接），结果输出到标准输出
+int benchmark(int iterations);
+
+} // namespace InstanceClient
+
+#endif // INSTANCECLIENT_H
@@ -0,0 +1,88 @@
+#include "instanceserver.h"
+#include "logging.h"
+#include "trace.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDir>
+#include <unistd.h>
+
+InstanceServer::InstanceServer(Handler handler, QObject *parent)
+    : QObject(parent)
+    , m_handler(std::move(handler))
+    , m_server(new QLocalServer(this))
+{
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &InstanceServer::acceptConnection);
+}
+
+InstanceServer::~InstanceServer()
+{
+    m_server->close();
+}
+
+QString InstanceServer::socketPath()
+{
+    // 优先使用每个用户独立的运行时目录
+    QString dir = qEnvironmentVariable("XDG_RUNTIME_DIR");
+    if (dir.isEmpty() || !QDir(dir).exists()) {
+        dir = QDir::tempPath();
+    }
+    return dir + QString("/screenshotlinux-%1.sock").arg(getuid());
+}
+
+bool InstanceServer::listen()
+{
+    const QString path = socketPath();
+    if (m_server->listen(path)) {
+        qCDebug(lcIpc) << "实例服务已启动:" << path;
+        return true;
+    }
+
+    // 上次异常退出可能留下无人监听的套接字文件，确认没有实例在运行后清理重试
+    if (m_server->serverError() == QAbstractSocket::AddressInUseError) {
+        QLocalSocket probe;
+        probe.connectToServer(path);
+        if (probe.waitForConnected(100)) {
+            qCDebug(lcIpc) << "已有实例在运行:" << path;
+            return false;
+        }
+        QLocalServer::removeServer(path);
+        if (m_server->listen(path)) {
+            qCDebug(lcIpc) << "清理残留套接字后实例服务已启动:" << path;
+            return true;
+        }
+    }
+
+    qCDebug(lcIpc) << "实例服务启动失败:" << m_server->errorString();
+    return false;
+}
+
+void InstanceServer::acceptConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            handleSocket(socket);
+        });
+        // 数据可能在连接建立时已经到达
+        if (socket->canReadLine()) {
+            handleSocket(socket);
+        }
+    }
+}
+
+void InstanceServer::handleSocket(QLocalSocket *socket)
+{
+    if (!socket->canReadLine()) {
+        return;
+    }
+
+    const QString command = QString::fromUtf8(socket->readLine()).trimmed();
+    qCDebug(lcIpc) << "收到实例命令:" << command;
+    TRACE_SCOPE("ipc.command", command);
+
+    const QString reply = m_handler ? m_handler(command) : QStringLiteral("error 未设置命令处理器");
+    socket->write(reply.toUtf8() + '\n');
+    socket->flush();
+    socket->disconnectFromServer();
+}
@@ -0,0 +1,38 @@
+#ifndef INSTANCESERVER_H
+#define INSTANCESERVER_H
+
+#include <QObject>
+#include <QString>
+#include <functional>
+
+class QLocalServer;
+class QLocalSocket;
+
+// 常驻托盘进程的本地套接字服务
+// 协议：客户端发送一行UTF-8命令，服务端回复一行 "ok ..." 或 "error ..." 后关闭连接
+class InstanceServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    using Handler = std::function<QString(const QString &command)>;
+
+    explicit InstanceServer(Handler handler, QObject *parent = nullptr);
+    ~InstanceServer() override;
+
+    bool listen(); // 监听失败（例如已有实例在运行）返回false
+
+    // 套接字路径，客户端不依赖Qt直接连接这个路径
+    static QString socketPath();
+
+private slots:
+    void acceptConnection();
+
+private:
+    void handleSocket(QLocalSocket *socket);
+
+    Handler m_handler;
+    QLocalServer *m_server;
+};
+
+#endif // INSTANCESERVER_H
@@ -0,0 +1,227 @@
+#include "intervalcapture.h"
+#include "commandline.h"
+#include "headlesscapture.h"
+#include "screencapture.h"
+#include "imageencoder.h"
+#include "tilehash.h"
+#include "tiledimage.h"
+#include "trace.h"
+#include <QGuiApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QTimer>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// 变化的块超过这个比例时保存整帧，拼图反而比整帧大
+const double kKeyframeFraction = 0.4;
+// 连续增量帧的上限，限制还原一帧时需要叠加的文件数
+const int kMaxDeltaChain = 60;
+
+// 把变化的块按网格排成一张拼图，第i格对应tiles[i]；边缘块较小，放在格子左上角
+QImage tileAtlas(const QImage &frame, const TileHashes &hashes, const QVector<int> &tiles)
+{
+    const int cells = int(std::ceil(std::sqrt(double(tiles.size()))));
+    const int cellRows = (tiles.size() + cells - 1) / cells;
+    QImage atlas(cells * TiledImage::TileSize, cellRows * TiledImage::TileSize, frame.format());
+    atlas.fill(0);
+
+    const int bytesPerPixel = frame.depth() / 8;
+    for (int i = 0; i < tiles.size(); ++i) {
+        const QRect tile = hashes.tileRect(tiles.at(i));
+        const QPoint cell((i % cells) * TiledImage::TileSize, (i / cells) * TiledImage::TileSize);
+        for (int y = 0; y < tile.height(); ++y) {
+            std::memcpy(atlas.scanLine(cell.y() + y) + cell.x() * bytesPerPixel,
+                        frame.constScanLine(tile.top() + y) + tile.left() * bytesPerPixel,
+                        size_t(tile.width()) * bytesPerPixel);
+        }
+    }
+    return atlas;
+}
+
+class IntervalRecorder
+{
+public:
+    explicit IntervalRecorder(const CommandLineOptions &options)
+        : m_options(options)
+        , m_directory(options.output)
+        , m_profile(HeadlessCapture::outputProfile(options.format))
+    {
+    }
+
+    bool open()
+    {
+        if (!m_directory.mkpath(QStringLiteral("."))) {
+            std::fprintf(stderr, "无法创建输出目录: %s\n", qPrintable(m_directory.path()));
+            return false;
+        }
+        m_index.setFileName(m_directory.filePath(QStringLiteral("index.jsonl")));
+        if (!m_index.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            std::fprintf(stderr, "无法写入: %s\n", qPrintable(m_index.fileName()));
+            return false;
+        }
+        return true;
+    }
+
+    bool finished() const
+    {
+        return m_failed || (m_options.intervalCount > 0 && m_frames >= m_options.intervalCount);
+    }
+
+    bool failed() const { return m_failed; }
+
+    void captureFrame()
+    {
+        TRACE_SCOPE("interval.frame");
+        QElapsedTimer stageTimer;
+        stageTimer.start();
+        const QDateTime now = QDateTime::currentDateTime();
+        QString backend;
+        const QImage frame = ScreenCapture::grabRegion(m_options.region, &backend);
+        const double captureMs = HeadlessCapture::elapsedMs(stageTimer);
+        ++m_frames;
+        if (frame.isNull()) {
+            // 单帧失败（例如屏幕锁定）不中断留档，记录下来等下一次
+            std::fprintf(stderr, "截图失败：没有可用的截图后端\n");
+            appendRecord(now, QStringLiteral("error"), QJsonObject());
+            return;
+        }
+
+        stageTimer.restart();
+        const TileHashes hashes = TileHashes::compute(frame);
+        const QVector<int> changed = hashes.changedTiles(m_previous);
+        const double hashMs = HeadlessCapture::elapsedMs(stageTimer);
+        m_previous = hashes;
+
+        stageTimer.restart();
+        QString type;
+        QJsonObject record;
+        if (changed.isEmpty()) {
+            type = QStringLiteral("same");
+        } else if (m_keyFile.isEmpty() || m_deltaChain >= kMaxDeltaChain ||
+                   changed.size() > hashes.tileCount() * kKeyframeFraction) {
+            type = QStringLiteral("key");
+            const QString file = fileName(now, type);
+            if (!writeImage(frame, file)) {
+                return;
+            }
+            record.insert("file", file);
+            record.insert("size", QJsonArray{ frame.width(), frame.height() });
+            m_keyFile = file;
+            m_deltaChain = 0;
+        } else {
+            type = QStringLiteral("delta");
+            const QString file = fileName(now, type);
+            if (!writeImage(tileAtlas(frame, hashes, changed), file)) {
+                return;
+            }
+            // 拼图中第i格是tiles[i]，以[列, 行]表示块在帧中的位置
+            QJsonArray tiles;
+            for (int index : changed) {
+                tiles.append(QJsonArray{ index % hashes.columns(), index / hashes.columns() });
+            }
+            record.insert("file", file);
+            record.insert("base", m_keyFile);
+            record.insert("tiles", tiles);
+            ++m_deltaChain;
+        }
+        const double encodeMs = HeadlessCapture::elapsedMs(stageTimer);
+        appendRecord(now, type, record);
+
+        if (m_options.timings) {
+            std::fprintf(stderr,
+                         "frame=%d type=%s changed=%d/%d capture=%.2fms hash=%.2fms encode=%.2fms backend=%s\n",
+                         m_frames, qPrintable(type), int(changed.size()), hashes.tileCount(),
+                         captureMs, hashMs, encodeMs, qPrintable(backend));
+        }
+    }
+
+private:
+    QString fileName(const QDateTime &time, const QString &type) const
+    {
+        return QString("%1-%2.%3").arg(time.toString("yyyyMMdd-HHmmss-zzz"), type,
+                                       ImageEncoder::fileSuffix(m_profile));
+    }
+
+    bool writeImage(const QImage &image, const QString &file)
+    {
+        TRACE_SCOPE("interval.write", file);
+        QSaveFile out(m_directory.filePath(file));
+        if (!out.open(QIODevice::WriteOnly) || !ImageEncoder::encode(image, &out, m_profile) || !out.commit()) {
+            std::fprintf(stderr, "无法写入截图: %s\n", qPrintable(out.fileName()));
+            m_failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    void appendRecord(const QDateTime &time, const QString &type, QJsonObject record)
+    {
+        record.insert("time", time.toString(Qt::ISODateWithMs));
+        record.insert("type", type);
+        // 每帧一行并立即落盘，进程被中断时索引也是完整的
+        m_index.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+        m_index.flush();
+    }
+
+    const CommandLineOptions &m_options;
+    QDir m_directory;
+    ImageEncoder::Profile m_profile;
+    QFile m_index;
+    TileHashes m_previous; // 上一帧的块哈希，不保留像素
+    QString m_keyFile;     // 增量帧所基于的整帧
+    int m_deltaChain = 0;
+    int m_frames = 0;
+    bool m_failed = false;
+};
+
+} // namespace
+
+namespace IntervalCapture {
+
+int run(int argc, char *argv[], const CommandLineOptions &options, const QElapsedTimer &startupTimer)
+{
+    HeadlessCapture::preparePlatform(argc, argv);
+
+    QGuiApplication app(argc, argv);
+    HeadlessCapture::checkOffscreenCapture(options.region);
+    if (options.timings) {
+        std::fprintf(stderr, "timings: startup=%.2fms\n", HeadlessCapture::elapsedMs(startupTimer));
+    }
+
+    IntervalRecorder recorder(options);
+    if (!recorder.open()) {
+        return 1;
+    }
+
+    QTimer timer;
+    timer.setInterval(int(options.intervalSeconds * 1000));
+    QObject::connect(&timer, &QTimer::timeout, &app, [&]() {
+        recorder.captureFrame();
+        if (recorder.finished()) {
+            timer.stop();
+            app.quit();
+        }
+    });
+    // 第一帧立即截取，之后按间隔
+    QTimer::singleShot(0, &app, [&]() {
+        recorder.captureFrame();
+        if (recorder.finished()) {
+            app.quit();
+            return;
+        }
+        timer.start();
+    });
+    app.exec();
+    return recorder.failed() ? 1 : 0;
+}
+
+} // namespace IntervalCapture
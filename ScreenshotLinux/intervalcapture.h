@@ -0,0 +1,18 @@
+#ifndef INTERVALCAPTURE_H
+#define INTERVALCAPTURE_H
+
+#include <QElapsedTimer>
+
+struct CommandLineOptions;
+
+// 定时截图：按固定间隔截取区域，用于状态页面的留档
+// 每帧按256×256分块计算哈希并与上一帧比较：没有变化的帧不编码，
+// 少量块变化时只保存变化的块，变化较大时保存整帧；
+// 输出目录下的index.jsonl逐帧追加一行记录，按顺序叠加即可还原任意一帧
+namespace IntervalCapture {
+
+int run(int argc, char *argv[], const CommandLineOptions &options, const QElapsedTimer &startupTimer);
+
+} // namespace IntervalCapture
+
+#endif // INTERVALCAPTURE_H
@@ -0,0 +1,139 @@
+#include "lazyimagemimedata.h"
+#include "imageencoder.h"
+#include "logging.h"
+#include <QGuiApplication>
+#include <QClipboard>
+#include <QDir>
+#include <QUrl>
+
+namespace {
+
+const QString kPngMime = QStringLiteral("image/png");
+const QString kJpegMime = QStringLiteral("image/jpeg");
+const QString kBmpMime = QStringLiteral("image/bmp");
+const QString kQtImageMime = QStringLiteral("application/x-qt-image");
+const QString kUriListMime = QStringLiteral("text/uri-list");
+
+} // namespace
+
+LazyImageMimeData::LazyImageMimeData(const QImage &image)
+    : m_image(image)
+{
+    // 剪贴板内容被其他程序替换时，Qt并不总是立即删除旧数据，这里主动释放
+    connect(QGuiApplication::clipboard(), &QClipboard::dataChanged,
+            this, &LazyImageMimeData::clipboardChanged);
+}
+
+LazyImageMimeData::~LazyImageMimeData()
+{
+    releaseData();
+}
+
+QStringList LazyImageMimeData::formats() const
+{
+    if (m_image.isNull()) {
+        return QStringList();
+    }
+    // 按偏好顺序列出：无损压缩优先，原始格式放在最后
+    return QStringList() << kPngMime << kJpegMime << kUriListMime << kQtImageMime << kBmpMime;
+}
+
+bool LazyImageMimeData::hasFormat(const QString &mimeType) const
+{
+    return formats().contains(mimeType);
+}
+
+QVariant LazyImageMimeData::retrieveData(const QString &mimeType, QMetaType preferredType) const
+{
+    if (m_image.isNull()) {
+        return QVariant();
+    }
+
+    if (mimeType == kQtImageMime && preferredType.id() != QMetaType::QByteArray) {
+        // 同进程粘贴直接共享图像，不需要编码
+        return m_image;
+    }
+
+    if (mimeType == kUriListMime && preferredType.id() != QMetaType::QByteArray) {
+        const QString path = temporaryFilePath();
+        if (path.isEmpty()) {
+            return QVariant();
+        }
+        return QVariantList() << QUrl::fromLocalFile(path);
+    }
+
+    const QByteArray bytes = encodedData(mimeType);
+    if (bytes.isEmpty()) {
+        return QVariant();
+    }
+    return bytes;
+}
+
+QByteArray LazyImageMimeData::encodedData(const QString &mimeType) const
+{
+    auto cached = m_cache.constFind(mimeType);
+    if (cached != m_cache.constEnd()) {
+        return cached.value();
+    }
+
+    QByteArray bytes;
+    if (mimeType == kPngMime || mimeType == kQtImageMime) {
+        // application/x-qt-image 以字节形式请求时与PNG共用同一份编码
+        auto png = m_cache.constFind(kPngMime);
+        bytes = png != m_cache.constEnd() ? png.value()
+                                          : ImageEncoder::encode(m_image, ImageEncoder::Profile::PngFast);
+    } else if (mimeType == kJpegMime) {
+        bytes = ImageEncoder::encode(m_image, ImageEncoder::Profile::Jpeg);
+    } else if (mimeType == kBmpMime) {
+        bytes = ImageEncoder::encode(m_image, ImageEncoder::Profile::Bmp);
+    } else if (mimeType == kUriListMime) {
+        const QString path = temporaryFilePath();
+        if (!path.isEmpty()) {
+            bytes = QUrl::fromLocalFile(path).toEncoded() + "\r\n";
+        }
+    }
+
+    if (!bytes.isEmpty()) {
+        qCDebug(lcExport) << "剪贴板按需编码:" << mimeType << "大小:" << bytes.size() << "字节";
+        m_cache.insert(mimeType, bytes);
+    }
+    return bytes;
+}
+
+QString LazyImageMimeData::temporaryFilePath() const
+{
+    if (m_tempFile) {
+        return m_tempFile->fileName();
+    }
+
+    auto file = std::make_unique<QTemporaryFile>(QDir::tempPath() + "/screenshot_XXXXXX.png");
+    if (!file->open()) {
+        qCDebug(lcExport) << "无法创建剪贴板临时文件";
+        return QString();
+    }
+
+    const QByteArray png = encodedData(kPngMime);
+    if (png.isEmpty() || file->write(png) != png.size()) {
+        return QString();
+    }
+    file->flush();
+    m_tempFile = std::move(file);
+    return m_tempFile->fileName();
+}
+
+void LazyImageMimeData::releaseData()
+{
+    m_image = QImage();
+    m_cache.clear();
+    m_cache.squeeze();
+    m_tempFile.reset();
+}
+
+void LazyImageMimeData::clipboardChanged()
+{
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    if (!clipboard->ownsClipboard() || clipboard->mimeData() != this) {
+        qCDebug(lcExport) << "已失去剪贴板所有权，释放截图数据";
+        releaseData();
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef LAZYIMAGEMIMEDATA_H
+#define LAZYIMAGEMIMEDATA_H
+
+#include <QMimeData>
+#include <QImage>
+#include <QHash>
+#include <QByteArray>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <memory>
+
+// 延迟编码的剪贴板数据提供者
+// 只声明支持的格式，粘贴方真正请求某种格式时才编码，并按格式缓存结果；
+// 失去剪贴板所有权后立即释放图像和缓存
+class LazyImageMimeData : public QMimeData
+{
+    Q_OBJECT
+
+public:
+    explicit LazyImageMimeData(const QImage &image);
+    ~LazyImageMimeData() override;
+
+    bool hasFormat(const QString &mimeType) const override;
+    QStringList formats() const override;
+
+    void releaseData(); // 丢弃图像、已编码缓存和临时文件
+
+protected:
+    QVariant retrieveData(const QString &mimeType, QMetaType preferredType) const override;
+
+private slots:
+    void clipboardChanged();
+
+private:
+    QByteArray encodedData(const QString &mimeType) const;
+    QString temporaryFilePath() const;
+
+    QImage m_image;                                    // 合成后的截图
+    mutable QHash<QString, QByteArray> m_cache;        // 按格式缓存的编码结果
+    mutable std::unique_ptr<QTemporaryFile> m_tempFile; // text/uri-list 使用的临时文件
+};
+
+#endif // LAZYIMAGEMIMEDATA_H
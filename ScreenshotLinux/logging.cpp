@@ -0,0 +1,7 @@
+#include "logging.h"
+
+Q_LOGGING_CATEGORY(lcApp, "screenshot.app", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcCapture, "screenshot.capture", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcOverlay, "screenshot.overlay", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcExport, "screenshot.export", QtInfoMsg)
+Q_LOGGING_CATEGORY(lcIpc, "screenshot.ipc", QtInfoMsg)
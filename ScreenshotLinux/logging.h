@@ -0,0 +1,15 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include <QLoggingCategory>
+
+// 按模块划分的日志分类，默认只输出info及以上级别
+// 调试输出可以用 --verbose 或 QT_LOGGING_RULES="screenshot.capture.debug=true" 打开；
+// 非Debug构建定义了QT_NO_DEBUG_OUTPUT，qCDebug在编译期就被去掉，不产生任何开销
+Q_DECLARE_LOGGING_CATEGORY(lcApp)      // 启动、托盘
+Q_DECLARE_LOGGING_CATEGORY(lcCapture)  // 截图后端
+Q_DECLARE_LOGGING_CATEGORY(lcOverlay)  // 遮罩窗口交互与绘制
+Q_DECLARE_LOGGING_CATEGORY(lcExport)   // 剪贴板、保存文件、编码
+Q_DECLARE_LOGGING_CATEGORY(lcIpc)      // 单实例本地套接字
+
+#endif // LOGGING_H
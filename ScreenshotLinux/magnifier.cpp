@@ -0,0 +1,108 @@
+#include "magnifier.h"
+#include <QColor>
+#include <QFont>
+#include <QPen>
+#include <QString>
+
+namespace {
+
+const int kCursorOffset = 20;   // 放大镜左上角离光标的距离
+const int kInfoLines = 4;
+
+} // namespace
+
+Magnifier::Magnifier()
+    : m_radius(8)
+    , m_cellSize(9)
+    , m_textHeight(16)
+{
+}
+
+QRect Magnifier::rectFor(const QPoint &cursor, const QRect &bounds) const
+{
+    const int zoomSize = (m_radius * 2 + 1) * m_cellSize;
+    const QSize size(zoomSize + 2, zoomSize + 2 + kInfoLines * m_textHeight + 4);
+
+    QPoint topLeft = cursor + QPoint(kCursorOffset, kCursorOffset);
+    if (topLeft.x() + size.width() > bounds.right()) {
+        topLeft.setX(cursor.x() - kCursorOffset - size.width());
+    }
+    if (topLeft.y() + size.height() > bounds.bottom()) {
+        topLeft.setY(cursor.y() - kCursorOffset - size.height());
+    }
+    topLeft.setX(qMax(bounds.left(), topLeft.x()));
+    topLeft.setY(qMax(bounds.top(), topLeft.y()));
+    return QRect(topLeft, size);
+}
+
+QRgb Magnifier::pixelAt(const TiledImage &image, const QPoint &point)
+{
+    if (!image.rect().contains(point)) {
+        return qRgb(0, 0, 0);
+    }
+    const QRgb pixel = image.pixel(point);
+    return image.format() == QImage::Format_ARGB32_Premultiplied ? qUnpremultiply(pixel) : pixel;
+}
+
+void Magnifier::paint(QPainter &painter, const TiledImage &source, const QPoint &cursor,
+                      const QRect &bounds, const QSize &selectionSize, const QTransform &toSource) const
+{
+    const QRect area = rectFor(cursor, bounds);
+    const QPoint center = toSource.map(cursor);
+    const int span = m_radius * 2 + 1;
+    const int zoomSize = span * m_cellSize;
+
+    // 先把光标周围span×span个像素拷到小图，再整体最近邻放大，避免逐格fillRect
+    QImage patch(span, span, QImage::Format_RGB32);
+    for (int y = 0; y < span; ++y) {
+        QRgb *out = reinterpret_cast<QRgb *>(patch.scanLine(y));
+        const int sy = center.y() - m_radius + y;
+        for (int x = 0; x < span; ++x) {
+            out[x] = pixelAt(source, QPoint(center.x() - m_radius + x, sy)) | 0xff000000;
+        }
+    }
+
+    painter.save();
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, false);
+    painter.setRenderHint(QPainter::Antialiasing, false);
+
+    const QRect zoomRect(area.topLeft() + QPoint(1, 1), QSize(zoomSize, zoomSize));
+    painter.fillRect(area, QColor(30, 30, 30, 220));
+    painter.drawImage(zoomRect, patch);
+
+    // 像素网格和光标所在像素的边框
+    painter.setPen(QPen(QColor(255, 255, 255, 40), 1));
+    for (int i = 1; i < span; ++i) {
+        const int offset = i * m_cellSize;
+        painter.drawLine(zoomRect.left() + offset, zoomRect.top(), zoomRect.left() + offset, zoomRect.bottom());
+        painter.drawLine(zoomRect.left(), zoomRect.top() + offset, zoomRect.right(), zoomRect.top() + offset);
+    }
+    painter.setPen(QPen(QColor(0, 170, 255), 1));
+    painter.drawRect(QRect(zoomRect.topLeft() + QPoint(m_radius * m_cellSize, m_radius * m_cellSize),
+                           QSize(m_cellSize, m_cellSize)));
+    painter.setPen(QPen(Qt::white, 1));
+    painter.drawRect(area.adjusted(0, 0, -1, -1));
+
+    // 信息区：坐标、选区大小、颜色
+    const QRgb color = pixelAt(source, center);
+    const QString hex = QColor(color).name().toUpper();
+    const QString lines[kInfoLines] = {
+        QString("(%1, %2)").arg(cursor.x()).arg(cursor.y()),
+        QString("%1 × %2").arg(selectionSize.width()).arg(selectionSize.height()),
+        hex,
+        QString("RGB(%1, %2, %3)").arg(qRed(color)).arg(qGreen(color)).arg(qBlue(color)),
+    };
+    QFont font = painter.font();
+    font.setPixelSize(m_textHeight - 4);
+    painter.setFont(font);
+    const int textTop = zoomRect.bottom() + 3;
+    for (int i = 0; i < kInfoLines; ++i) {
+        painter.drawText(QRect(area.left() + 4, textTop + i * m_textHeight, area.width() - 8, m_textHeight),
+                         Qt::AlignLeft | Qt::AlignVCenter, lines[i]);
+    }
+    // 十六进制颜色那一行右侧画一个色块
+    painter.fillRect(QRect(area.right() - m_textHeight, textTop + 2 * m_textHeight + 3,
+                           m_textHeight - 6, m_textHeight - 6), QColor(color));
+
+    painter.restore();
+}
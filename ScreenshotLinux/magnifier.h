@@ -0,0 +1,37 @@
+#ifndef MAGNIFIER_H
+#define MAGNIFIER_H
+
+#include <QImage>
+#include <QPainter>
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+#include <QTransform>
+#include "tiledimage.h"
+
+// 跟随光标的放大镜：最近邻放大的像素网格，加上坐标、选区大小和光标处颜色
+// 颜色直接从截图的块中读取，不访问屏幕；只绘制自己的小矩形，
+// 调用方用 rectFor() 得到新旧位置并只刷新这两块区域
+class Magnifier
+{
+public:
+    Magnifier();
+
+    // 光标在cursor时放大镜占据的矩形，靠近边缘时翻到光标另一侧，保证完全落在bounds内
+    QRect rectFor(const QPoint &cursor, const QRect &bounds) const;
+
+    // cursor和bounds是画布坐标；toSource把画布坐标换算到source的像素，放大的是光标处的截图像素
+    void paint(QPainter &painter, const TiledImage &source, const QPoint &cursor,
+               const QRect &bounds, const QSize &selectionSize,
+               const QTransform &toSource = QTransform()) const;
+
+    // 读取一个像素并去掉预乘，超出图像或落在未分配的块里返回黑色
+    static QRgb pixelAt(const TiledImage &image, const QPoint &point);
+
+private:
+    int m_radius;     // 光标两侧各显示的源像素数
+    int m_cellSize;   // 每个源像素放大后的边长
+    int m_textHeight; // 信息区每行高度
+};
+
+#endif // MAGNIFIER_H
@@ -1,15 +1,86 @@
 #include <QApplication>
 #include <QScreen>
-#include <QDebug>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QLoggingCategory>
+#include <cstdio>
 #include "screenshotwindow.h"
+#include "commandline.h"
+#include "headlesscapture.h"
+#include "intervalcapture.h"
+#include "recordcapture.h"
+#include "scrollcapture.h"
+#include "diffcommand.h"
+#include "instanceclient.h"
+#include "instanceserver.h"
+#include "logging.h"
+#include "ringlog.h"
 
 int main(int argc, char *argv[])
 {
-    // 启用更详细的调试输出
-    QLoggingCategory::setFilterRules("*.debug=true");
-    qSetMessagePattern("[%{time yyyy-MM-dd hh:mm:ss.zzz}] [%{type}] %{message}");
+    QElapsedTimer startupTimer;
+    startupTimer.start();
+    
+    // 先解析命令行，无界面模式不需要创建QApplication和托盘
+    CommandLineOptions options = parseCommandLine(argc, argv);
+    if (!options.errorText.isEmpty()) {
+        std::fprintf(stderr, "%s\n", qPrintable(options.errorText));
+        return 2;
+    }
+    if (options.showHelp) {
+        std::fprintf(stdout, "%s", qPrintable(options.helpText));
+        return 0;
+    }
+    if (options.showVersion) {
+        std::fprintf(stdout, "ScreenshotLinux 1.0\n");
+        return 0;
+    }
+    if (!options.diffFiles.isEmpty()) {
+        return DiffCommand::run(argc, argv, options, startupTimer);
+    }
+    if (options.scroll) {
+        return ScrollCapture::run(argc, argv, options, startupTimer);
+    }
+    if (options.recordSeconds > 0) {
+        return RecordCapture::run(argc, argv, options, startupTimer);
+    }
+    if (options.intervalSeconds > 0) {
+        return IntervalCapture::run(argc, argv, options, startupTimer);
+    }
+    if (options.headless) {
+        return HeadlessCapture::run(argc, argv, options, startupTimer);
+    }
+    if (options.ipcBenchIterations > 0) {
+        return InstanceClient::benchmark(options.ipcBenchIterations);
+    }
+    
+    // 已有常驻实例时只转发命令，不再创建第二个托盘图标
+    const QByteArray command = options.command.isEmpty() ? QByteArray("capture-interactive")
+                                                         : options.command.toUtf8();
+    QByteArray reply;
+    if (InstanceClient::sendCommand(command, &reply)) {
+        std::fprintf(stdout, "%s\n", reply.constData());
+        if (options.timings) {
+            std::fprintf(stderr, "timings: total=%.2fms\n", startupTimer.nsecsElapsed() / 1e6);
+        }
+        return reply.startsWith("ok") ? 0 : 1;
+    }
+    if (options.repeatLast && options.output != "-") {
+        // 没有常驻实例时在本进程内截取，选区记录从配置文件读取
+        options.headless = true;
+        return HeadlessCapture::run(argc, argv, options, startupTimer);
+    }
+    if (!options.command.isEmpty()) {
+        std::fprintf(stderr, "没有正在运行的截图实例\n");
+        return 1;
+    }
+    
+    // 调试输出默认关闭，--verbose 打开本程序各分类的调试输出
+    if (options.verbose) {
+        QLoggingCategory::setFilterRules("screenshot.*.debug=true");
+    }
+    qSetMessagePattern("[%{time yyyy-MM-dd hh:mm:ss.zzz}] [%{type}] [%{category}] %{message}");
+    RingLog::installCrashHandler();
     
     // 设置Qt应用在Wayland下的特定环境变量
     qputenv("QT_WAYLAND_DISABLE_WINDOWDECORATION", "1");
@@ -25,17 +96,39 @@ int main(int argc, char *argv[])
     app.setOrganizationName("ScreenshotLinux");
     app.setOrganizationDomain("screenshot.linux.local");
     
-    qDebug() << "应用程序启动";
-    qDebug() << "平台:" << QApplication::platformName();
-    qDebug() << "是否Wayland?" << QApplication::platformName().contains("wayland", Qt::CaseInsensitive);
+    qCDebug(lcApp) << "应用程序启动";
+    qCDebug(lcApp) << "平台:" << QApplication::platformName();
+    qCDebug(lcApp) << "是否Wayland?" << QApplication::platformName().contains("wayland", Qt::CaseInsensitive);
     
     // 创建截图窗口（将以托盘图标形式运行）
     ScreenshotWindow *window = new ScreenshotWindow();
+    if (!options.traceOutput.isEmpty()) {
+        window->setTraceOutput(options.traceOutput);
+    }
+    if (!options.recordInput.isEmpty()) {
+        window->setInputRecordingPath(options.recordInput);
+    }
+    
+    // 监听本地套接字，接收热键守护进程或其他实例转发的命令
+    InstanceServer *server = new InstanceServer([window](const QString &command) {
+        return window->executeCommand(command);
+    }, &app);
+    if (!server->listen()) {
+        // 两次启动同时走到这里时只有一个能监听成功，输掉的一方把命令转给胜出的实例后退出，
+        // 不留下第二个托盘图标
+        if (InstanceClient::sendCommand(command, &reply)) {
+            std::fprintf(stdout, "%s\n", reply.constData());
+            delete window;
+            return reply.startsWith("ok") ? 0 : 1;
+        }
+        qCWarning(lcApp) << "无法监听实例套接字，命令转发不可用:" << InstanceServer::socketPath();
+    }
     
     // 使用计时器延迟初始化托盘图标，避免Wayland环境下的可能问题
     QTimer::singleShot(500, [window]() {
-        qDebug() << "初始化托盘图标";
+        qCDebug(lcApp) << "初始化托盘图标";
         window->setupTrayIcon();
+        window->prewarmOverlay();
     });
     
     // 安装事件过滤器以确保应用不会意外退出
@@ -43,7 +136,7 @@ int main(int argc, char *argv[])
     protected:
         bool eventFilter(QObject *obj, QEvent *event) override {
             if (event->type() == QEvent::Quit) {
-                qDebug() << "捕获到退出事件，阻止默认处理";
+                qCDebug(lcApp) << "捕获到退出事件，阻止默认处理";
                 return true; // 阻止应用退出
             }
             return QObject::eventFilter(obj, event);
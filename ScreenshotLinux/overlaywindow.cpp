@@ -0,0 +1,131 @@
+#include "overlaywindow.h"
+#include "screenshotwindow.h"
+#include "trace.h"
+#include <QBackingStore>
+#include <QCloseEvent>
+#include <QCoreApplication>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScreen>
+#include <QWindow>
+
+OverlayWindow::OverlayWindow(ScreenshotWindow *controller, QScreen *screen, const QRect &canvasRect, bool live)
+    : QWidget(nullptr)
+    , m_controller(controller)
+    , m_screen(screen)
+    , m_canvasRect(canvasRect)
+    , m_live(live)
+{
+    setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint);
+    if (m_live) {
+        // 需要带透明通道的窗口，必须在创建原生窗口之前设置
+        setAttribute(Qt::WA_TranslucentBackground);
+    } else {
+        // 截图总是完全覆盖窗口，不需要Qt先清除背景
+        setAttribute(Qt::WA_OpaquePaintEvent);
+    }
+    setMouseTracking(true);
+    setGeometry(screen->geometry());
+
+    // 提前创建原生窗口并固定到对应屏幕，显示时不再创建
+    create();
+    if (QWindow *window = windowHandle()) {
+        window->setScreen(screen);
+    }
+}
+
+void OverlayWindow::setCapture(const TiledImage &capture, const QTransform &toCapture)
+{
+    m_capture = capture;
+    m_toCapture = toCapture;
+}
+
+void OverlayWindow::clearCapture()
+{
+    m_capture = TiledImage();
+    m_toCapture = QTransform();
+}
+
+void OverlayWindow::showOnScreen()
+{
+    if (!m_screen) {
+        return;
+    }
+    setGeometry(m_screen->geometry());
+    showFullScreen();
+}
+
+void OverlayWindow::allocateBackingStore()
+{
+    QBackingStore *store = backingStore();
+    if (!store) {
+        return;
+    }
+    // 按窗口大小开始并结束一次绘制（不flush），平台插件在这里分配整屏的缓冲区；
+    // 显示时重绘管理器以相同大小resize，直接复用这块缓冲区
+    const QRect area(QPoint(0, 0), size());
+    store->resize(area.size());
+    store->beginPaint(area);
+    store->endPaint();
+}
+
+void OverlayWindow::paintEvent(QPaintEvent *event)
+{
+    TRACE_SCOPE("overlay.paint");
+    QPainter painter(this);
+
+    // 之后都按画布坐标绘制，只画与本次刷新区域相交的块
+    painter.translate(-m_canvasRect.topLeft());
+    const QRect dirty = event->rect().translated(m_canvasRect.topLeft());
+    if (m_live) {
+        // 透明窗口：先清成全透明，只绘制遮罩和选区，桌面透过窗口可见
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.fillRect(dirty, Qt::transparent);
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    } else {
+        if (!m_capture.rect().contains(m_toCapture.mapRect(dirty))) {
+            painter.fillRect(dirty, Qt::black); // 截图没有覆盖到的部分
+        }
+        // 截图的设备像素按后备存储的设备像素比画回来，高分屏上不损失清晰度
+        m_capture.draw(painter, dirty, m_toCapture);
+    }
+
+    m_controller->paintOverlay(painter, dirty);
+}
+
+void OverlayWindow::forwardMouseEvent(QMouseEvent *event)
+{
+    // 按下后鼠标被当前窗口捕获，拖到其他屏幕时坐标超出本窗口，换算后仍然正确，选区可以跨屏
+    QMouseEvent translated(event->type(), event->position() + m_canvasRect.topLeft(),
+                           event->globalPosition(), event->button(), event->buttons(),
+                           event->modifiers(), event->pointingDevice());
+    QCoreApplication::sendEvent(m_controller, &translated);
+    event->setAccepted(translated.isAccepted());
+}
+
+void OverlayWindow::mousePressEvent(QMouseEvent *event)
+{
+    forwardMouseEvent(event);
+}
+
+void OverlayWindow::mouseMoveEvent(QMouseEvent *event)
+{
+    forwardMouseEvent(event);
+}
+
+void OverlayWindow::mouseReleaseEvent(QMouseEvent *event)
+{
+    forwardMouseEvent(event);
+}
+
+void OverlayWindow::keyPressEvent(QKeyEvent *event)
+{
+    QCoreApplication::sendEvent(m_controller, event);
+}
+
+void OverlayWindow::closeEvent(QCloseEvent *event)
+{
+    // 由ScreenshotWindow决定是取消截图还是真正关闭
+    QCoreApplication::sendEvent(m_controller, event);
+}
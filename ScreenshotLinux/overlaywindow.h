@@ -0,0 +1,56 @@
+#ifndef OVERLAYWINDOW_H
+#define OVERLAYWINDOW_H
+
+#include <QWidget>
+#include <QPointer>
+#include <QRect>
+#include <QScreen>
+#include <QTransform>
+#include "tiledimage.h"
+
+class ScreenshotWindow;
+
+// 单个屏幕上的遮罩窗口：只绘制截图中属于该屏幕的那些块（实时选区模式下是透明窗口，不绘制截图），后备存储按该屏幕的设备像素比创建，
+// 只重绘自己的像素；选区、标注等状态都在ScreenshotWindow里，以画布坐标
+// （虚拟桌面左上角为原点）保存，鼠标和键盘事件换算成画布坐标后转发给它
+class OverlayWindow : public QWidget
+{
+    Q_OBJECT
+
+public:
+    // live为true时创建透明窗口，在实时桌面上选择区域，确定后才截图
+    OverlayWindow(ScreenshotWindow *controller, QScreen *screen, const QRect &canvasRect, bool live = false);
+
+    QScreen *targetScreen() const { return m_screen; }
+    bool isLive() const { return m_live; }
+    QRect canvasRect() const { return m_canvasRect; } // 该屏幕在画布中的位置
+
+    // 共享截图的块，不复制像素；截图在会话期间保持不变。截图按设备像素保存，
+    // toCapture把画布坐标换算到截图像素，本窗口按它取自己那一块
+    void setCapture(const TiledImage &capture, const QTransform &toCapture = QTransform());
+    void clearCapture();
+
+    void showOnScreen();
+    // 隐藏状态下分配平台后备存储的缓冲区：create()只创建原生窗口，缓冲区要到第一次绘制时才分配
+    void allocateBackingStore();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void closeEvent(QCloseEvent *event) override;
+
+private:
+    void forwardMouseEvent(QMouseEvent *event);
+
+    ScreenshotWindow *m_controller;
+    QPointer<QScreen> m_screen; // 屏幕被移除后变为空，等待重建
+    QRect m_canvasRect;
+    bool m_live;
+    TiledImage m_capture;
+    QTransform m_toCapture;
+};
+
+#endif // OVERLAYWINDOW_H
@@ -0,0 +1,44 @@
+#ifndef PARALLELROWS_H
+#define PARALLELROWS_H
+
+#include <QtGlobal>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// 按行分块并行：图像的行分成连续的若干块，每块在一个线程上处理，调用线程自己处理第0块
+// 各块只写自己的行和自己那一份中间结果，最后由调用方合并，不需要加锁
+// 工作函数按引用捕获外部变量，内层循环的边界和常量要先复制到局部变量，
+// 否则编译器认为写输出可能改变它们，无法确定迭代次数，不会向量化
+namespace ParallelRows {
+
+// 每个线程至少处理的行数，小图不值得开线程
+const int kMinRowsPerThread = 64;
+
+// rows行实际使用的线程数；requested <= 0 时按核心数，留出spareCores个核心
+inline int threadCount(int rows, int requested, int spareCores = 0)
+{
+    if (requested <= 0) {
+        requested = int(std::thread::hardware_concurrency()) - spareCores;
+    }
+    return qBound(1, requested, qMax(1, rows / kMinRowsPerThread));
+}
+
+// 在threadCount个线程上分别调用work(band)，band为0..threadCount-1，返回时所有块都已完成
+template <typename Work>
+void run(int threadCount, const Work &work)
+{
+    std::vector<std::thread> workers;
+    workers.reserve(size_t(qMax(0, threadCount - 1)));
+    for (int band = 1; band < threadCount; ++band) {
+        workers.emplace_back(std::cref(work), band);
+    }
+    work(0);
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+} // namespace ParallelRows
+
+#endif // PARALLELROWS_H
@@ -0,0 +1,56 @@
+#include "processstats.h"
+#include <QDir>
+#include <QFile>
+
+namespace {
+
+// /proc/.../status中 "Name:   数值 [kB]" 形式的一行
+qint64 statusValue(const QByteArray &status, const QByteArray &name)
+{
+    const int begin = status.indexOf("\n" + name + ":");
+    if (begin < 0) {
+        return -1;
+    }
+    const int valueBegin = begin + name.size() + 2;
+    const int end = status.indexOf('\n', valueBegin);
+    bool ok = false;
+    const qint64 value = status.mid(valueBegin, end < 0 ? -1 : end - valueBegin)
+                             .trimmed().split(' ').value(0).toLongLong(&ok);
+    return ok ? value : -1;
+}
+
+QByteArray readStatus(const QString &path)
+{
+    // /proc下的文件大小为0，只能读到文件末尾；前面补换行，第一行也能按 "\nName:" 查找
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? "\n" + file.readAll() : QByteArray();
+}
+
+} // namespace
+
+namespace ProcessStats {
+
+Snapshot current()
+{
+    Snapshot snapshot;
+    const qint64 rssKb = statusValue(readStatus(QStringLiteral("/proc/self/status")), "VmRSS");
+    if (rssKb >= 0) {
+        snapshot.rssBytes = rssKb * 1024;
+    }
+
+    // 进程的status只统计主线程，后台线程的唤醒要逐个线程累加
+    const QStringList tasks = QDir(QStringLiteral("/proc/self/task")).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &task : tasks) {
+        const QByteArray status = readStatus(QStringLiteral("/proc/self/task/%1/status").arg(task));
+        const qint64 voluntary = statusValue(status, "voluntary_ctxt_switches");
+        const qint64 involuntary = statusValue(status, "nonvoluntary_ctxt_switches");
+        if (voluntary < 0 || involuntary < 0) {
+            continue;
+        }
+        snapshot.voluntarySwitches = qMax<qint64>(0, snapshot.voluntarySwitches) + voluntary;
+        snapshot.involuntarySwitches = qMax<qint64>(0, snapshot.involuntarySwitches) + involuntary;
+    }
+    return snapshot;
+}
+
+} // namespace ProcessStats
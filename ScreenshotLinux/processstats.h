@@ -0,0 +1,26 @@
+#ifndef PROCESSSTATS_H
+#define PROCESSSTATS_H
+
+#include <QtGlobal>
+
+// 当前进程的资源占用，用于观察常驻托盘进程空闲时的内存和唤醒次数
+// 读取/proc/self，非Linux或读取失败时各项为-1
+namespace ProcessStats {
+
+struct Snapshot {
+    qint64 rssBytes = -1;
+    // 所有线程的上下文切换次数之和；主动切换基本对应一次睡眠和唤醒
+    qint64 voluntarySwitches = -1;
+    qint64 involuntarySwitches = -1;
+
+    qint64 contextSwitches() const
+    {
+        return voluntarySwitches < 0 ? -1 : voluntarySwitches + qMax<qint64>(0, involuntarySwitches);
+    }
+};
+
+Snapshot current();
+
+} // namespace ProcessStats
+
+#endif // PROCESSSTATS_H
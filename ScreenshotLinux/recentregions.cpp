@@ -0,0 +1,96 @@
+#include "recentregions.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <QSettings>
+#include <QStringList>
+
+namespace {
+
+// 命令行模式不设置应用名，显式指定配置文件，与托盘进程读写同一份
+const char kSettingsName[] = "ScreenshotLinux";
+
+QString rectToString(const QRect &rect)
+{
+    return QString("%1,%2,%3,%4").arg(rect.x()).arg(rect.y()).arg(rect.width()).arg(rect.height());
+}
+
+QRect rectFromString(const QString &text)
+{
+    const QStringList parts = text.split(',');
+    if (parts.size() != 4) {
+        return QRect();
+    }
+    return QRect(parts[0].toInt(), parts[1].toInt(), parts[2].toInt(), parts[3].toInt());
+}
+
+} // namespace
+
+QString RecentRegions::currentLayout()
+{
+    QStringList screens;
+    for (const QScreen *screen : QGuiApplication::screens()) {
+        screens << QString("%1@%2").arg(rectToString(screen->geometry())).arg(screen->devicePixelRatio());
+    }
+    return screens.join(';');
+}
+
+void RecentRegions::load()
+{
+    m_entries.clear();
+    QSettings settings(kSettingsName, kSettingsName);
+    const int count = settings.beginReadArray(QStringLiteral("recentRegions"));
+    for (int i = 0; i < qMin(count, int(MaxEntries)); ++i) {
+        settings.setArrayIndex(i);
+        const Entry entry{ rectFromString(settings.value("region").toString()),
+                           settings.value("layout").toString() };
+        if (entry.region.isValid()) {
+            m_entries.append(entry);
+        }
+    }
+    settings.endArray();
+}
+
+void RecentRegions::save() const
+{
+    QSettings settings(kSettingsName, kSettingsName);
+    settings.remove(QStringLiteral("recentRegions"));
+    settings.beginWriteArray(QStringLiteral("recentRegions"), m_entries.size());
+    for (int i = 0; i < m_entries.size(); ++i) {
+        settings.setArrayIndex(i);
+        settings.setValue("region", rectToString(m_entries.at(i).region));
+        settings.setValue("layout", m_entries.at(i).layout);
+    }
+    settings.endArray();
+}
+
+void RecentRegions::remember(const QRect &region, const QString &layout)
+{
+    if (!region.isValid()) {
+        return;
+    }
+    for (int i = m_entries.size() - 1; i >= 0; --i) {
+        if (m_entries.at(i).region == region && m_entries.at(i).layout == layout) {
+            m_entries.removeAt(i);
+        }
+    }
+    m_entries.prepend(Entry{ region, layout });
+    while (m_entries.size() > MaxEntries) {
+        m_entries.removeLast();
+    }
+}
+
+QRect RecentRegions::regionFor(const QString &layout, int index) const
+{
+    return regionsFor(layout).value(index);
+}
+
+QList<QRect> RecentRegions::regionsFor(const QString &layout) const
+{
+    QList<QRect> regions;
+    for (const Entry &entry : m_entries) {
+        if (entry.layout == layout) {
+            regions.append(entry.region);
+        }
+    }
+    return regions;
+}
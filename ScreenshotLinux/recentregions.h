@@ -0,0 +1,40 @@
+#ifndef RECENTREGIONS_H
+#define RECENTREGIONS_H
+
+#include <QList>
+#include <QRect>
+#include <QString>
+
+// 最近确定过的选区（虚拟桌面逻辑坐标）及选择时的屏幕布局，用于不显示遮罩直接重复截取同一区域
+// 屏幕布局变化后原来的坐标可能落在别的屏幕上，只有布局相同的记录才会被重复截取
+// 保存在配置文件的 [recentRegions] 中，托盘进程和命令行模式共用
+class RecentRegions
+{
+public:
+    static constexpr int MaxEntries = 8;
+
+    struct Entry {
+        QRect region;
+        QString layout;
+    };
+
+    // 当前屏幕布局的签名：各屏幕的几何和缩放比例，需要已创建QGuiApplication
+    static QString currentLayout();
+
+    void load();
+    void save() const;
+
+    // 放到最前面，相同的区域和布局只保留一条
+    void remember(const QRect &region, const QString &layout);
+
+    // 布局匹配的第index条记录（0为最近一次），没有时返回无效矩形
+    QRect regionFor(const QString &layout, int index = 0) const;
+    QList<QRect> regionsFor(const QString &layout) const;
+
+    const QList<Entry> &entries() const { return m_entries; }
+
+private:
+    QList<Entry> m_entries; // 最近的在前
+};
+
+#endif // RECENTREGIONS_H
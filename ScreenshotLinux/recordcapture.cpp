@@ -0,0 +1,47 @@
+#include "recordcapture.h"
+#include "commandline.h"
+#include "headlesscapture.h"
+#include "screenrecorder.h"
+#include <QGuiApplication>
+#include <QTimer>
+#include <cstdio>
+
+namespace RecordCapture {
+
+int run(int argc, char *argv[], const CommandLineOptions &options, const QElapsedTimer &startupTimer)
+{
+    HeadlessCapture::preparePlatform(argc, argv);
+
+    QGuiApplication app(argc, argv);
+    HeadlessCapture::checkOffscreenCapture(options.region);
+    const double startupMs = HeadlessCapture::elapsedMs(startupTimer);
+
+    ScreenRecorder::Options recorderOptions;
+    recorderOptions.region = options.region;
+    recorderOptions.output = options.output;
+    recorderOptions.fps = options.fps;
+    ScreenRecorder recorder(recorderOptions);
+    QString error;
+    if (!recorder.start(&error)) {
+        std::fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+
+    QTimer::singleShot(int(options.recordSeconds * 1000), &app, &QGuiApplication::quit);
+    app.exec();
+
+    const ScreenRecorder::Stats stats = recorder.stop(&error);
+    // 丢帧总是报告，录制结果是否可用要看它
+    std::fprintf(stderr, "recorded: frames=%d dropped=%d written=%d duration=%.2fs bytes=%lld\n",
+                 stats.captured, stats.dropped, stats.written, stats.seconds, stats.bytes);
+    if (options.timings) {
+        std::fprintf(stderr, "timings: startup=%.2fms fps=%d\n", startupMs, recorder.options().fps);
+    }
+    if (!error.isEmpty()) {
+        std::fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace RecordCapture
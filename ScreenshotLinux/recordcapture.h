@@ -0,0 +1,15 @@
+#ifndef RECORDCAPTURE_H
+#define RECORDCAPTURE_H
+
+#include <QElapsedTimer>
+
+struct CommandLineOptions;
+
+// 命令行录制：按帧率录制区域指定的秒数，写出GIF或视频后退出（见ScreenRecorder）
+namespace RecordCapture {
+
+int run(int argc, char *argv[], const CommandLineOptions &options, const QElapsedTimer &startupTimer);
+
+} // namespace RecordCapture
+
+#endif // RECORDCAPTURE_H
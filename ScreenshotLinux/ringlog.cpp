@@ -0,0 +1,137 @@
+#include "ringlog.h"
+#include <QFile>
+#include <csignal>
+#include <cstring>
+#include <unistd.h>
+
+namespace RingLog {
+
+Entry g_entries[kCapacity];
+std::atomic<uint64_t> g_head{0};
+
+namespace {
+
+// 不依赖printf的整数格式化，可以在信号处理函数中使用
+char *appendInt(char *out, char *end, int64_t value, int minDigits = 1)
+{
+    char digits[24];
+    int count = 0;
+    const bool negative = value < 0;
+    uint64_t v = negative ? uint64_t(-(value + 1)) + 1 : uint64_t(value);
+    do {
+        digits[count++] = char('0' + v % 10);
+        v /= 10;
+    } while (v != 0 && count < int(sizeof(digits)));
+    while (count < minDigits && count < int(sizeof(digits))) {
+        digits[count++] = '0';
+    }
+    if (negative && out < end) {
+        *out++ = '-';
+    }
+    while (count > 0 && out < end) {
+        *out++ = digits[--count];
+    }
+    return out;
+}
+
+char *appendText(char *out, char *end, const char *text)
+{
+    while (text && *text && out < end) {
+        *out++ = *text++;
+    }
+    return out;
+}
+
+// 格式化一条记录："[秒.微秒] 消息 a b\n"，返回写入的字节数，记录无效时返回0
+size_t formatEntry(const Entry &entry, uint64_t expectedSequence, char *buffer, size_t size)
+{
+    if (entry.sequence.load(std::memory_order_acquire) != expectedSequence) {
+        return 0;
+    }
+    const int64_t timestampNs = entry.timestampNs;
+    const char *message = entry.message;
+    const int64_t a = entry.a;
+    const int64_t b = entry.b;
+    // 读取过程中被新记录覆盖则丢弃
+    if (entry.sequence.load(std::memory_order_acquire) != expectedSequence) {
+        return 0;
+    }
+
+    char *out = buffer;
+    char *end = buffer + size;
+    out = appendText(out, end, "[");
+    out = appendInt(out, end, timestampNs / 1000000000);
+    out = appendText(out, end, ".");
+    out = appendInt(out, end, (timestampNs % 1000000000) / 1000, 6);
+    out = appendText(out, end, "] ");
+    out = appendText(out, end, message);
+    out = appendText(out, end, " ");
+    out = appendInt(out, end, a);
+    out = appendText(out, end, " ");
+    out = appendInt(out, end, b);
+    out = appendText(out, end, "\n");
+    return size_t(out - buffer);
+}
+
+template <typename Sink>
+void forEachFormatted(Sink sink)
+{
+    const uint64_t head = g_head.load(std::memory_order_acquire);
+    const uint64_t first = head > kCapacity ? head - kCapacity : 0;
+    char line[256];
+    for (uint64_t index = first; index < head; ++index) {
+        const size_t length = formatEntry(g_entries[index & (kCapacity - 1)], index + 1, line, sizeof(line));
+        if (length > 0) {
+            sink(line, length);
+        }
+    }
+}
+
+void crashHandler(int signalNumber)
+{
+    static const char header[] = "\n=== ScreenshotLinux 崩溃，最近的环形日志 ===\n";
+    ssize_t ignored = ::write(STDERR_FILENO, header, sizeof(header) - 1);
+    forEachFormatted([&ignored](const char *line, size_t length) {
+        ignored = ::write(STDERR_FILENO, line, length);
+    });
+    (void)ignored;
+
+    // 处理函数注册时带SA_RESETHAND，重新发送信号以默认方式终止并生成core
+    ::raise(signalNumber);
+}
+
+} // namespace
+
+QByteArray dump()
+{
+    QByteArray result;
+    forEachFormatted([&result](const char *line, size_t length) {
+        result.append(line, qsizetype(length));
+    });
+    return result;
+}
+
+bool dumpToFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    const QByteArray text = dump();
+    return file.write(text) == text.size();
+}
+
+void installCrashHandler()
+{
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = crashHandler;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+
+    for (int signalNumber : { SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL }) {
+        sigaction(signalNumber, &action, nullptr);
+    }
+}
+
+} // namespace RingLog
@@ -0,0 +1,55 @@
+#ifndef RINGLOG_H
+#define RINGLOG_H
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <time.h>
+
+// 热路径使用的无锁环形日志
+// 每条记录只保存时间戳、静态字符串指针和两个整数参数，不做任何格式化；
+// 只在需要时（IPC命令或进程崩溃）才格式化输出最近的记录
+namespace RingLog {
+
+struct Entry {
+    std::atomic<uint64_t> sequence; // 写入完成后的序号+1，读取时用于检测被覆盖的记录
+    int64_t timestampNs;            // CLOCK_MONOTONIC
+    const char *message;            // 必须是静态字符串
+    int64_t a;
+    int64_t b;
+};
+
+constexpr uint64_t kCapacity = 4096; // 必须是2的幂
+static_assert((kCapacity & (kCapacity - 1)) == 0, "kCapacity must be a power of two");
+
+extern Entry g_entries[kCapacity];
+extern std::atomic<uint64_t> g_head;
+
+inline void record(const char *message, int64_t a = 0, int64_t b = 0)
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    const uint64_t index = g_head.fetch_add(1, std::memory_order_relaxed);
+    Entry &entry = g_entries[index & (kCapacity - 1)];
+    entry.sequence.store(0, std::memory_order_relaxed);
+    entry.timestampNs = int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    entry.message = message;
+    entry.a = a;
+    entry.b = b;
+    entry.sequence.store(index + 1, std::memory_order_release);
+}
+
+// 按时间顺序格式化当前缓冲区内容
+QByteArray dump();
+
+// 写到文件，返回是否成功
+bool dumpToFile(const QString &filePath);
+
+// 崩溃时把环形日志写到标准错误，只使用异步信号安全的函数
+void installCrashHandler();
+
+} // namespace RingLog
+
+#endif // RINGLOG_H
@@ -0,0 +1,625 @@
+#include "screencapture.h"
+#include "captureframe.h"
+#include "logging.h"
+#include "trace.h"
+#include <QGuiApplication>
+#include <QScreen>
+#include <QPainter>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QDir>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QTextStream>
+
+#ifdef SCREENSHOT_HAVE_XCB_SHM
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <cstdlib>
+#endif
+
+namespace {
+
+struct RegionTool {
+    const char *program;   // 可执行文件名，通过PATH查找
+    bool forWayland;       // 适用于Wayland会话还是X11会话
+    const char *format;    // 标准输出上的图像格式
+};
+
+// 按优先级排列，全部输出未压缩格式，省去PNG的压缩和解压
+const RegionTool kRegionTools[] = {
+    { "grim",   true,  "PPM" },
+    { "maim",   false, "BMP" },
+    { "import", false, "PPM" },
+};
+
+QStringList toolArguments(const RegionTool &tool, const QRect &region)
+{
+    const QString program = QLatin1String(tool.program);
+    const bool hasRegion = region.isValid();
+    // X11几何字符串格式：WxH+X+Y
+    const QString x11Geometry = QString("%1x%2+%3+%4")
+                                    .arg(region.width()).arg(region.height())
+                                    .arg(region.x()).arg(region.y());
+
+    if (program == "grim") {
+        QStringList args{ "-t", "ppm" };
+        if (hasRegion) {
+            args << "-g" << QString("%1,%2 %3x%4")
+                                .arg(region.x()).arg(region.y())
+                                .arg(region.width()).arg(region.height());
+        }
+        return args << "-";
+    }
+    if (program == "maim") {
+        // 不指定输出文件时maim写到标准输出；-u 不绘制鼠标指针
+        QStringList args{ "-u", "-f", "bmp" };
+        if (hasRegion) {
+            args << "-g" << x11Geometry;
+        }
+        return args;
+    }
+    // ImageMagick import
+    QStringList args{ "-window", "root" };
+    if (hasRegion) {
+        args << "-crop" << x11Geometry;
+    }
+    return args << "ppm:-";
+}
+
+QImage grabWithTool(const RegionTool &tool, const QString &path, const QRect &region)
+{
+    TRACE_SCOPE("capture.backend", QLatin1String(tool.program));
+    QProcess process;
+    process.start(path, toolArguments(tool, region));
+    if (!process.waitForFinished(5000) || process.exitCode() != 0) {
+        qCDebug(lcCapture) << "区域截图工具失败:" << tool.program << process.readAllStandardError();
+        process.kill();
+        return QImage();
+    }
+    const QByteArray output = process.readAllStandardOutput();
+    // PPM直接把工具输出包装成帧，BMP只能解码
+    if (qstrcmp(tool.format, "PPM") == 0) {
+        const QImage frame = CaptureFrame::fromPpm(output);
+        if (!frame.isNull()) {
+            return frame;
+        }
+    }
+    return QImage::fromData(output, tool.format);
+}
+
+#ifdef SCREENSHOT_HAVE_XCB_SHM
+// X11共享内存截图：服务器把像素直接写进本进程映射的共享内存段，这块内存就是帧，
+// 最后一个引用释放时才解除映射；region为根窗口坐标，无效时抓取整个根窗口
+// 只处理常见的24位TrueColor、每像素32位、小端字节序，其他情况返回空图像交给下一个后端
+QImage grabWithXcbShm(const QRect &region)
+{
+    // XWayland的根窗口没有其他Wayland客户端的内容
+    if (qEnvironmentVariableIsSet("WAYLAND_DISPLAY")) {
+        return QImage();
+    }
+    TRACE_SCOPE("capture.backend", QStringLiteral("xcb-shm"));
+
+    int screenNumber = 0;
+    xcb_connection_t *connection = xcb_connect(nullptr, &screenNumber);
+    if (xcb_connection_has_error(connection)) {
+        xcb_disconnect(connection);
+        return QImage();
+    }
+
+    const xcb_setup_t *setup = xcb_get_setup(connection);
+    xcb_screen_iterator_t screens = xcb_setup_roots_iterator(setup);
+    for (int i = 0; i < screenNumber && screens.rem > 0; ++i) {
+        xcb_screen_next(&screens);
+    }
+    const xcb_screen_t *screen = screens.data;
+
+    bool supported = setup->image_byte_order == XCB_IMAGE_ORDER_LSB_FIRST && screen->root_depth == 24;
+    bool found32 = false;
+    for (xcb_format_iterator_t formats = xcb_setup_pixmap_formats_iterator(setup); formats.rem > 0;
+         xcb_format_next(&formats)) {
+        if (formats.data->depth == screen->root_depth) {
+            found32 = formats.data->bits_per_pixel == 32;
+        }
+    }
+    supported = supported && found32;
+
+    const QRect rootRect(0, 0, screen->width_in_pixels, screen->height_in_pixels);
+    const QRect target = region.isValid() ? region.intersected(rootRect) : rootRect;
+
+    xcb_shm_query_version_reply_t *version =
+        supported ? xcb_shm_query_version_reply(connection, xcb_shm_query_version(connection), nullptr) : nullptr;
+    if (!version || target.isEmpty()) {
+        std::free(version);
+        xcb_disconnect(connection);
+        return QImage();
+    }
+    std::free(version);
+
+    const size_t bytes = size_t(target.width()) * size_t(target.height()) * 4;
+    const int shmId = shmget(IPC_PRIVATE, bytes, IPC_CREAT | 0600);
+    void *address = shmId == -1 ? reinterpret_cast<void *>(-1) : shmat(shmId, nullptr, SHM_RDONLY);
+    if (address == reinterpret_cast<void *>(-1)) {
+        if (shmId != -1) {
+            shmctl(shmId, IPC_RMID, nullptr);
+        }
+        xcb_disconnect(connection);
+        return QImage();
+    }
+
+    const xcb_shm_seg_t segment = xcb_generate_id(connection);
+    xcb_shm_attach(connection, segment, shmId, 0);
+    xcb_shm_get_image_reply_t *reply = xcb_shm_get_image_reply(
+        connection,
+        xcb_shm_get_image(connection, screen->root, qint16(target.x()), qint16(target.y()),
+                          quint16(target.width()), quint16(target.height()), ~0u,
+                          XCB_IMAGE_FORMAT_Z_PIXMAP, segment, 0),
+        nullptr);
+    xcb_shm_detach(connection, segment);
+    // 服务器已经附加过，立即标记删除，进程异常退出也不会遗留共享内存段
+    shmctl(shmId, IPC_RMID, nullptr);
+    xcb_disconnect(connection);
+
+    if (!reply) {
+        shmdt(address);
+        return QImage();
+    }
+    std::free(reply);
+
+    return CaptureFrame::wrap(static_cast<const uchar *>(address), target.size(), target.width() * 4,
+                              QImage::Format_RGB32, [address]() { shmdt(address); });
+}
+#endif
+
+QImage grabWithQt(const QRect &region)
+{
+    TRACE_SCOPE("capture.backend", QStringLiteral("qt"));
+    const QList<QScreen *> screens = QGuiApplication::screens();
+    if (screens.isEmpty()) {
+        return QImage();
+    }
+
+    QRect target = region;
+    if (!target.isValid()) {
+        for (QScreen *screen : screens) {
+            target = target.united(screen->geometry());
+        }
+    }
+
+    // 常见情况：区域完全落在一个屏幕内，直接只抓取这块区域
+    for (QScreen *screen : screens) {
+        const QRect screenGeom = screen->geometry();
+        if (screenGeom.contains(target)) {
+            const QPoint local = target.topLeft() - screenGeom.topLeft();
+            return screen->grabWindow(0, local.x(), local.y(), target.width(), target.height()).toImage();
+        }
+    }
+
+    // 跨屏区域：逐屏抓取相交部分并按逻辑坐标拼接，输出使用最大的设备像素比
+    qreal dpr = 1.0;
+    for (QScreen *screen : screens) {
+        if (screen->geometry().intersects(target)) {
+            dpr = qMax(dpr, screen->devicePixelRatio());
+        }
+    }
+    QImage result(target.size() * dpr, QImage::Format_ARGB32_Premultiplied);
+    result.setDevicePixelRatio(dpr);
+    result.fill(Qt::transparent);
+
+    QPainter painter(&result);
+    for (QScreen *screen : screens) {
+        const QRect part = screen->geometry().intersected(target);
+        if (part.isEmpty()) {
+            continue;
+        }
+        const QPoint local = part.topLeft() - screen->geometry().topLeft();
+        QPixmap piece = screen->grabWindow(0, local.x(), local.y(), part.width(), part.height());
+        painter.drawPixmap(QRect(part.topLeft() - target.topLeft(), part.size()), piece);
+    }
+    painter.end();
+    CaptureFrame::noteCopy(result.sizeInBytes());
+    return result;
+}
+
+void setBackend(QString *backendUsed, const QString &name)
+{
+    if (backendUsed) {
+        *backendUsed = name;
+    }
+}
+
+} // namespace
+
+namespace ScreenCapture {
+
+bool sessionIsWayland()
+{
+    if (QGuiApplication::instance() &&
+        !QGuiApplication::platformName().contains("offscreen", Qt::CaseInsensitive)) {
+        return QGuiApplication::platformName().contains("wayland", Qt::CaseInsensitive);
+    }
+    return qEnvironmentVariableIsSet("WAYLAND_DISPLAY") ||
+           qgetenv("XDG_SESSION_TYPE").compare("wayland", Qt::CaseInsensitive) == 0;
+}
+
+bool hasExternalRegionTool()
+{
+    const bool wayland = sessionIsWayland();
+    for (const RegionTool &tool : kRegionTools) {
+        if (tool.forWayland == wayland &&
+            !QStandardPaths::findExecutable(QLatin1String(tool.program)).isEmpty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QImage grabRegion(const QRect &region, QString *backendUsed, int backends)
+{
+    const bool wayland = sessionIsWayland();
+#ifdef SCREENSHOT_HAVE_XCB_SHM
+    if (!wayland && (backends & ExternalBackends)) {
+        const QImage frame = grabWithXcbShm(region);
+        if (!frame.isNull()) {
+            setBackend(backendUsed, QStringLiteral("xcb-shm"));
+            return frame;
+        }
+    }
+#endif
+    for (const RegionTool &tool : kRegionTools) {
+        if (tool.forWayland != wayland || !(backends & ExternalBackends)) {
+            continue;
+        }
+        const QString path = QStandardPaths::findExecutable(QLatin1String(tool.program));
+        if (path.isEmpty()) {
+            continue;
+        }
+        QImage image = grabWithTool(tool, path, region);
+        if (!image.isNull()) {
+            if (backendUsed) {
+                *backendUsed = QLatin1String(tool.program);
+            }
+            return image;
+        }
+    }
+
+    // offscreen平台下没有真实屏幕，Qt原生方法无法工作
+    if (!(backends & QtBackend) || QGuiApplication::platformName().contains("offscreen", Qt::CaseInsensitive)) {
+        return QImage();
+    }
+
+    if (backendUsed) {
+        *backendUsed = QStringLiteral("qt");
+    }
+    return grabWithQt(region);
+}
+
+TiledImage grabDesktop(QString *backendUsed)
+{
+    TiledImage result;
+    
+    // 获取屏幕截图的更可靠方法
+    bool captureSuccess = false;
+    
+    // 检测当前显示服务器环境
+    bool isWayland = QGuiApplication::platformName().contains("wayland", Qt::CaseInsensitive);
+    qCDebug(lcCapture) << "当前平台:" << QGuiApplication::platformName() << (isWayland ? "(Wayland)" : "(可能是X11)");
+    
+    // 在Wayland环境下，优先使用外部工具进行截图，避免放大问题
+    if (isWayland) {
+        // 尝试使用特定的Wayland屏幕捕获工具
+        QString tempFile = QDir::tempPath() + "/screenshot_" + 
+                          QString::number(QRandomGenerator::global()->generate()) + ".png";
+        
+        // 确保临时文件路径没有非ASCII字符
+        if (tempFile.contains(QRegularExpression("[^\\x00-\\x7F]"))) {
+            tempFile = "/tmp/screenshot_" + 
+                      QString::number(QRandomGenerator::global()->generate()) + ".png";
+        }
+        
+        qCDebug(lcCapture) << "使用临时文件:" << tempFile;
+        
+        // 特别优先使用适合Wayland的工具
+        QStringList waylandCmds;
+        
+        if (QFile::exists("/usr/bin/grim")) {
+            waylandCmds << "/usr/bin/grim \"" + tempFile + "\"";
+        }
+        
+        if (QFile::exists("/usr/bin/spectacle")) {
+            waylandCmds << "/usr/bin/spectacle -b -n -o \"" + tempFile + "\"";
+        }
+        
+        for (const QString &cmd : waylandCmds) {
+            if (captureSuccess) break;
+            
+            qCDebug(lcCapture) << "尝试使用Wayland专用命令捕获屏幕:" << cmd;
+            TRACE_SCOPE("capture.backend", cmd);
+            
+            QProcess process;
+            process.setProcessChannelMode(QProcess::MergedChannels);
+            
+            try {
+                process.start("bash", QStringList() << "-c" << cmd);
+                
+                if (process.waitForFinished(5000)) {
+                    if (process.exitCode() == 0) {
+                        QFile file(tempFile);
+                        if (file.exists() && file.size() > 0) {
+                            qCDebug(lcCapture) << "临时文件创建成功，大小:" << file.size() << "字节";
+                            
+                            // 加载临时文件
+                            QImage capturedImage(tempFile);
+                            if (!capturedImage.isNull()) {
+                                result = TiledImage::fromImage(capturedImage);
+                                setBackend(backendUsed, cmd);
+                                qCDebug(lcCapture) << "使用Wayland专用工具" << cmd << "捕获屏幕成功";
+                                captureSuccess = true;
+                                
+                                // 为安全起见，删除临时文件
+                                QFile::remove(tempFile);
+                                break;
+                            }
+                        }
+                    } else {
+                        qCDebug(lcCapture) << "命令执行失败，退出码:" << process.exitCode();
+                        qCDebug(lcCapture) << "错误输出:" << process.readAllStandardError();
+                    }
+                } else {
+                    qCDebug(lcCapture) << "命令执行超时";
+                }
+            } catch (...) {
+                qCDebug(lcCapture) << "执行Wayland命令时捕获到异常";
+            }
+        }
+        
+        // 如果Wayland专用工具失败，尝试通过XDG-Desktop-Portal截图
+        if (!captureSuccess) {
+            qCDebug(lcCapture) << "尝试使用XDG-Desktop-Portal方法";
+            TRACE_SCOPE("capture.backend", QStringLiteral("xdg-desktop-portal"));
+            
+            // 使用通用XDG-Portal的截图API（适用于大多数现代桌面环境）
+            QProcess process;
+            QString scriptPath = QDir::tempPath() + "/xdg_screenshot_" + 
+                               QString::number(QRandomGenerator::global()->generate()) + ".sh";
+            
+            QFile script(scriptPath);
+            if (script.open(QIODevice::WriteOnly | QIODevice::Text)) {
+                QTextStream out(&script);
+                out << "#!/bin/bash\n";
+                // 使用xdg-desktop-portal提供的截图服务
+                out << "dbus-send --session --print-reply --dest=org.freedesktop.portal.Desktop "
+                       "/org/freedesktop/portal/desktop org.freedesktop.portal.Screenshot.Screenshot "
+                       "boolean:true string:\"" << tempFile << "\" > /dev/null 2>&1\n";
+                out << "sleep 2\n";  // 给操作系统时间保存截图
+                script.close();
+                
+                // 使脚本可执行
+                QFile::setPermissions(scriptPath, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+                
+                process.start("bash", QStringList() << scriptPath);
+                if (process.waitForFinished(10000)) {  // 等待10秒
+                    // 检查文件是否创建
+                    QFile file(tempFile);
+                    if (file.exists() && file.size() > 0) {
+                        QImage capturedImage(tempFile);
+                        if (!capturedImage.isNull()) {
+                            result = TiledImage::fromImage(capturedImage);
+                            setBackend(backendUsed, QStringLiteral("xdg-desktop-portal"));
+                            captureSuccess = true;
+                            qCDebug(lcCapture) << "使用XDG-Desktop-Portal捕获屏幕成功";
+                        }
+                    }
+                }
+                
+                // 清理
+                QFile::remove(scriptPath);
+                QFile::remove(tempFile);
+            }
+        }
+    }
+    
+#ifdef SCREENSHOT_HAVE_XCB_SHM
+    // X11下首选共享内存：一次请求拿到整个根窗口，这一帧直接作为各块的内存
+    if (!captureSuccess && !isWayland) {
+        const QImage frame = grabWithXcbShm(QRect());
+        if (!frame.isNull()) {
+            result = TiledImage::fromImage(frame);
+            setBackend(backendUsed, QStringLiteral("xcb-shm"));
+            captureSuccess = true;
+        }
+    }
+#endif
+    
+    // 如果上述方法都失败，或者不是Wayland环境，尝试使用其他工具
+    if (!captureSuccess) {
+        qCDebug(lcCapture) << "尝试使用备用截图方法";
+        
+        QString tempFile = QDir::tempPath() + "/screenshot_" + 
+                      QString::number(QRandomGenerator::global()->generate()) + ".png";
+        
+        QStringList possibleCmds;
+        
+        // 检查可用的屏幕捕获工具
+        if (QFile::exists("/usr/bin/gnome-screenshot")) {
+            possibleCmds << "/usr/bin/gnome-screenshot -f \"" + tempFile + "\"";
+        }
+        
+        if (QFile::exists("/usr/bin/ksnip")) {
+            possibleCmds << "/usr/bin/ksnip -f \"" + tempFile + "\"";
+        }
+        
+        if (QFile::exists("/usr/bin/spectacle")) {
+            possibleCmds << "/usr/bin/spectacle -b -n -o \"" + tempFile + "\"";
+        }
+        
+        if (QFile::exists("/usr/bin/scrot")) {
+            possibleCmds << "/usr/bin/scrot \"" + tempFile + "\"";
+        }
+        
+        if (QFile::exists("/usr/bin/maim")) {
+            possibleCmds << "/usr/bin/maim \"" + tempFile + "\"";
+        }
+        
+        if (QFile::exists("/usr/bin/import")) {
+            possibleCmds << "/usr/bin/import -window root \"" + tempFile + "\"";
+        }
+        
+        for (const QString &cmd : possibleCmds) {
+            if (captureSuccess) break;
+            
+            qCDebug(lcCapture) << "尝试使用外部命令捕获屏幕:" << cmd;
+            TRACE_SCOPE("capture.backend", cmd);
+            
+            QProcess process;
+            process.setProcessChannelMode(QProcess::MergedChannels);
+            
+            try {
+                process.start("bash", QStringList() << "-c" << cmd);
+                
+                if (process.waitForFinished(5000)) {
+                    if (process.exitCode() == 0) {
+                        QFile file(tempFile);
+                        if (file.exists() && file.size() > 0) {
+                            QImage capturedImage(tempFile);
+                            if (!capturedImage.isNull()) {
+                                result = TiledImage::fromImage(capturedImage);
+                                setBackend(backendUsed, cmd);
+                                qCDebug(lcCapture) << "使用外部工具" << cmd << "捕获屏幕成功";
+                                captureSuccess = true;
+                                QFile::remove(tempFile);
+                                break;
+                            }
+                        }
+                    }
+                }
+            } catch (...) {
+                qCDebug(lcCapture) << "执行外部命令时捕获到异常";
+            }
+        }
+    }
+    
+    // 最后，如果所有方法都失败，使用Qt原生方法 - 但在Wayland下可能有问题
+    if (!captureSuccess) {
+        qCDebug(lcCapture) << "所有外部工具捕获失败，尝试使用Qt原生方法 (在Wayland下可能导致缩放问题)";
+        
+        QList<QScreen*> screens = QGuiApplication::screens();
+        
+        if (screens.isEmpty()) {
+            qCDebug(lcCapture) << "错误：无法获取任何屏幕";
+            return TiledImage();
+        }
+        
+        // 计算屏幕边界 - 找到所有屏幕几何区域的联合
+        QRect totalGeometry;
+        bool firstScreen = true;
+        
+        for (QScreen *screen : screens) {
+            QRect screenGeom = screen->geometry();
+            qreal scaleFactor = screen->devicePixelRatio();
+            
+            qCDebug(lcCapture) << "屏幕:" << screen->name() 
+                               << "几何区域:" << screenGeom
+                               << "分辨率:" << screen->size()
+                               << "设备像素比:" << scaleFactor;
+            
+            // 在Wayland下处理缩放因子
+            if (isWayland) {
+                qCDebug(lcCapture) << "Wayland环境应用缩放因子:" << scaleFactor;
+                screenGeom = QRect(
+                    screenGeom.x(), 
+                    screenGeom.y(),
+                    qRound(screenGeom.width() * scaleFactor),
+                    qRound(screenGeom.height() * scaleFactor)
+                );
+            }
+            
+            if (firstScreen) {
+                totalGeometry = screenGeom;
+                firstScreen = false;
+            } else {
+                totalGeometry = totalGeometry.united(screenGeom);
+            }
+        }
+        
+        qCDebug(lcCapture) << "合并后的屏幕几何区域:" << totalGeometry;
+        
+        // 按块保存，只分配被屏幕覆盖到的块；外接矩形中没有屏幕的部分不占内存，
+        // 也省掉整张图的透明填充和逐屏绘制
+        TiledImage combined(totalGeometry.size());
+        
+        // 捕获每个屏幕并绘制到正确位置
+        for (QScreen *screen : screens) {
+            QRect screenGeom = screen->geometry();
+            qreal scaleFactor = screen->devicePixelRatio();
+            
+            // 计算此屏幕相对于合并区域的偏移
+            int offsetX = screenGeom.left() - totalGeometry.left();
+            int offsetY = screenGeom.top() - totalGeometry.top();
+            
+            if (isWayland) {
+                // 在Wayland下调整偏移量以考虑缩放
+                offsetX = qRound(offsetX * scaleFactor);
+                offsetY = qRound(offsetY * scaleFactor);
+            }
+            
+            QPoint offset(offsetX, offsetY);
+            qCDebug(lcCapture) << "尝试捕获屏幕:" << screen->name() 
+                               << "偏移:" << offset;
+            
+            // 捕获此屏幕
+            TRACE_SCOPE("capture.backend", "qt:" + screen->name());
+            QPixmap screenPixmap;
+            
+            // 使用grabWindow()还是grabWindow(0)，取决于平台
+            try {
+                // 使用参数0表示捕获整个屏幕
+                screenPixmap = screen->grabWindow(0);
+                
+                if (!screenPixmap.isNull()) {
+                    qCDebug(lcCapture) << "屏幕" << screen->name() << "捕获成功，大小:" << screenPixmap.size();
+                    
+                    // 在Wayland下处理缩放问题
+                    if (isWayland && qAbs(scaleFactor - 1.0) > 0.01) {
+                        // 在Qt中处理Wayland缩放问题的方法
+                        qCDebug(lcCapture) << "Wayland环境下，处理截图缩放，原始尺寸:" << screenPixmap.size();
+                        QImage img = screenPixmap.toImage();
+                        
+                        // 将图像缩放到正确的物理尺寸
+                        int targetWidth = qRound(img.width() * scaleFactor);
+                        int targetHeight = qRound(img.height() * scaleFactor);
+                        qCDebug(lcCapture) << "调整为物理尺寸:" << QSize(targetWidth, targetHeight);
+                        
+                        const QImage scaledImage = img.scaled(targetWidth, targetHeight,
+                                                              Qt::IgnoreAspectRatio,
+                                                              Qt::SmoothTransformation);
+                        CaptureFrame::noteCopy(scaledImage.sizeInBytes());
+                        combined.paste(offset, scaledImage);
+                    } else {
+                        // 完整覆盖的块直接引用这一屏的图像
+                        combined.paste(offset, screenPixmap.toImage());
+                    }
+                    captureSuccess = true;
+                } else {
+                    qCDebug(lcCapture) << "屏幕" << screen->name() << "捕获失败";
+                }
+            } catch (...) {
+                qCDebug(lcCapture) << "捕获屏幕时发生异常";
+            }
+        }
+        
+        if (captureSuccess) {
+            result = combined;
+            setBackend(backendUsed, QStringLiteral("qt"));
+            qCDebug(lcCapture) << "合并所有屏幕成功，总大小:" << result.size();
+        }
+    }
+    
+    return result;
+}
+
+} // namespace ScreenCapture
@@ -0,0 +1,38 @@
+#ifndef SCREENCAPTURE_H
+#define SCREENCAPTURE_H
+
+#include <QImage>
+#include <QRect>
+#include <QString>
+#include "tiledimage.h"
+
+// 区域截图后端：只捕获请求的矩形，不需要任何窗口
+// 优先使用可以把原始像素写到标准输出的外部工具（grim/maim/import），
+// 避免临时文件和PNG编解码；都不可用时退回Qt原生的QScreen::grabWindow
+// X11下有xcb-shm时首选共享内存截图，返回的图像直接引用共享内存段（见CaptureFrame）
+namespace ScreenCapture {
+
+// 根据环境变量判断会话类型，可在QGuiApplication创建之前调用
+bool sessionIsWayland();
+
+// 当前会话下是否存在支持区域截图的外部工具
+// 存在时无界面模式可以使用offscreen平台插件，省去连接显示服务器的开销
+bool hasExternalRegionTool();
+
+enum Backends {
+    ExternalBackends = 0x1, // xcb-shm和外部工具，不使用Qt的窗口系统对象，可以在后台线程调用
+    QtBackend = 0x2,        // QScreen::grabWindow，只能在主线程调用
+    AllBackends = ExternalBackends | QtBackend
+};
+
+// 捕获指定区域（虚拟桌面逻辑坐标），region无效时捕获全部屏幕
+// backendUsed 返回实际使用的后端名称，便于调试和计时输出；backends限制尝试的后端
+QImage grabRegion(const QRect &region, QString *backendUsed = nullptr, int backends = AllBackends);
+
+// 交互式截图用的整桌面截图：依次尝试各类外部工具、XDG桌面门户和Qt原生方法，
+// 多屏时按虚拟桌面坐标拼接到分块图像中；全部失败返回空图像
+TiledImage grabDesktop(QString *backendUsed = nullptr);
+
+} // namespace ScreenCapture
+
+#endif // SCREENCAPTURE_H
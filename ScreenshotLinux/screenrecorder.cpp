@@ -0,0 +1,364 @@
+#include "screenrecorder.h"
+#include "screencapture.h"
+#include "gifencoder.h"
+#include "trace.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QStringList>
+#include <cstring>
+
+namespace {
+
+// 原始帧按BGRA逐行紧密排列（小端机器上的ARGB32），直接送给ffmpeg的rawvideo输入
+QByteArray rawFrame(const QImage &image)
+{
+    const QImage frame = image.format() == QImage::Format_ARGB32 || image.format() == QImage::Format_RGB32
+                             ? image : image.convertToFormat(QImage::Format_RGB32);
+    const int rowBytes = frame.width() * 4;
+    QByteArray data(qsizetype(rowBytes) * frame.height(), Qt::Uninitialized);
+    for (int y = 0; y < frame.height(); ++y) {
+        std::memcpy(data.data() + qsizetype(y) * rowBytes, frame.constScanLine(y), size_t(rowBytes));
+    }
+    return data;
+}
+
+// 写满设备为止；ffmpeg读得慢时在这里等待，队列随之填满、截图一侧开始丢帧
+bool writeAll(QIODevice *device, const QByteArray &data)
+{
+    if (device->write(data) != data.size()) {
+        return false;
+    }
+    QProcess *process = qobject_cast<QProcess *>(device);
+    while (process && process->bytesToWrite() > 0) {
+        if (!process->waitForBytesWritten(-1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+ScreenRecorder::ScreenRecorder(const Options &options)
+    : m_options(options)
+    , m_format(formatForFileName(options.output))
+    , m_queue(options.queueDepth)
+{
+    m_options.fps = qBound(1, m_options.fps, 60);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.setInterval(1000 / m_options.fps);
+    QObject::connect(&m_timer, &QTimer::timeout, &m_timer, [this]() { captureTick(); });
+}
+
+ScreenRecorder::~ScreenRecorder()
+{
+    stop();
+}
+
+ScreenRecorder::Format ScreenRecorder::formatForFileName(const QString &fileName)
+{
+    return QFileInfo(fileName).suffix().compare("gif", Qt::CaseInsensitive) == 0 ? Format::Gif : Format::Video;
+}
+
+bool ScreenRecorder::start(QString *error)
+{
+    if (m_running) {
+        return true;
+    }
+    if (m_captureStopped) {
+        if (error) {
+            *error = QStringLiteral("录制已停止，不能重新开始");
+        }
+        return false;
+    }
+    if (m_format == Format::Video && QStandardPaths::findExecutable(QStringLiteral("ffmpeg")).isEmpty()) {
+        if (error) {
+            *error = QStringLiteral("录制视频需要安装ffmpeg，或使用 .gif 输出");
+        }
+        return false;
+    }
+    QFile probe(m_options.output);
+    if (!probe.open(QIODevice::WriteOnly)) {
+        if (error) {
+            *error = "无法写入 " + m_options.output;
+        }
+        return false;
+    }
+    probe.close();
+
+    int threads = m_options.threads;
+    if (threads <= 0) {
+        threads = qMax(1, int(std::thread::hardware_concurrency()) - 1);
+    }
+    m_running = true;
+    for (int i = 0; i < threads; ++i) {
+        m_encoders.emplace_back([this]() { encodeLoop(); });
+    }
+    m_writer = std::thread([this]() { writeLoop(); });
+
+    m_clock.start();
+    captureTick();
+    m_timer.start();
+    return true;
+}
+
+ScreenRecorder::Stats ScreenRecorder::stop(QString *error)
+{
+    if (m_finisher.joinable()) {
+        // stopAsync()已经停止截图，等它的收尾线程结束
+        m_finisher.join();
+    } else if (m_running) {
+        stopCapture();
+        finishPipeline();
+    }
+    if (error) {
+        *error = m_error;
+    }
+    return stats();
+}
+
+void ScreenRecorder::stopAsync(QObject *context, std::function<void(const Stats &stats, const QString &error)> done)
+{
+    if (m_finisher.joinable()) {
+        return;
+    }
+    if (!m_running) {
+        const Stats result = stats();
+        const QString error = m_error;
+        QMetaObject::invokeMethod(context, [done, result, error]() { done(result, error); }, Qt::QueuedConnection);
+        return;
+    }
+    stopCapture();
+    // 回调只带结果，不访问本对象，调用方可以在done中销毁录制器
+    m_finisher = std::thread([this, context, done]() {
+        finishPipeline();
+        const Stats result = stats();
+        const QString error = m_error;
+        QMetaObject::invokeMethod(context, [done, result, error]() { done(result, error); }, Qt::QueuedConnection);
+    });
+}
+
+void ScreenRecorder::stopCapture()
+{
+    m_timer.stop();
+    m_seconds = m_clock.nsecsElapsed() / 1e9;
+    m_running = false;
+    m_previous = QImage();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_captureStopped = true;
+    }
+    m_changed.notify_all();
+    // 关闭队列后编码线程取完剩余的帧才退出
+    m_queue.close();
+}
+
+void ScreenRecorder::finishPipeline()
+{
+    for (std::thread &encoder : m_encoders) {
+        encoder.join();
+    }
+    m_encoders.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_encodersDone = true;
+    }
+    m_changed.notify_all();
+    m_writer.join();
+}
+
+ScreenRecorder::Stats ScreenRecorder::stats() const
+{
+    Stats stats;
+    stats.captured = m_captured;
+    stats.dropped = m_dropped;
+    stats.written = m_written;
+    stats.seconds = m_running ? m_clock.nsecsElapsed() / 1e9 : m_seconds;
+    stats.bytes = m_bytes;
+    return stats;
+}
+
+void ScreenRecorder::captureTick()
+{
+    TRACE_SCOPE("record.capture");
+    const qint64 now = m_clock.elapsed();
+    const qint64 interval = m_timer.interval();
+    // 界面线程被其他工作耽误时错过的拍也算丢帧
+    if (m_lastTickMs >= 0 && interval > 0) {
+        const qint64 missed = (now - m_lastTickMs) / interval - 1;
+        if (missed > 0) {
+            m_dropped += int(missed);
+        }
+    }
+    m_lastTickMs = now;
+
+    // 队列满时不截图，省下截图本身的开销
+    if (m_queue.isFull()) {
+        ++m_dropped;
+        return;
+    }
+    QImage frame = ScreenCapture::grabRegion(m_options.region);
+    if (frame.isNull()) {
+        ++m_dropped;
+        return;
+    }
+    // 所有帧与第一帧同尺寸（录制中缩放比例变化时缩放到第一帧的大小）
+    if (m_frameSize.isEmpty()) {
+        m_frameSize = frame.size();
+    } else if (frame.size() != m_frameSize) {
+        frame = frame.scaled(m_frameSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    const int index = m_captured;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_timestamps.push_back(now);
+    }
+    // 只有这一个生产者，上面检查过队列未满，这里总能放入
+    m_queue.tryPush(PendingFrame{ index, frame, m_previous });
+    m_previous = frame;
+    ++m_captured;
+    m_changed.notify_all();
+}
+
+void ScreenRecorder::encodeLoop()
+{
+    PendingFrame item;
+    while (m_queue.pop(&item)) {
+        EncodedFrame encoded;
+        {
+            TRACE_SCOPE("record.encode");
+            if (m_format == Format::Gif) {
+                const GifEncoder::Frame frame = GifEncoder::encodeFrame(item.frame, item.previous);
+                encoded.data = frame.data;
+                encoded.transparent = frame.transparent;
+            } else {
+                encoded.data = rawFrame(item.frame);
+            }
+        }
+        const int index = item.index;
+        item = PendingFrame(); // 尽早释放帧的引用
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // 等待写出的结果也有上限；下一个要写的帧总能放进去，不会互相等待
+        m_changed.wait(lock, [&]() {
+            return int(m_encoded.size()) < m_queue.capacity() || index == m_nextWrite;
+        });
+        m_encoded[index] = std::move(encoded);
+        lock.unlock();
+        m_changed.notify_all();
+    }
+}
+
+bool ScreenRecorder::canWriteNext() const
+{
+    // 帧的显示时长要等下一帧截取后才知道，最后一帧在停止后按帧间隔计
+    return m_encoded.count(m_nextWrite) &&
+           (m_firstTimestamp + int(m_timestamps.size()) > m_nextWrite + 1 || m_captureStopped);
+}
+
+void ScreenRecorder::fail(const QString &error)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_error.isEmpty()) {
+        m_error = error;
+    }
+}
+
+void ScreenRecorder::writeLoop()
+{
+    // 输出设备在写线程上创建和销毁，QProcess只在创建它的线程上使用
+    QFile file(m_options.output);
+    QProcess ffmpeg;
+    QIODevice *out = nullptr;
+    bool failed = false;
+    const qint64 interval = 1000 / m_options.fps;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_changed.wait(lock, [this]() { return canWriteNext() || m_encodersDone; });
+        if (!canWriteNext()) {
+            break;
+        }
+        const int index = m_nextWrite++;
+        const EncodedFrame frame = std::move(m_encoded[index]);
+        m_encoded.erase(index);
+        // 已写出的帧不再需要截取时间，只保留这一帧之后的，录制再长也不增长
+        while (m_firstTimestamp < m_nextWrite - 1 && !m_timestamps.empty()) {
+            m_timestamps.pop_front();
+            ++m_firstTimestamp;
+        }
+        const size_t offset = size_t(index - m_firstTimestamp);
+        const qint64 duration = offset + 1 < m_timestamps.size()
+                                    ? m_timestamps[offset + 1] - m_timestamps[offset]
+                                    : interval;
+        const QSize size = m_frameSize;
+        lock.unlock();
+        m_changed.notify_all();
+
+        // 出错后继续取走编码结果，编码线程不会卡住，只是不再写出
+        if (!failed) {
+            TRACE_SCOPE("record.write");
+            QByteArray data;
+            if (index == 0) {
+                if (m_format == Format::Gif) {
+                    out = file.open(QIODevice::WriteOnly) ? &file : nullptr;
+                    data = GifEncoder::header(size);
+                } else {
+                    // yuv420p要求偶数尺寸，奇数时补一行/一列
+                    ffmpeg.start(QStringLiteral("ffmpeg"), QStringList{
+                        "-loglevel", "error", "-y",
+                        "-f", "rawvideo", "-pix_fmt", "bgra",
+                        "-s", QString("%1x%2").arg(size.width()).arg(size.height()),
+                        "-framerate", QString::number(m_options.fps),
+                        "-i", "-",
+                        "-vf", "pad=ceil(iw/2)*2:ceil(ih/2)*2",
+                        "-pix_fmt", "yuv420p",
+                        m_options.output });
+                    out = ffmpeg.waitForStarted() ? &ffmpeg : nullptr;
+                }
+            }
+            bool ok = out != nullptr;
+            if (m_format == Format::Gif) {
+                // 多数播放器把小于2（1/100秒）的时长当作10处理
+                data += GifEncoder::graphicControl(qMax(2, int((duration + 5) / 10)), frame.transparent);
+                data += frame.data;
+                ok = ok && writeAll(out, data);
+                m_bytes += data.size();
+            } else {
+                // rawvideo是固定帧率，丢掉的拍用上一帧补上，保持时间轴正确
+                const qint64 repeats = qMax<qint64>(1, (duration + interval / 2) / interval);
+                for (qint64 i = 0; ok && i < repeats; ++i) {
+                    ok = writeAll(out, frame.data);
+                    m_bytes += frame.data.size();
+                }
+            }
+            if (ok) {
+                ++m_written;
+            } else {
+                failed = true;
+                fail(out ? "写入录制文件失败: " + m_options.output
+                         : "无法打开录制输出: " + m_options.output);
+            }
+        }
+        lock.lock();
+    }
+    lock.unlock();
+
+    if (out == &file) {
+        if (!failed && !writeAll(&file, GifEncoder::trailer())) {
+            fail("写入录制文件失败: " + m_options.output);
+        }
+        file.close();
+    } else if (out == &ffmpeg) {
+        ffmpeg.closeWriteChannel();
+        ffmpeg.waitForFinished(-1);
+        if (ffmpeg.exitStatus() != QProcess::NormalExit || ffmpeg.exitCode() != 0) {
+            fail("ffmpeg编码失败: " + QString::fromLocal8Bit(ffmpeg.readAllStandardError()).trimmed());
+        }
+    } else if (m_written == 0 && m_captured == 0) {
+        fail(QStringLiteral("没有截取到任何帧"));
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef SCREENRECORDER_H
+#define SCREENRECORDER_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QObject>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <QTimer>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "boundedqueue.h"
+
+// 区域录制：截图 -> 有界队列 -> 编码线程 -> 按顺序写出 的流水线
+// 截图复用ScreenCapture的区域截图后端，在调用start()的线程上按帧率定时截取；
+// 队列满（编码或写出跟不上）时直接丢弃这一拍，不阻塞截图，内存不随录制时长增长：
+// 最多是队列中的帧、每个编码线程手上的一帧和等待按顺序写出的编码结果
+// GIF在多个线程上逐帧编码（见GifEncoder）；其他后缀交给外部ffmpeg进程，
+// 原始BGRA帧通过标准输入送入，视频编码在ffmpeg自己的线程里进行
+class ScreenRecorder
+{
+public:
+    enum class Format { Gif, Video };
+
+    struct Options {
+        QRect region;         // 虚拟桌面逻辑坐标，无效表示全部屏幕
+        QString output;
+        int fps = 10;
+        int queueDepth = 8;   // 等待编码的帧数上限，也是等待写出的编码结果上限
+        int threads = 0;      // 编码线程数，0为核心数减一
+    };
+
+    struct Stats {
+        int captured = 0;     // 进入队列的帧
+        int dropped = 0;      // 队列满、截图失败或定时器被耽误而没有截取的拍
+        int written = 0;      // 已写出的帧
+        double seconds = 0;   // 录制时长
+        qint64 bytes = 0;     // GIF文件大小；视频为送给ffmpeg的原始字节数
+    };
+
+    explicit ScreenRecorder(const Options &options);
+    ~ScreenRecorder();
+
+    static Format formatForFileName(const QString &fileName);
+
+    // 需要调用线程有事件循环，通常是界面线程
+    bool start(QString *error);
+    // 停止截图，等已进入队列的帧编码、写出完成后返回；失败时error为原因
+    Stats stop(QString *error = nullptr);
+    // 停止截图后立即返回，剩余帧的编码、写出（视频还要等ffmpeg结束）在后台线程完成，
+    // 之后在context的线程上调用done；context先销毁时不再调用。析构时等待后台线程
+    void stopAsync(QObject *context, std::function<void(const Stats &stats, const QString &error)> done);
+    bool isRunning() const { return m_running; }
+    Stats stats() const;
+    const Options &options() const { return m_options; }
+
+private:
+    struct PendingFrame {
+        int index = 0;
+        QImage frame;
+        QImage previous; // 上一个进入队列的帧，GIF只编码与它不同的部分
+    };
+
+    struct EncodedFrame {
+        QByteArray data;
+        bool transparent = false;
+    };
+
+    void stopCapture();     // 停止定时截图并关闭队列，在start()的线程上调用
+    void finishPipeline();  // 等编码线程和写线程结束
+    void captureTick();
+    void encodeLoop();
+    void writeLoop();
+    bool canWriteNext() const;
+    void fail(const QString &error);
+
+    Options m_options;
+    Format m_format;
+    bool m_running = false;
+
+    // 截图一侧，只在start()的线程上访问
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    qint64 m_lastTickMs = -1;
+    QImage m_previous;
+    QSize m_frameSize;
+
+    BoundedQueue<PendingFrame> m_queue;
+    std::vector<std::thread> m_encoders;
+    std::thread m_writer;
+    std::thread m_finisher; // stopAsync()的收尾线程
+
+    // 以下由m_mutex保护
+    mutable std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::map<int, EncodedFrame> m_encoded; // 编码完成、等待按顺序写出的帧
+    std::deque<qint64> m_timestamps;       // 还没写出的帧的截取时间，写出时用相邻两帧之差作为显示时长
+    int m_firstTimestamp = 0;              // m_timestamps第一项对应的帧
+    int m_nextWrite = 0;
+    bool m_captureStopped = false;
+    bool m_encodersDone = false;
+    QString m_error;
+
+    std::atomic<int> m_captured{0};
+    std::atomic<int> m_dropped{0};
+    std::atomic<int> m_written{0};
+    std::atomic<qint64> m_bytes{0};
+    double m_seconds = 0;
+};
+
+#endif // SCREENRECORDER_H
@@ -1,4 +1,20 @@
 #include "screenshotwindow.h"
+#include "lazyimagemimedata.h"
+#include "imageencoder.h"
+#include "screencapture.h"
+#include "logging.h"
+#include "ringlog.h"
+#include "trace.h"
+#include "annotationrenderer.h"
+#include "selectiontracker.h"
+#include "windowtree.h"
+#include "inputrecorder.h"
+#include "overlaywindow.h"
+#include "captureframe.h"
+#include "contentstore.h"
+#include "imagediff.h"
+#include "scrollinput.h"
+#include "commandline.h"
 #include <QApplication>
 #include <QScreen>
 #include <QMouseEvent>
@@ -24,22 +40,100 @@
 #include <QEventLoop>
 #include <QBuffer>
 #include <QMimeData>
-#include <QProcess>
 #include <QImageWriter>
 #include <QWindow>
-#include <QRandomGenerator>
-#include <QRegularExpression> // 添加正则表达式支持
+#include <QSaveFile>
+#include <QSettings>
+#include <QPixmapCache>
+#include <QCursor>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace {
+
+// 实时选区模式下隐藏遮罩到截取选区之间等待合成器更新屏幕的时间
+const int kLiveCaptureSettleMs = 60;
+
+// 后台任务还没有完成；析构或赋值未完成的std::async结果会阻塞到任务结束
+template <typename T>
+bool isRunning(const std::future<T> &future)
+{
+    return future.valid() && future.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+// 悬停高亮的窗口边框所占区域
+QRegion hoverOutline(const QRect &rect)
+{
+    if (rect.isNull()) {
+        return QRegion();
+    }
+    return QRegion(rect).subtracted(QRegion(rect.adjusted(4, 4, -4, -4)));
+}
+
+// 拖动选择时选区边框所占区域，包括1像素画笔超出矩形的部分
+QRegion selectionOutline(const QRect &rect)
+{
+    return QRegion(rect.adjusted(-2, -2, 2, 2)).subtracted(QRegion(rect.adjusted(2, 2, -2, -2)));
+}
+
+// 通过统一的编码配置写文件，先写临时文件再替换，避免留下半个文件
+bool writeImageFile(const QImage &image, const QString &filePath, ImageEncoder::Profile profile)
+{
+    TRACE_SCOPE("export.writeFile", filePath);
+    // 相同内容的截图只编码一次，文件是内容存储中对象的硬链接
+    if (ContentStore::enabledInSettings()) {
+        return ContentStore::save(image, filePath, profile);
+    }
+    QSaveFile file(filePath);
+    return file.open(QIODevice::WriteOnly) &&
+           ImageEncoder::encode(image, &file, profile) &&
+           file.commit();
+}
+
+bool writeImageFile(const QImage &image, const QString &filePath)
+{
+    return writeImageFile(image, filePath, ImageEncoder::profileForFileName(filePath));
+}
+
+// 托盘菜单里的选区标题，如 "1920×1080 @ 0, 0"
+QString regionTitle(const QRect &region)
+{
+    return QString("%1×%2 @ %3, %4").arg(region.width()).arg(region.height()).arg(region.x()).arg(region.y());
+}
+
+} // namespace
 
 ScreenshotWindow::ScreenshotWindow(QWidget *parent)
     : QWidget(parent)
     , m_isSelecting(false)
     , m_hasSelected(false)
     , m_isScreenshotMode(false)
+    , m_cursorShape(Qt::ArrowCursor)
+    , m_liveMode(false)
+    , m_liveRequested(false)
+    , m_liveByDefault(false)
+    , m_loupeVisible(false)
     , m_currentMode(DrawMode::None)
-    , m_rubberBand(new QRubberBand(QRubberBand::Rectangle, this))
     , m_toolBar(new QToolBar(this))
     , m_trayIcon(nullptr)
     , m_trayIconMenu(nullptr)
+    , m_recentRegionsMenu(nullptr)
+    , m_recordAction(nullptr)
+    , m_historyMenu(nullptr)
+    , m_historyEnabled(HistoryStore::enabledInSettings())
+    , m_triggerPending(false)
+    , m_traceSessionId(0)
+    , m_captureMs(0)
+    , m_showMs(0)
+    , m_firstFrameMs(0)
+    , m_repeatMs(0)
+    , m_idleTimer(new QTimer(this))
+    , m_idle(false)
+    , m_inputRecorder(nullptr)
 {
     setWindowFlags(Qt::FramelessWindowHint | Qt::WindowStaysOnTopHint);
     setAttribute(Qt::WA_TranslucentBackground);
@@ -55,6 +149,7 @@ ScreenshotWindow::ScreenshotWindow(QWidget *parent)
     m_brushAction = m_toolBar->addAction("画笔");
     m_mosaicAction = m_toolBar->addAction("马赛克");
     m_undoAction = m_toolBar->addAction("撤销");
+    m_scrollAction = m_toolBar->addAction("长截图");
     m_saveAction = m_toolBar->addAction("保存");
     m_cancelAction = m_toolBar->addAction("取消");
     m_finishAction = m_toolBar->addAction("完成");
@@ -65,6 +160,7 @@ ScreenshotWindow::ScreenshotWindow(QWidget *parent)
     connect(m_textAction, &QAction::triggered, this, &ScreenshotWindow::drawText);
     connect(m_brushAction, &QAction::triggered, this, &ScreenshotWindow::drawBrush);
     connect(m_undoAction, &QAction::triggered, this, &ScreenshotWindow::undo);
+    connect(m_scrollAction, &QAction::triggered, this, &ScreenshotWindow::startScrollCapture);
     connect(m_saveAction, &QAction::triggered, this, &ScreenshotWindow::saveScreenshot);
     connect(m_cancelAction, &QAction::triggered, this, &ScreenshotWindow::cancelScreenshot);
     connect(m_finishAction, &QAction::triggered, this, &ScreenshotWindow::finishScreenshot);
@@ -72,12 +168,42 @@ ScreenshotWindow::ScreenshotWindow(QWidget *parent)
     // 不在构造函数中初始化托盘图标，而是由main.cpp调用
     // setupTrayIcon();
     
+    // 截图过程中屏幕增减时取消本次截图，并按新的屏幕重建遮罩窗口
+    auto screensChanged = [this]() {
+        if (m_isScreenshotMode) {
+            cancelScreenshot();
+        }
+        if (!m_overlays.isEmpty()) {
+            rebuildOverlays();
+        }
+    };
+    connect(qApp, &QGuiApplication::screenAdded, this, screensChanged);
+    connect(qApp, &QGuiApplication::screenRemoved, this, screensChanged);
+    
+    // 空闲等待时间（秒）保存在配置文件的 idle/quietSeconds，0表示不进入空闲模式
+    QSettings settings;
+    const int quietSeconds = settings.value("idle/quietSeconds", 60).toInt();
+    m_liveByDefault = settings.value("capture/liveSelection", false).toBool();
+    m_recentRegions.load();
+    m_history.setRetention(HistoryStore::retentionFromSettings());
+    m_history.setDeduplicate(ContentStore::enabledInSettings());
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(qMax(0, quietSeconds) * 1000);
+    connect(m_idleTimer, &QTimer::timeout, this, &ScreenshotWindow::enterIdleMode);
+    
     hide();
 }
 
 ScreenshotWindow::~ScreenshotWindow()
 {
-    delete m_rubberBand;
+    // 等后台的写文件和录制完成，文件不会只写一半
+    m_pendingWrites.clear();
+    m_recorder.reset();
+    m_stoppingRecorder.reset();
+    m_scrollSession.reset();
+    // 工具栏可能挂在某个遮罩窗口上，先收回再删除遮罩窗口
+    m_toolBar->setParent(this);
+    qDeleteAll(m_overlays);
     delete m_trayIcon;
     delete m_trayIconMenu;
 }
@@ -86,8 +212,8 @@ void ScreenshotWindow::setupTrayIcon()
 {
     // 首先检查当前环境
     bool isWayland = QGuiApplication::platformName().contains("wayland", Qt::CaseInsensitive);
-    qDebug() << "设置托盘图标, 平台:" << QGuiApplication::platformName() 
-             << (isWayland ? "(Wayland)" : "(X11/其他)");
+    qCDebug(lcApp) << "设置托盘图标, 平台:" << QGuiApplication::platformName() 
+                   << (isWayland ? "(Wayland)" : "(X11/其他)");
     
     // 创建托盘菜单
     m_trayIconMenu = new QMenu(this);
@@ -96,7 +222,8 @@ void ScreenshotWindow::setupTrayIcon()
     // 在Wayland环境下, 使用一个lambda中间层来调用startScreenshot，以避免直接调用
     if(isWayland) {
         connect(m_screenshotAction, &QAction::triggered, this, [this]() {
-            qDebug() << "通过菜单项触发截图(Wayland安全方式)";
+            qCDebug(lcApp) << "通过菜单项触发截图(Wayland安全方式)";
+            markTrigger();
             QTimer::singleShot(100, this, &ScreenshotWindow::startScreenshot);
         });
     } else {
@@ -104,6 +231,38 @@ void ScreenshotWindow::setupTrayIcon()
     }
     m_trayIconMenu->addAction(m_screenshotAction);
     
+    // 不冻结画面：先在实时桌面上选择，确定后只截取选区
+    m_liveScreenshotAction = new QAction("实时选区截图", this);
+    connect(m_liveScreenshotAction, &QAction::triggered, this, [this, isWayland]() {
+        markTrigger();
+        QTimer::singleShot(isWayland ? 100 : 0, this, &ScreenshotWindow::startLiveScreenshot);
+    });
+    m_trayIconMenu->addAction(m_liveScreenshotAction);
+    
+    // 不显示遮罩，直接重复截取最近确定过的选区；只列出与当前屏幕布局匹配的选区
+    m_recentRegionsMenu = m_trayIconMenu->addMenu("重复截取最近选区");
+    connect(m_trayIconMenu, &QMenu::aboutToShow, this, &ScreenshotWindow::updateRecentRegionsMenu);
+    
+    // 录制最近一次的选区为GIF，再点一次停止
+    m_recordAction = m_trayIconMenu->addAction("录制最近选区");
+    connect(m_recordAction, &QAction::triggered, this, [this]() {
+        const bool stopping = m_recorder != nullptr;
+        const QString reply = stopping ? stopRecording()
+                                       : startRecording(m_recentRegions.regionFor(RecentRegions::currentLayout()),
+                                                        QString(), 10);
+        // 停止成功时等写出完成再提示，见stopRecording()
+        if (m_trayIcon && !(stopping && reply.startsWith("ok"))) {
+            m_trayIcon->showMessage(reply.startsWith("ok") ? "录制" : "录制失败", reply.section(' ', 1));
+        }
+    });
+    updateRecentRegionsMenu();
+    
+    // 最近复制或保存过的截图，带缩略图；点击重新复制到剪贴板
+    if (m_historyEnabled) {
+        m_historyMenu = m_trayIconMenu->addMenu("最近截图");
+        connect(m_trayIconMenu, &QMenu::aboutToShow, this, &ScreenshotWindow::updateHistoryMenu);
+    }
+    
     m_aboutAction = new QAction("关于", this);
     connect(m_aboutAction, &QAction::triggered, this, &ScreenshotWindow::showAboutDialog);
     m_trayIconMenu->addAction(m_aboutAction);
@@ -114,7 +273,7 @@ void ScreenshotWindow::setupTrayIcon()
     // 在Wayland环境下, 退出也需要特殊处理
     if(isWayland) {
         connect(m_quitAction, &QAction::triggered, this, [this]() {
-            qDebug() << "通过菜单项退出(Wayland安全方式)";
+            qCDebug(lcApp) << "通过菜单项退出(Wayland安全方式)";
             QTimer::singleShot(200, this, &ScreenshotWindow::quitApplication);
         });
     } else {
@@ -146,49 +305,423 @@ void ScreenshotWindow::setupTrayIcon()
     
     // 确保图标可见
     m_trayIcon->show();
-    qDebug() << "托盘图标设置完成, 可见性:" << m_trayIcon->isVisible();
+    qCDebug(lcApp) << "托盘图标设置完成, 可见性:" << m_trayIcon->isVisible();
 }
 
 void ScreenshotWindow::safeTrayIconActivated(QSystemTrayIcon::ActivationReason reason)
 {
-    qDebug() << "Wayland安全模式：托盘图标被激活，原因:" << static_cast<int>(reason);
+    qCDebug(lcApp) << "Wayland安全模式：托盘图标被激活，原因:" << static_cast<int>(reason);
     
     // 使用全异步方式处理托盘事件，避免Wayland环境下的崩溃
     if (reason == QSystemTrayIcon::Trigger) {
-        qDebug() << "Wayland安全模式：触发截图操作（延迟执行）";
+        qCDebug(lcApp) << "Wayland安全模式：触发截图操作（延迟执行）";
+        if (Trace::isEnabled()) {
+            Trace::addInstant("tray.safeActivated");
+        }
+        markTrigger();
         
         // 关键：使用QueuedConnection而不是直接调用或单纯的延时
         QMetaObject::invokeMethod(this, [this]() {
-            qDebug() << "Wayland安全模式：开始执行异步截图操作";
+            qCDebug(lcApp) << "Wayland安全模式：开始执行异步截图操作";
             
             // 二次确认程序仍在运行
             if (QCoreApplication::instance() && !QCoreApplication::closingDown()) {
                 QTimer::singleShot(200, this, [this]() {
-                    qDebug() << "Wayland安全模式：实际执行截图操作";
+                    qCDebug(lcApp) << "Wayland安全模式：实际执行截图操作";
                     startScreenshot();
                 });
             } else {
-                qDebug() << "Wayland安全模式：应用程序正在关闭，取消操作";
+                qCDebug(lcApp) << "Wayland安全模式：应用程序正在关闭，取消操作";
             }
         }, Qt::QueuedConnection);
     } else if (reason == QSystemTrayIcon::Context) {
-        qDebug() << "Wayland安全模式：右键菜单被触发";
+        qCDebug(lcApp) << "Wayland安全模式：右键菜单被触发";
         // 右键菜单由Qt自动处理
     } else {
-        qDebug() << "Wayland安全模式：其他类型的托盘激活:" << static_cast<int>(reason);
+        qCDebug(lcApp) << "Wayland安全模式：其他类型的托盘激活:" << static_cast<int>(reason);
     }
 }
 
 void ScreenshotWindow::trayIconActivated(QSystemTrayIcon::ActivationReason reason)
 {
     if (reason == QSystemTrayIcon::Trigger) {
+        markTrigger();
         startScreenshot();
     }
 }
 
+void ScreenshotWindow::markTrigger()
+{
+    m_triggerTimer.start();
+    m_triggerPending = true;
+    
+    if (Trace::isEnabled()) {
+        // 一次截图会话：触发 -> 首帧 -> 复制/保存/取消
+        ++m_traceSessionId;
+        Trace::beginAsync("screenshot.session", m_traceSessionId);
+        Trace::beginAsync("screenshot.triggerToFirstFrame", m_traceSessionId);
+    }
+}
+
+void ScreenshotWindow::setTraceOutput(const QString &filePath)
+{
+    m_traceOutput = filePath;
+    Trace::setEnabled(!filePath.isEmpty());
+}
+
+void ScreenshotWindow::setInputRecordingPath(const QString &filePath)
+{
+    m_inputRecordingPath = filePath;
+    if (filePath.isEmpty() || m_inputRecorder) {
+        return;
+    }
+    
+    m_inputRecorder = new InputRecorder(this);
+    installEventFilter(m_inputRecorder);
+    // 工具栏按钮的点击发生在子控件上，单独记录触发的动作序号
+    connect(m_toolBar, &QToolBar::actionTriggered, this, [this](QAction *action) {
+        m_inputRecorder->recordToolAction(m_toolBar->actions().indexOf(action));
+    });
+}
+
+void ScreenshotWindow::beginInputRecording()
+{
+    if (m_inputRecorder && !m_inputRecordingPath.isEmpty()) {
+        m_inputRecorder->start(m_inputRecordingPath, canvasRect().size());
+    }
+}
+
+void ScreenshotWindow::prewarmOverlay()
+{
+    // 提前为每个屏幕创建遮罩窗口并分配后备存储的缓冲区，
+    // 截图时只需替换截图数据并显示，不再在显示路径上创建窗口或分配整屏缓冲区；按默认模式创建
+    m_liveMode = m_liveByDefault;
+    rebuildOverlays();
+    for (OverlayWindow *overlay : m_overlays) {
+        overlay->allocateBackingStore();
+    }
+    
+    // 工具栏在空闲时完成样式计算和布局，避免第一次显示时才做
+    m_toolBar->ensurePolished();
+    m_toolBar->adjustSize();
+    
+    qCDebug(lcOverlay) << "遮罩窗口已预热，屏幕数:" << m_overlays.size() << "画布原点:" << m_canvasOrigin;
+    scheduleIdle();
+}
+
+void ScreenshotWindow::scheduleIdle()
+{
+    m_idle = false;
+    if (m_idleTimer->interval() > 0) {
+        m_idleTimer->start();
+    }
+}
+
+void ScreenshotWindow::enterIdleMode()
+{
+    if (m_isScreenshotMode || m_idle || m_recorder || m_stoppingRecorder || m_scrollSession) {
+        return;
+    }
+    // 后台还在写文件、记入历史或分析截图时不在主线程上等它们，重新等待一个安静期
+    reapPendingWrites();
+    if (!m_pendingWrites.empty() || isRunning(m_edgeMapFuture) || isRunning(m_windowTreeFuture)) {
+        scheduleIdle();
+        return;
+    }
+    TRACE_SCOPE("app.idle");
+    m_idleTimer->stop();
+    const ProcessStats::Snapshot before = ProcessStats::current();
+    
+    // 截图帧（共享内存段、工具输出）随最后一个引用释放；剪贴板里的导出结果不受影响
+    m_screenImage = TiledImage();
+    m_canvasToCapture = QTransform();
+    m_edgeMap = EdgeMap();
+    m_edgeMapFuture = std::future<EdgeMap>();
+    m_windowLookup = WindowLookup();
+    m_windowTreeFuture = std::future<WindowLookup>();
+    m_drawItems.clear();
+    m_undoItems.clear();
+    m_history.close();
+    // 历史删除旧记录时已经释放了各自的对象，这里清理保存失败等情况留下的没有链接的对象
+    if (ContentStore::enabledInSettings()) {
+        ContentStore::collectGarbage();
+    }
+    
+    // 遮罩窗口连同后备存储（每屏一块整屏大小的缓冲区）一起销毁，再立即重建隐藏的窗口：
+    // 只创建原生窗口、不分配缓冲区，空闲占用仍然很小，下次截图时不用在触发路径上创建窗口；
+    // 不重新启动空闲定时器
+    releaseOverlays();
+    rebuildOverlays();
+    QPixmapCache::clear();
+    
+    // 上面释放的小块内存留在malloc的空闲链表里，归还给系统
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    
+    m_idle = true;
+    m_idleSince.start();
+    m_idleSnapshot = ProcessStats::current();
+    qCDebug(lcApp) << "进入空闲模式，RSS:" << before.rssBytes / 1024 << "KiB ->"
+                   << m_idleSnapshot.rssBytes / 1024 << "KiB";
+}
+
+QString ScreenshotWindow::idleStats() const
+{
+    const ProcessStats::Snapshot now = ProcessStats::current();
+    QString reply = QString("ok rss_kb=%1 ctxt_switches=%2 idle=%3")
+                        .arg(now.rssBytes < 0 ? -1 : now.rssBytes / 1024)
+                        .arg(now.contextSwitches())
+                        .arg(m_idle ? 1 : 0);
+    if (m_idle) {
+        // 空闲期间每分钟的上下文切换次数，近似于进程被唤醒的频率
+        const double minutes = m_idleSince.elapsed() / 60000.0;
+        const qint64 switches = now.contextSwitches() - m_idleSnapshot.contextSwitches();
+        reply += QString(" idle_s=%1 wakeups_per_min=%2")
+                     .arg(m_idleSince.elapsed() / 1000)
+                     .arg(minutes > 0 ? switches / minutes : 0.0, 0, 'f', 2);
+    }
+    return reply;
+}
+
+void ScreenshotWindow::rebuildOverlays()
+{
+    const QList<QScreen*> screens = QGuiApplication::screens();
+    QRect desktop;
+    for (QScreen *screen : screens) {
+        desktop = desktop.united(screen->geometry());
+    }
+    
+    // 屏幕和布局都没变时沿用已有的窗口
+    bool unchanged = m_overlays.size() == screens.size();
+    for (int i = 0; unchanged && i < screens.size(); ++i) {
+        unchanged = m_overlays.at(i)->targetScreen() == screens.at(i) &&
+                    m_overlays.at(i)->canvasRect() == screens.at(i)->geometry().translated(-desktop.topLeft()) &&
+                    m_overlays.at(i)->isLive() == m_liveMode;
+    }
+    if (unchanged) {
+        return;
+    }
+    
+    releaseOverlays();
+    
+    m_canvasOrigin = desktop.topLeft();
+    for (QScreen *screen : screens) {
+        m_overlays.append(new OverlayWindow(this, screen, screen->geometry().translated(-m_canvasOrigin), m_liveMode));
+    }
+    qCDebug(lcOverlay) << "创建遮罩窗口:" << m_overlays.size() << "个屏幕，虚拟桌面:" << desktop;
+}
+
+void ScreenshotWindow::startLiveScreenshot()
+{
+    m_liveRequested = true;
+    startScreenshot();
+}
+
+void ScreenshotWindow::captureLiveSelection(const std::function<void()> &then)
+{
+    // 先隐藏遮罩和工具栏，等合成器把它们从屏幕上去掉，再只截取选区
+    const QRect selection = selectedRect().intersected(canvasRect());
+    m_toolBar->hide();
+    hideOverlays();
+    
+    QTimer::singleShot(kLiveCaptureSettleMs, this, [this, selection, then]() {
+        if (!m_isScreenshotMode) {
+            return;
+        }
+        TRACE_SCOPE("capture.liveSelection");
+        CaptureFrame::resetBytesCopied();
+        QString backend;
+        QImage region = ScreenCapture::grabRegion(selection.translated(m_canvasOrigin), &backend);
+        m_captureMs = m_triggerTimer.nsecsElapsed() / 1e6;
+        if (region.isNull()) {
+            QMessageBox::critical(nullptr, "截图失败", "无法捕获屏幕");
+            cancelScreenshot();
+            return;
+        }
+        // 后端按物理像素截图时不缩放，记录画布坐标到截图像素的比例，导出保持原始分辨率
+        const QTransform toCapture = QTransform::fromScale(qreal(region.width()) / selection.width(),
+                                                           qreal(region.height()) / selection.height());
+        
+        // 按这个比例放大的画布大小的分块图像里只有选区覆盖的块，合成和马赛克换算后读取
+        const QRect canvas = toCapture.mapRect(canvasRect());
+        TiledImage capture(canvas.size(), region.depth() == 32 ? region.format()
+                                                               : QImage::Format_ARGB32_Premultiplied);
+        capture.paste(toCapture.map(selection.topLeft()), region);
+        m_screenImage = capture;
+        m_canvasToCapture = toCapture;
+        qCDebug(lcCapture) << "实时选区截图，后端:" << backend << "区域:" << selection
+                           << "复制字节:" << CaptureFrame::bytesCopied();
+        then();
+    });
+}
+
+void ScreenshotWindow::releaseOverlays()
+{
+    // 工具栏可能挂在某个遮罩窗口上，删除前先收回
+    m_toolBar->hide();
+    m_toolBar->setParent(this);
+    qDeleteAll(m_overlays);
+    m_overlays.clear();
+}
+
+void ScreenshotWindow::showOverlays()
+{
+    for (OverlayWindow *overlay : m_overlays) {
+        overlay->setCapture(m_screenImage, m_canvasToCapture);
+        overlay->setCursor(m_cursorShape);
+        overlay->showOnScreen();
+    }
+    
+    // 键盘焦点给光标所在的屏幕
+    OverlayWindow *active = overlayAt(QCursor::pos() - m_canvasOrigin);
+    if (!active && !m_overlays.isEmpty()) {
+        active = m_overlays.first();
+    }
+    if (active) {
+        active->activateWindow();
+        active->setFocus();
+    }
+}
+
+void ScreenshotWindow::hideOverlays()
+{
+    for (OverlayWindow *overlay : m_overlays) {
+        overlay->hide();
+        overlay->clearCapture();
+    }
+}
+
+void ScreenshotWindow::mapCaptureToDesktop()
+{
+    // 外部工具按物理像素截图时（Wayland缩放）截图比虚拟桌面的逻辑尺寸大；不缩放截图，
+    // 只记录画布坐标到截图像素的比例，各遮罩窗口按比例取自己那一块，导出保持原始分辨率
+    m_canvasToCapture = QTransform();
+    QRect desktop;
+    for (const OverlayWindow *overlay : m_overlays) {
+        desktop = desktop.united(overlay->canvasRect());
+    }
+    if (m_screenImage.isNull() || desktop.isEmpty() || m_screenImage.size() == desktop.size()) {
+        return;
+    }
+    
+    m_canvasToCapture = QTransform::fromScale(qreal(m_screenImage.width()) / desktop.width(),
+                                              qreal(m_screenImage.height()) / desktop.height());
+    qCDebug(lcCapture) << "截图按设备像素保存:" << m_screenImage.size() << "虚拟桌面:" << desktop.size()
+                       << "比例:" << m_canvasToCapture.m11() << m_canvasToCapture.m22();
+}
+
+OverlayWindow *ScreenshotWindow::overlayAt(const QPoint &canvasPos) const
+{
+    for (OverlayWindow *overlay : m_overlays) {
+        if (overlay->canvasRect().contains(canvasPos)) {
+            return overlay;
+        }
+    }
+    return nullptr;
+}
+
+QRect ScreenshotWindow::canvasRect() const
+{
+    // 画布是所有屏幕的逻辑范围；截图可能是设备像素，不能直接用截图的大小
+    QRect desktop;
+    for (const OverlayWindow *overlay : m_overlays) {
+        desktop = desktop.united(overlay->canvasRect());
+    }
+    // 基准测试和输入回放没有遮罩窗口，画布就是截图换算回画布坐标的范围
+    if (desktop.isEmpty() && !m_screenImage.isNull()) {
+        return m_canvasToCapture.inverted().mapRect(m_screenImage.rect());
+    }
+    return desktop;
+}
+
+QRect ScreenshotWindow::screenRectAt(const QPoint &canvasPos) const
+{
+    const OverlayWindow *overlay = overlayAt(canvasPos);
+    return overlay ? overlay->canvasRect() : canvasRect();
+}
+
+void ScreenshotWindow::updateCanvas(const QRegion &region)
+{
+    for (OverlayWindow *overlay : m_overlays) {
+        const QRegion local = region.intersected(overlay->canvasRect());
+        if (!local.isEmpty()) {
+            overlay->update(local.translated(-overlay->canvasRect().topLeft()));
+        }
+    }
+    // 没有遮罩窗口时（基准测试、输入回放）由本窗口直接绘制
+    if (m_overlays.isEmpty()) {
+        update(region);
+    }
+}
+
+void ScreenshotWindow::updateCanvas()
+{
+    updateCanvas(QRegion(canvasRect()));
+}
+
+void ScreenshotWindow::setOverlayCursor(Qt::CursorShape shape)
+{
+    m_cursorShape = shape;
+    for (OverlayWindow *overlay : m_overlays) {
+        overlay->setCursor(shape);
+    }
+}
+
+void ScreenshotWindow::positionToolBar()
+{
+    if (!m_toolBar || !m_hasSelected) {
+        return;
+    }
+    
+    QRect selectedRect = this->selectedRect();
+    
+    // 工具栏放到选区左下角所在的屏幕；左下角不在任何屏幕上时选与选区重叠最多的屏幕
+    OverlayWindow *host = overlayAt(selectedRect.bottomLeft());
+    if (!host) {
+        int bestArea = 0;
+        for (OverlayWindow *overlay : m_overlays) {
+            const QRect common = overlay->canvasRect().intersected(selectedRect);
+            if (common.width() * common.height() > bestArea) {
+                bestArea = common.width() * common.height();
+                host = overlay;
+            }
+        }
+    }
+    const QRect screenRect = host ? host->canvasRect() : canvasRect();
+    
+    int toolBarX = selectedRect.left();
+    int toolBarY = selectedRect.bottom() + 10;
+    
+    if (toolBarY + m_toolBar->height() > screenRect.bottom()) {
+        toolBarY = selectedRect.top() - m_toolBar->height() - 10;
+        if (toolBarY < screenRect.top()) {
+            toolBarY = screenRect.top() + 10;
+        }
+    }
+    toolBarX = qBound(screenRect.left(), toolBarX, qMax(screenRect.left(), screenRect.right() - m_toolBar->width()));
+    
+    // 没有遮罩窗口时（基准测试、输入回放）工具栏留在本窗口上
+    QWidget *parent = host ? static_cast<QWidget *>(host) : this;
+    if (m_toolBar->parentWidget() != parent) {
+        m_toolBar->setParent(parent);
+    }
+    m_toolBar->move(QPoint(toolBarX, toolBarY) - screenRect.topLeft());
+    m_toolBar->show();
+}
+
 void ScreenshotWindow::startScreenshot()
 {
-    qDebug() << "开始截图操作";
+    TRACE_SCOPE("overlay.startScreenshot");
+    qCDebug(lcCapture) << "开始截图操作";
+    if (!m_triggerPending) {
+        markTrigger();
+    }
+    // 离开空闲模式；空闲时已重建隐藏的遮罩窗口，下面的rebuildOverlays()只在屏幕或模式变化时重建
+    m_idleTimer->stop();
+    m_idle = false;
+    m_liveMode = m_liveRequested || m_liveByDefault;
+    m_liveRequested = false;
     m_isScreenshotMode = true;
     m_isSelecting = false;
     m_hasSelected = false;
@@ -196,62 +729,63 @@ void ScreenshotWindow::startScreenshot()
     m_undoItems.clear();
     m_currentMode = DrawMode::None;
     
+    // 屏幕布局变化后第一次截图时重建遮罩窗口，没有变化时直接沿用
+    rebuildOverlays();
+    
+    // 截图的同时在后台线程获取窗口树，结果随这一帧保存，遮罩显示后再取回
+    m_windowLookup = WindowLookup();
+    m_hoverWindow = QRect();
+    QVector<quint32> overlayWindows;
+    for (OverlayWindow *overlay : m_overlays) {
+        overlayWindows << quint32(overlay->winId());
+    }
+    m_windowTreeFuture = std::async(std::launch::async, [overlayWindows]() {
+        return WindowLookup(WindowTree::queryStackedWindows(overlayWindows));
+    });
+    
+    if (m_liveMode) {
+        // 不截图，透明遮罩直接显示在实时桌面上；选区确定后由captureLiveSelection()只截取选区
+        // 不等窗口树：查询时遮罩和窗口管理器给它的框架都已排除，结果由pollCaptureAnalysis()取回
+        m_screenImage = TiledImage();
+        m_canvasToCapture = QTransform();
+        m_captureMs = 0;
+        showOverlays();
+        m_showMs = m_triggerTimer.nsecsElapsed() / 1e6;
+        beginInputRecording();
+        qCDebug(lcCapture) << "实时选区模式，画布:" << canvasRect();
+        return;
+    }
+    
     // 在Wayland环境下额外处理
     bool isWayland = QGuiApplication::platformName().contains("wayland", Qt::CaseInsensitive);
     if (isWayland) {
-        qDebug() << "Wayland环境检测到，使用特殊处理";
+        qCDebug(lcCapture) << "Wayland环境检测到，使用特殊处理";
         
         // 先隐藏所有可能干扰的UI元素
         if (m_toolBar) m_toolBar->hide();
         if (m_trayIcon) m_trayIcon->hide();
         
-        // 确保窗口不会影响屏幕捕获
-        hide();
+        // 确保窗口不会影响屏幕捕获；预热后的窗口空闲时本来就是隐藏的，不需要等待
+        bool anyVisible = false;
+        for (OverlayWindow *overlay : m_overlays) {
+            anyVisible = anyVisible || overlay->isVisible();
+        }
+        const int settleMs = anyVisible ? 300 : 0;
+        hideOverlays();
         
         // 给系统一些时间来处理窗口隐藏
-        QTimer::singleShot(300, this, [this]() {
+        QTimer::singleShot(settleMs, this, [this]() {
             grabScreen();
+            m_captureMs = m_triggerTimer.nsecsElapsed() / 1e6;
             
             // 在屏幕截图完成后显示窗口
-            if (!m_screenPixmap.isNull()) {
-                showFullScreen();
-                
-                // 确保窗口覆盖整个屏幕
-                QScreen *screen = QGuiApplication::primaryScreen();
-                if (screen) {
-                    QRect screenGeom = screen->geometry();
-                    setGeometry(screenGeom);
-                    
-                    qDebug() << "设置窗口几何形状:" << screenGeom;
-                    qDebug() << "当前窗口几何形状:" << geometry();
-                    qDebug() << "截图大小:" << m_screenPixmap.size();
-                    
-                    // 重要：确保截图大小与屏幕匹配
-                    if (m_screenPixmap.size() != screenGeom.size()) {
-                        qDebug() << "调整截图大小以匹配屏幕";
-                        
-                        QPixmap scaledPixmap;
-                        // 如果截图比屏幕小，则放大
-                        if (m_screenPixmap.width() < screenGeom.width() || 
-                            m_screenPixmap.height() < screenGeom.height()) {
-                            scaledPixmap = m_screenPixmap.scaled(
-                                screenGeom.size(),
-                                Qt::KeepAspectRatio,
-                                Qt::SmoothTransformation);
-                        } else {
-                            // 如果截图过大，则确保它适合屏幕
-                            scaledPixmap = m_screenPixmap.scaled(
-                                screenGeom.size(),
-                                Qt::KeepAspectRatio,
-                                Qt::SmoothTransformation);
-                        }
-                        
-                        // 只在有效情况下更新截图
-                        if (!scaledPixmap.isNull()) {
-                            m_screenPixmap = scaledPixmap;
-                        }
-                    }
-                }
+            if (!m_screenImage.isNull()) {
+                // 重要：确保截图大小与虚拟桌面匹配，每个屏幕的遮罩窗口取自己的那一块
+                mapCaptureToDesktop();
+                showOverlays();
+                m_showMs = m_triggerTimer.nsecsElapsed() / 1e6;
+                beginInputRecording();
+                qCDebug(lcCapture) << "截图大小:" << m_screenImage.size() << "屏幕数:" << m_overlays.size();
             } else {
                 QMessageBox::critical(nullptr, "截图失败", "无法捕获屏幕");
             }
@@ -259,317 +793,595 @@ void ScreenshotWindow::startScreenshot()
     } else {
         // 非Wayland环境使用原有方法
         grabScreen();
-        showFullScreen();
+        m_captureMs = m_triggerTimer.nsecsElapsed() / 1e6;
+        mapCaptureToDesktop();
+        showOverlays();
+        m_showMs = m_triggerTimer.nsecsElapsed() / 1e6;
+        beginInputRecording();
     }
 }
 
-void ScreenshotWindow::grabScreen()
+QString ScreenshotWindow::executeCommand(const QString &command)
 {
-    // 清除之前的截图数据
-    m_screenPixmap = QPixmap();
-    
-    // 获取屏幕截图的更可靠方法
-    bool captureSuccess = false;
+    // 文件参数取命令的剩余部分（commandRest()），路径中可以有空格；客户端已换成绝对路径
+    const QStringList args = command.split(' ', Qt::SkipEmptyParts);
+    if (args.isEmpty()) {
+        return QStringLiteral("error 空命令");
+    }
     
-    // 检测当前显示服务器环境
-    bool isWayland = QGuiApplication::platformName().contains("wayland", Qt::CaseInsensitive);
-    qDebug() << "当前平台:" << QGuiApplication::platformName() << (isWayland ? "(Wayland)" : "(可能是X11)");
+    const QString name = args.first();
+    if (name == "ping") {
+        return QStringLiteral("ok pong");
+    }
     
-    // 在Wayland环境下，优先使用外部工具进行截图，避免放大问题
-    if (isWayland) {
-        // 尝试使用特定的Wayland屏幕捕获工具
-        QString tempFile = QDir::tempPath() + "/screenshot_" + 
-                          QString::number(QRandomGenerator::global()->generate()) + ".png";
-        
-        // 确保临时文件路径没有非ASCII字符
-        if (tempFile.contains(QRegularExpression("[^\\x00-\\x7F]"))) {
-            tempFile = "/tmp/screenshot_" + 
-                      QString::number(QRandomGenerator::global()->generate()) + ".png";
+    if (name == "capture-interactive") {
+        if (m_isScreenshotMode) {
+            return QStringLiteral("error 正在截图");
         }
-        
-        qDebug() << "使用临时文件:" << tempFile;
-        
-        // 特别优先使用适合Wayland的工具
-        QStringList waylandCmds;
-        
-        if (QFile::exists("/usr/bin/grim")) {
-            waylandCmds << "/usr/bin/grim \"" + tempFile + "\"";
+        // 先回复再开始截图，客户端不需要等待遮罩窗口出现
+        markTrigger();
+        QTimer::singleShot(0, this, &ScreenshotWindow::startScreenshot);
+        return QStringLiteral("ok");
+    }
+    
+    if (name == "capture-live") {
+        if (m_isScreenshotMode) {
+            return QStringLiteral("error 正在截图");
         }
-        
-        if (QFile::exists("/usr/bin/spectacle")) {
-            waylandCmds << "/usr/bin/spectacle -b -n -o \"" + tempFile + "\"";
+        markTrigger();
+        QTimer::singleShot(0, this, &ScreenshotWindow::startLiveScreenshot);
+        return QStringLiteral("ok");
+    }
+    
+    if (name == "capture-region") {
+        const QStringList parts = args.value(1).split(',');
+        if (parts.size() != 4) {
+            return QStringLiteral("error 用法: capture-region x,y,w,h [file]");
         }
-        
-        for (const QString &cmd : waylandCmds) {
-            if (captureSuccess) break;
-            
-            qDebug() << "尝试使用Wayland专用命令捕获屏幕:" << cmd;
-            
-            QProcess process;
-            process.setProcessChannelMode(QProcess::MergedChannels);
-            
-            try {
-                process.start("bash", QStringList() << "-c" << cmd);
-                
-                if (process.waitForFinished(5000)) {
-                    if (process.exitCode() == 0) {
-                        QFile file(tempFile);
-                        if (file.exists() && file.size() > 0) {
-                            qDebug() << "临时文件创建成功，大小:" << file.size() << "字节";
-                            
-                            // 加载临时文件
-                            QImage capturedImage(tempFile);
-                            if (!capturedImage.isNull()) {
-                                m_screenPixmap = QPixmap::fromImage(capturedImage);
-                                qDebug() << "使用Wayland专用工具" << cmd << "捕获屏幕成功";
-                                captureSuccess = true;
-                                
-                                // 为安全起见，删除临时文件
-                                QFile::remove(tempFile);
-                                break;
-                            }
-                        }
-                    } else {
-                        qDebug() << "命令执行失败，退出码:" << process.exitCode();
-                        qDebug() << "错误输出:" << process.readAllStandardError();
-                    }
-                } else {
-                    qDebug() << "命令执行超时";
-                }
-            } catch (...) {
-                qDebug() << "执行Wayland命令时捕获到异常";
-            }
+        QRect region(parts[0].toInt(), parts[1].toInt(), parts[2].toInt(), parts[3].toInt());
+        if (!region.isValid()) {
+            return QStringLiteral("error 无效的区域");
         }
-        
-        // 如果Wayland专用工具失败，尝试通过XDG-Desktop-Portal截图
-        if (!captureSuccess) {
-            qDebug() << "尝试使用XDG-Desktop-Portal方法";
-            
-            // 使用通用XDG-Portal的截图API（适用于大多数现代桌面环境）
-            QProcess process;
-            QString scriptPath = QDir::tempPath() + "/xdg_screenshot_" + 
-                               QString::number(QRandomGenerator::global()->generate()) + ".sh";
-            
-            QFile script(scriptPath);
-            if (script.open(QIODevice::WriteOnly | QIODevice::Text)) {
-                QTextStream out(&script);
-                out << "#!/bin/bash\n";
-                // 使用xdg-desktop-portal提供的截图服务
-                out << "dbus-send --session --print-reply --dest=org.freedesktop.portal.Desktop "
-                       "/org/freedesktop/portal/desktop org.freedesktop.portal.Screenshot.Screenshot "
-                       "boolean:true string:\"" << tempFile << "\" > /dev/null 2>&1\n";
-                out << "sleep 2\n";  // 给操作系统时间保存截图
-                script.close();
-                
-                // 使脚本可执行
-                QFile::setPermissions(scriptPath, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
-                
-                process.start("bash", QStringList() << scriptPath);
-                if (process.waitForFinished(10000)) {  // 等待10秒
-                    // 检查文件是否创建
-                    QFile file(tempFile);
-                    if (file.exists() && file.size() > 0) {
-                        QImage capturedImage(tempFile);
-                        if (!capturedImage.isNull()) {
-                            m_screenPixmap = QPixmap::fromImage(capturedImage);
-                            captureSuccess = true;
-                            qDebug() << "使用XDG-Desktop-Portal捕获屏幕成功";
-                        }
-                    }
-                }
-                
-                // 清理
-                QFile::remove(scriptPath);
-                QFile::remove(tempFile);
-            }
+        return captureRegionToFile(region, commandRest(command, 2));
+    }
+    
+    if (name == "capture-last") {
+        // capture-last [N] [file]：N为最近第几个选区，0为最近一次
+        bool isIndex = false;
+        const int index = args.value(1).toInt(&isIndex);
+        return repeatRecentRegion(isIndex ? index : 0, commandRest(command, isIndex ? 2 : 1), false);
+    }
+    
+    if (name == "record-start") {
+        // record-start [x,y,w,h|last] [file] [fps]，省略区域时录制最近一次的选区
+        QRect region = m_recentRegions.regionFor(RecentRegions::currentLayout());
+        const QStringList parts = args.value(1).split(',');
+        if (parts.size() == 4) {
+            region = QRect(parts[0].toInt(), parts[1].toInt(), parts[2].toInt(), parts[3].toInt());
+        } else if (!args.value(1).isEmpty() && args.value(1) != "last") {
+            return QStringLiteral("error 用法: record-start [x,y,w,h|last] [file] [fps]");
         }
+        QString file = commandRest(command, 2);
+        int fps = 10;
+        takeTrailingNumber(&file, &fps);
+        return startRecording(region, file, fps);
     }
     
-    // 如果上述方法都失败，或者不是Wayland环境，尝试使用其他工具
-    if (!captureSuccess) {
-        qDebug() << "尝试使用备用截图方法";
-        
-        QString tempFile = QDir::tempPath() + "/screenshot_" + 
-                      QString::number(QRandomGenerator::global()->generate()) + ".png";
-        
-        QStringList possibleCmds;
-        
-        // 检查可用的屏幕捕获工具
-        if (QFile::exists("/usr/bin/gnome-screenshot")) {
-            possibleCmds << "/usr/bin/gnome-screenshot -f \"" + tempFile + "\"";
+    if (name == "record-stop") {
+        return stopRecording();
+    }
+    
+    if (name == "scroll-start") {
+        // scroll-start [x,y,w,h|last] [file]，省略区域时使用最近一次的选区；文件省略时结果放到剪贴板
+        QRect region = m_recentRegions.regionFor(RecentRegions::currentLayout());
+        const QStringList parts = args.value(1).split(',');
+        if (parts.size() == 4) {
+            region = QRect(parts[0].toInt(), parts[1].toInt(), parts[2].toInt(), parts[3].toInt());
+        } else if (!args.value(1).isEmpty() && args.value(1) != "last") {
+            return QStringLiteral("error 用法: scroll-start [x,y,w,h|last] [file]");
         }
-        
-        if (QFile::exists("/usr/bin/ksnip")) {
-            possibleCmds << "/usr/bin/ksnip -f \"" + tempFile + "\"";
+        return startScrollSession(region, commandRest(command, 2), false);
+    }
+    
+    if (name == "scroll-stop") {
+        return stopScrollSession();
+    }
+    
+    if (name == "capture-screen") {
+        bool ok = false;
+        const int index = args.value(1).toInt(&ok);
+        const QList<QScreen*> screens = QGuiApplication::screens();
+        if (!ok || index < 0 || index >= screens.size()) {
+            return QString("error 屏幕编号应在0到%1之间").arg(screens.size() - 1);
         }
-        
-        if (QFile::exists("/usr/bin/spectacle")) {
-            possibleCmds << "/usr/bin/spectacle -b -n -o \"" + tempFile + "\"";
+        return captureRegionToFile(screens.at(index)->geometry(), commandRest(command, 2));
+    }
+    
+    if (name == "metrics") {
+        // copied_bytes是最近一次截图从抓取到导出复制像素的字节数
+        // repeat_ms是最近一次重复截取选区从收到命令到文件写完的耗时
+        return QString("ok capture_ms=%1 show_ms=%2 first_frame_ms=%3 copied_bytes=%4 repeat_ms=%5")
+            .arg(m_captureMs, 0, 'f', 2)
+            .arg(m_showMs, 0, 'f', 2)
+            .arg(m_firstFrameMs, 0, 'f', 2)
+            .arg(CaptureFrame::bytesCopied())
+            .arg(m_repeatMs, 0, 'f', 2);
+    }
+    
+    if (name == "history") {
+        if (!m_historyEnabled) {
+            return QStringLiteral("error 截图历史已关闭");
         }
-        
-        if (QFile::exists("/usr/bin/scrot")) {
-            possibleCmds << "/usr/bin/scrot \"" + tempFile + "\"";
+        if (!m_history.open()) {
+            return "error 无法打开 " + m_history.directory();
         }
-        
-        if (QFile::exists("/usr/bin/maim")) {
-            possibleCmds << "/usr/bin/maim \"" + tempFile + "\"";
+        return QString("ok count=%1 bytes=%2 latest=%3")
+            .arg(m_history.count())
+            .arg(m_history.totalBytes())
+            .arg(m_history.count() > 0 ? m_history.entry(0).filePath : QString());
+    }
+
+    if (name == "history-similar") {
+        // history-similar [N|file] [distance]：与历史中下标为N的一条（默认0，最新的一条）或某个图片文件近似的截图，
+        // 回复每条的哈希距离和文件，按距离从近到远
+        if (!m_historyEnabled) {
+            return QStringLiteral("error 截图历史已关闭");
         }
-        
-        if (QFile::exists("/usr/bin/import")) {
-            possibleCmds << "/usr/bin/import -window root \"" + tempFile + "\"";
+        if (!m_history.open()) {
+            return "error 无法打开 " + m_history.directory();
         }
-        
-        for (const QString &cmd : possibleCmds) {
-            if (captureSuccess) break;
-            
-            qDebug() << "尝试使用外部命令捕获屏幕:" << cmd;
-            
-            QProcess process;
-            process.setProcessChannelMode(QProcess::MergedChannels);
-            
-            try {
-                process.start("bash", QStringList() << "-c" << cmd);
-                
-                if (process.waitForFinished(5000)) {
-                    if (process.exitCode() == 0) {
-                        QFile file(tempFile);
-                        if (file.exists() && file.size() > 0) {
-                            QImage capturedImage(tempFile);
-                            if (!capturedImage.isNull()) {
-                                m_screenPixmap = QPixmap::fromImage(capturedImage);
-                                qDebug() << "使用外部工具" << cmd << "捕获屏幕成功";
-                                captureSuccess = true;
-                                QFile::remove(tempFile);
-                                break;
-                            }
-                        }
-                    }
-                }
-            } catch (...) {
-                qDebug() << "执行外部命令时捕获到异常";
+        bool isIndex = false;
+        const int index = args.value(1, QStringLiteral("0")).toInt(&isIndex);
+        quint64 hash = 0;
+        quint64 exclude = 0;
+        int maxDistance = ImageDiff::SimilarDistance;
+        if (isIndex) {
+            const HistoryStore::Entry query = m_history.entry(index);
+            if (query.sequence == 0) {
+                return QString("error 历史中没有第%1条").arg(index);
+            }
+            hash = query.perceptualHash;
+            exclude = query.sequence;
+            bool ok = false;
+            const int distance = args.value(2).toInt(&ok);
+            if (ok) {
+                maxDistance = distance;
             }
+        } else {
+            QString file = commandRest(command, 1);
+            takeTrailingNumber(&file, &maxDistance);
+            const QImage image(file);
+            if (image.isNull()) {
+                return "error 无法读取图片: " + file;
+            }
+            hash = HistoryStore::perceptualHash(image);
         }
+        const QVector<HistoryStore::Match> matches = m_history.findSimilar(hash, maxDistance, exclude);
+        QString reply = QString("ok matches=%1").arg(matches.size());
+        for (const HistoryStore::Match &match : matches) {
+            reply += QString(" %1:%2").arg(match.distance).arg(match.entry.filePath);
+        }
+        return reply;
+    }
+
+    if (name == "stats") {
+        return idleStats();
     }
     
-    // 最后，如果所有方法都失败，使用Qt原生方法 - 但在Wayland下可能有问题
-    if (!captureSuccess) {
-        qDebug() << "所有外部工具捕获失败，尝试使用Qt原生方法 (在Wayland下可能导致缩放问题)";
-        
-        QList<QScreen*> screens = QGuiApplication::screens();
-        
-        if (screens.isEmpty()) {
-            qDebug() << "错误：无法获取任何屏幕";
+    if (name == "idle") {
+        if (m_isScreenshotMode) {
+            return QStringLiteral("error 正在截图");
+        }
+        enterIdleMode();
+        return m_idle ? QStringLiteral("ok") : QStringLiteral("error 后台任务未完成，稍后重试");
+    }
+    
+    if (name == "dump-log") {
+        const QString path = args.size() > 1 ? commandRest(command, 1)
+                                             : QDir::tempPath() + QString("/screenshotlinux-%1.log")
+                                                                      .arg(QCoreApplication::applicationPid());
+        return RingLog::dumpToFile(path) ? "ok " + path : "error 无法写入 " + path;
+    }
+    
+    if (name == "trace-start") {
+        Trace::clear();
+        Trace::setEnabled(true);
+        return QStringLiteral("ok");
+    }
+    
+    if (name == "trace-stop" || name == "trace-dump") {
+        const QString path = args.size() > 1 ? commandRest(command, 1)
+                                             : (m_traceOutput.isEmpty() ? QDir::tempPath() + "/screenshotlinux-trace.json"
+                                                                        : m_traceOutput);
+        if (name == "trace-stop") {
+            Trace::setEnabled(false);
+        }
+        return Trace::writeChromeTrace(path) ? "ok " + path : "error 无法写入 " + path;
+    }
+    
+    if (name == "last-result") {
+        return m_lastResult.isEmpty() ? QStringLiteral("error 还没有截图结果")
+                                      : "ok " + m_lastResult;
+    }
+    
+    return "error 未知命令: " + name;
+}
+
+QString ScreenshotWindow::defaultSavePath() const
+{
+    return QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) +
+           "/screenshot_" + QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss") + ".png";
+}
+
+QString ScreenshotWindow::captureRegionToFile(const QRect &region, const QString &filePath)
+{
+    TRACE_SCOPE("capture.region");
+    QElapsedTimer timer;
+    timer.start();
+    const QString path = filePath.isEmpty() ? defaultSavePath() : filePath;
+    const ImageEncoder::Profile profile = ImageEncoder::profileForFileName(path);
+    const bool history = m_historyEnabled;
+    CaptureFrame::resetBytesCopied();
+    
+    // 外部工具截图（每个工具最多等几秒）、编码和写文件都在后台线程，不阻塞托盘和其他客户端的命令；
+    // 与重复截取相同，立即回复文件路径，写完后last-result返回它。外部后端都不可用时回到主线程用Qt截图
+    reapPendingWrites();
+    m_pendingWrites.push_back(std::async(std::launch::async, [this, region, path, profile, timer, history]() {
+        QString backend;
+        const QImage image = ScreenCapture::grabRegion(region, &backend, ScreenCapture::ExternalBackends);
+        if (!image.isNull()) {
+            qCDebug(lcCapture) << "区域截图完成，后端:" << backend << "区域:" << region;
+            writeCapture(image, path, profile, timer, false, history);
             return;
         }
-        
-        // 计算屏幕边界 - 找到所有屏幕几何区域的联合
-        QRect totalGeometry;
-        bool firstScreen = true;
-        
-        for (QScreen *screen : screens) {
-            QRect screenGeom = screen->geometry();
-            qreal scaleFactor = screen->devicePixelRatio();
-            
-            qDebug() << "屏幕:" << screen->name() 
-                     << "几何区域:" << screenGeom
-                     << "分辨率:" << screen->size()
-                     << "设备像素比:" << scaleFactor;
-            
-            // 在Wayland下处理缩放因子
-            if (isWayland) {
-                qDebug() << "Wayland环境应用缩放因子:" << scaleFactor;
-                screenGeom = QRect(
-                    screenGeom.x(), 
-                    screenGeom.y(),
-                    qRound(screenGeom.width() * scaleFactor),
-                    qRound(screenGeom.height() * scaleFactor)
-                );
-            }
-            
-            if (firstScreen) {
-                totalGeometry = screenGeom;
-                firstScreen = false;
-            } else {
-                totalGeometry = totalGeometry.united(screenGeom);
+        QMetaObject::invokeMethod(this, [this, region, path, profile, timer, history]() {
+            QString backend;
+            const QImage image = ScreenCapture::grabRegion(region, &backend, ScreenCapture::QtBackend);
+            if (image.isNull()) {
+                qCWarning(lcCapture) << "区域截图失败:" << region;
+                finishRepeatWrite(path, false, timer.nsecsElapsed() / 1e6, false);
+                return;
             }
+            qCDebug(lcCapture) << "区域截图完成，后端:" << backend << "区域:" << region;
+            m_pendingWrites.push_back(std::async(std::launch::async, [this, image, path, profile, timer, history]() {
+                writeCapture(image, path, profile, timer, false, history);
+            }));
+        }, Qt::QueuedConnection);
+    }));
+    scheduleIdle();
+    return "ok " + path;
+}
+
+QString ScreenshotWindow::repeatRecentRegion(int index, const QString &filePath, bool notify)
+{
+    TRACE_SCOPE("capture.repeatRegion");
+    QElapsedTimer timer;
+    timer.start();
+    if (m_isScreenshotMode) {
+        return QStringLiteral("error 正在截图");
+    }
+    const QRect region = m_recentRegions.regionFor(RecentRegions::currentLayout(), index);
+    if (!region.isValid()) {
+        return QStringLiteral("error 没有与当前屏幕布局匹配的最近选区");
+    }
+    const QString path = filePath.isEmpty() ? defaultSavePath() : filePath;
+    
+    QString backend;
+    CaptureFrame::resetBytesCopied();
+    const QImage image = ScreenCapture::grabRegion(region, &backend);
+    if (image.isNull()) {
+        return QStringLiteral("error 截图失败");
+    }
+    m_captureMs = timer.nsecsElapsed() / 1e6;
+    qCDebug(lcCapture) << "重复截取最近选区，后端:" << backend << "区域:" << region
+                       << "耗时:" << m_captureMs << "ms";
+    
+    // 重复截图追求触发到落盘的延迟，PNG使用低压缩级别；编码和写文件不占用主线程
+    ImageEncoder::Profile profile = ImageEncoder::profileForFileName(path);
+    if (profile == ImageEncoder::Profile::PngSmall) {
+        profile = ImageEncoder::Profile::PngFast;
+    }
+    const bool history = m_historyEnabled;
+    reapPendingWrites();
+    m_pendingWrites.push_back(std::async(std::launch::async, [this, image, path, profile, timer, notify, history]() {
+        writeCapture(image, path, profile, timer, notify, history);
+    }));
+    scheduleIdle();
+    return "ok " + path;
+}
+
+void ScreenshotWindow::writeCapture(const QImage &image, const QString &filePath, ImageEncoder::Profile profile,
+                                    const QElapsedTimer &timer, bool notify, bool history)
+{
+    const bool written = writeImageFile(image, filePath, profile);
+    const double totalMs = timer.nsecsElapsed() / 1e6;
+    QMetaObject::invokeMethod(this, [this, filePath, written, totalMs, notify]() {
+        finishRepeatWrite(filePath, written, totalMs, notify);
+    }, Qt::QueuedConnection);
+    // 写完文件再记入历史，同一张截图的对象已经存在，历史中的文件直接链接到它，不再编码
+    if (history && (!m_history.open() || !m_history.add(image))) {
+        qCWarning(lcExport) << "无法写入截图历史:" << m_history.directory();
+    }
+}
+
+void ScreenshotWindow::finishRepeatWrite(const QString &filePath, bool written, double totalMs, bool notify)
+{
+    reapPendingWrites();
+    
+    if (!written) {
+        qCWarning(lcExport) << "无法写入截图:" << filePath;
+        if (notify && m_trayIcon) {
+            m_trayIcon->showMessage("保存失败", "无法保存截图到:\n" + filePath, QSystemTrayIcon::Critical);
         }
-        
-        qDebug() << "合并后的屏幕几何区域:" << totalGeometry;
-        
-        // 创建一个足够大的QPixmap来容纳所有屏幕
-        QPixmap combinedPixmap(totalGeometry.size());
-        combinedPixmap.fill(Qt::transparent);
-        
-        QPainter painter(&combinedPixmap);
-        
-        // 捕获每个屏幕并绘制到正确位置
-        for (QScreen *screen : screens) {
-            QRect screenGeom = screen->geometry();
-            qreal scaleFactor = screen->devicePixelRatio();
-            
-            // 计算此屏幕相对于合并区域的偏移
-            int offsetX = screenGeom.left() - totalGeometry.left();
-            int offsetY = screenGeom.top() - totalGeometry.top();
-            
-            if (isWayland) {
-                // 在Wayland下调整偏移量以考虑缩放
-                offsetX = qRound(offsetX * scaleFactor);
-                offsetY = qRound(offsetY * scaleFactor);
+        return;
+    }
+    m_lastResult = filePath;
+    m_repeatMs = totalMs;
+    qCDebug(lcExport) << "最近选区已保存:" << filePath << "触发到写完:" << totalMs << "ms";
+    if (notify && m_trayIcon) {
+        m_trayIcon->showMessage("截图已保存", filePath);
+    }
+}
+
+void ScreenshotWindow::reapPendingWrites()
+{
+    m_pendingWrites.erase(std::remove_if(m_pendingWrites.begin(), m_pendingWrites.end(), [](const std::future<void> &write) {
+        return write.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }), m_pendingWrites.end());
+}
+
+void ScreenshotWindow::recordHistory(const QImage &image)
+{
+    if (!m_historyEnabled || image.isNull()) {
+        return;
+    }
+    reapPendingWrites();
+    // 编码、缩略图都在后台线程；索引和图集的追加在HistoryStore内部加锁
+    m_pendingWrites.push_back(std::async(std::launch::async, [this, image]() {
+        if (!m_history.open() || !m_history.add(image)) {
+            qCWarning(lcExport) << "无法写入截图历史:" << m_history.directory();
+        }
+    }));
+}
+
+void ScreenshotWindow::updateHistoryMenu()
+{
+    if (!m_historyMenu) {
+        return;
+    }
+    m_historyMenu->clear();
+    // 打开只映射索引和图集，条目和缩略图直接从映射的内存读取；后台线程可能同时在追加，一次取出
+    const QVector<HistoryStore::Recent> items = m_history.open() ? m_history.recent(10) : QVector<HistoryStore::Recent>();
+    for (const HistoryStore::Recent &item : items) {
+        const HistoryStore::Entry &entry = item.entry;
+        const QString title = QString("%1  %2×%3").arg(entry.time.toString("MM-dd hh:mm:ss"))
+                                  .arg(entry.size.width()).arg(entry.size.height());
+        QAction *action = m_historyMenu->addAction(QIcon(QPixmap::fromImage(item.thumbnail)), title);
+        const QString filePath = entry.filePath;
+        connect(action, &QAction::triggered, this, [this, filePath]() {
+            const QImage image(filePath);
+            if (image.isNull()) {
+                if (m_trayIcon) {
+                    m_trayIcon->showMessage("截图历史", "文件已不存在:\n" + filePath, QSystemTrayIcon::Warning);
+                }
+                return;
             }
-            
-            QPoint offset(offsetX, offsetY);
-            qDebug() << "尝试捕获屏幕:" << screen->name() 
-                     << "偏移:" << offset;
-            
-            // 捕获此屏幕
-            QPixmap screenPixmap;
-            
-            // 使用grabWindow()还是grabWindow(0)，取决于平台
-            try {
-                // 使用参数0表示捕获整个屏幕
-                screenPixmap = screen->grabWindow(0);
-                
-                if (!screenPixmap.isNull()) {
-                    qDebug() << "屏幕" << screen->name() << "捕获成功，大小:" << screenPixmap.size();
-                    
-                    // 在Wayland下处理缩放问题
-                    if (isWayland && qAbs(scaleFactor - 1.0) > 0.01) {
-                        // 在Qt中处理Wayland缩放问题的方法
-                        qDebug() << "Wayland环境下，处理截图缩放，原始尺寸:" << screenPixmap.size();
-                        QImage img = screenPixmap.toImage();
-                        
-                        // 将图像缩放到正确的物理尺寸
-                        int targetWidth = qRound(img.width() * scaleFactor);
-                        int targetHeight = qRound(img.height() * scaleFactor);
-                        qDebug() << "调整为物理尺寸:" << QSize(targetWidth, targetHeight);
-                        
-                        QImage scaledImage = img.scaled(targetWidth, targetHeight, 
-                                                       Qt::IgnoreAspectRatio, 
-                                                       Qt::SmoothTransformation);
-                        screenPixmap = QPixmap::fromImage(scaledImage);
-                    }
-                    
-                    // 绘制到合并的图像中
-                    painter.drawPixmap(offset, screenPixmap);
-                    captureSuccess = true;
-                } else {
-                    qDebug() << "屏幕" << screen->name() << "捕获失败";
+            QGuiApplication::clipboard()->setMimeData(new LazyImageMimeData(image));
+            m_lastResult = QStringLiteral("clipboard");
+        });
+    }
+    if (!items.isEmpty()) {
+        m_historyMenu->addSeparator();
+    }
+    QAction *openFolder = m_historyMenu->addAction("打开历史目录");
+    connect(openFolder, &QAction::triggered, this, [this]() {
+        QDesktopServices::openUrl(QUrl::fromLocalFile(m_history.directory() + "/files"));
+    });
+}
+
+void ScreenshotWindow::rememberSelection()
+{
+    m_recentRegions.remember(selectedRect().translated(m_canvasOrigin), RecentRegions::currentLayout());
+    m_recentRegions.save();
+}
+
+void ScreenshotWindow::updateRecentRegionsMenu()
+{
+    if (!m_recentRegionsMenu) {
+        return;
+    }
+    m_recentRegionsMenu->clear();
+    const QList<QRect> regions = m_recentRegions.regionsFor(RecentRegions::currentLayout());
+    const bool isWayland = QGuiApplication::platformName().contains("wayland", Qt::CaseInsensitive);
+    for (int i = 0; i < regions.size(); ++i) {
+        QAction *action = m_recentRegionsMenu->addAction(regionTitle(regions.at(i)));
+        connect(action, &QAction::triggered, this, [this, i, isWayland]() {
+            // 等托盘菜单从屏幕上消失后再截图
+            QTimer::singleShot(isWayland ? 100 : 0, this, [this, i]() {
+                const QString reply = repeatRecentRegion(i, QString(), true);
+                if (reply.startsWith("error") && m_trayIcon) {
+                    m_trayIcon->showMessage("截图失败", reply.mid(6), QSystemTrayIcon::Warning);
                 }
-            } catch (...) {
-                qDebug() << "捕获屏幕时发生异常";
+            });
+        });
+    }
+    m_recentRegionsMenu->setEnabled(!regions.isEmpty());
+    if (m_recordAction) {
+        m_recordAction->setText(m_recorder ? "停止录制" : "录制最近选区");
+        m_recordAction->setEnabled(m_recorder || !regions.isEmpty());
+    }
+}
+
+QString ScreenshotWindow::startRecording(const QRect &region, const QString &filePath, int fps)
+{
+    if (m_recorder) {
+        return QStringLiteral("error 正在录制");
+    }
+    if (m_stoppingRecorder) {
+        return QStringLiteral("error 上一次录制还在写出");
+    }
+    if (!region.isValid()) {
+        return QStringLiteral("error 没有可录制的区域");
+    }
+    ScreenRecorder::Options options;
+    options.region = region;
+    options.output = filePath;
+    if (options.output.isEmpty()) {
+        // 默认文件名与截图相同，后缀换成gif
+        options.output = defaultSavePath();
+        options.output.chop(QStringLiteral(".png").size());
+        options.output += QStringLiteral(".gif");
+    }
+    options.fps = fps;
+    std::unique_ptr<ScreenRecorder> recorder(new ScreenRecorder(options));
+    QString error;
+    if (!recorder->start(&error)) {
+        return "error " + error;
+    }
+    m_recorder = std::move(recorder);
+    m_idleTimer->stop();
+    qCDebug(lcCapture) << "开始录制:" << region << "->" << options.output << "帧率:" << options.fps;
+    return "ok " + options.output;
+}
+
+QString ScreenshotWindow::stopRecording()
+{
+    if (!m_recorder) {
+        return QStringLiteral("error 没有正在进行的录制");
+    }
+    // 停止截图后立即回复截取的帧数；剩余帧的编码和写出（视频还要等ffmpeg结束）在后台线程完成，
+    // 不阻塞界面线程，完成后记为最近的结果并在托盘提示
+    m_stoppingRecorder = std::move(m_recorder);
+    const QString output = m_stoppingRecorder->options().output;
+    m_stoppingRecorder->stopAsync(this, [this, output](const ScreenRecorder::Stats &stats, const QString &error) {
+        m_stoppingRecorder.reset();
+        scheduleIdle();
+        qCDebug(lcExport) << "录制结束:" << output << "帧:" << stats.written << "丢帧:" << stats.dropped
+                          << "字节:" << stats.bytes;
+        if (error.isEmpty()) {
+            m_lastResult = output;
+        }
+        if (m_trayIcon) {
+            if (error.isEmpty()) {
+                m_trayIcon->showMessage("录制完成", QString("%1\n%2帧，丢帧%3").arg(output).arg(stats.written).arg(stats.dropped));
+            } else {
+                m_trayIcon->showMessage("录制失败", error, QSystemTrayIcon::Warning);
             }
         }
-        
-        painter.end();
-        
-        if (captureSuccess) {
-            m_screenPixmap = combinedPixmap;
-            qDebug() << "合并所有屏幕成功，总大小:" << m_screenPixmap.size();
+    });
+    const ScreenRecorder::Stats stats = m_stoppingRecorder->stats();
+    return QString("ok %1 frames=%2 dropped=%3 duration_s=%4")
+        .arg(output)
+        .arg(stats.captured)
+        .arg(stats.dropped)
+        .arg(stats.seconds, 0, 'f', 2);
+}
+
+QString ScreenshotWindow::startScrollSession(const QRect &region, const QString &filePath, bool notify)
+{
+    if (m_scrollSession) {
+        return QStringLiteral("error 正在长截图");
+    }
+    if (!region.isValid()) {
+        return QStringLiteral("error 没有可截取的区域");
+    }
+    ScrollSession::Options options;
+    options.region = region;
+    options.autoScroll = ScrollInput::isAvailable();
+    if (!options.autoScroll) {
+        // 用户自己滚动，停下来的时间留长一些
+        options.idleMs = 5000;
+    }
+    std::unique_ptr<ScrollSession> session(new ScrollSession(options));
+    QString error;
+    const bool started = session->start([this, filePath, notify](const QImage &image, const QString &message) {
+        m_scrollReply = finishScrollSession(image, filePath, message, notify);
+        // 回调在会话自己的定时器里调用，回到事件循环后再销毁会话
+        QMetaObject::invokeMethod(this, [this]() {
+            if (m_scrollSession && !m_scrollSession->isRunning()) {
+                m_scrollSession.reset();
+                scheduleIdle();
+            }
+        }, Qt::QueuedConnection);
+    }, &error);
+    if (!started) {
+        return "error " + error;
+    }
+    m_scrollSession = std::move(session);
+    m_idleTimer->stop();
+    qCDebug(lcCapture) << "开始长截图:" << region << "自动滚动:" << options.autoScroll;
+    if (notify && m_trayIcon && !options.autoScroll) {
+        m_trayIcon->showMessage("长截图", "请在选区内滚动要截取的内容，停止滚动5秒后结束");
+    }
+    return QStringLiteral("ok");
+}
+
+QString ScreenshotWindow::stopScrollSession()
+{
+    if (!m_scrollSession || !m_scrollSession->isRunning()) {
+        return QStringLiteral("error 没有正在进行的长截图");
+    }
+    m_scrollSession->stop();
+    return m_scrollReply;
+}
+
+QString ScreenshotWindow::finishScrollSession(const QImage &image, const QString &filePath, const QString &error, bool notify)
+{
+    const ScrollSession::Stats stats = m_scrollSession ? m_scrollSession->stats() : ScrollSession::Stats();
+    qCDebug(lcExport) << "长截图结束，帧:" << stats.frames << "拼接:" << stats.appended << "高度:" << stats.height
+                      << "平均拼接耗时:" << (stats.frames > 0 ? stats.stitchMs / stats.frames : 0.0) << "ms";
+    QString failure = error;
+    if (failure.isEmpty() && !filePath.isEmpty() && !writeImageFile(image, filePath)) {
+        failure = "无法写入 " + filePath;
+    }
+    if (!failure.isEmpty()) {
+        if (notify && m_trayIcon) {
+            m_trayIcon->showMessage("长截图失败", failure, QSystemTrayIcon::Warning);
         }
+        return "error " + failure;
     }
+    if (filePath.isEmpty()) {
+        QGuiApplication::clipboard()->setMimeData(new LazyImageMimeData(image));
+        m_lastResult = QStringLiteral("clipboard");
+    } else {
+        m_lastResult = filePath;
+    }
+    recordHistory(image);
+    if (notify && m_trayIcon) {
+        m_trayIcon->showMessage("长截图完成", QString("%1×%2，已%3").arg(image.width()).arg(image.height())
+                                    .arg(filePath.isEmpty() ? QStringLiteral("复制到剪贴板") : "保存到 " + filePath));
+    }
+    return QString("ok %1 height=%2 frames=%3").arg(m_lastResult).arg(image.height()).arg(stats.frames);
+}
+
+void ScreenshotWindow::startScrollCapture()
+{
+    if (!m_hasSelected) {
+        return;
+    }
+    const QRect region = selectedRect().translated(m_canvasOrigin);
+    rememberSelection();
+    cancelScreenshot();
+    // 等遮罩从屏幕上消失后再开始截取
+    QTimer::singleShot(kLiveCaptureSettleMs, this, [this, region]() {
+        const QString reply = startScrollSession(region, QString(), true);
+        if (reply.startsWith("error") && m_trayIcon) {
+            m_trayIcon->showMessage("长截图失败", reply.mid(6), QSystemTrayIcon::Warning);
+        }
+    });
+}
+
+void ScreenshotWindow::grabScreen()
+{
+    TRACE_SCOPE("capture.grabScreen");
+    QString backend;
+    CaptureFrame::resetBytesCopied();
+    m_screenImage = ScreenCapture::grabDesktop(&backend);
+    qCDebug(lcCapture) << "截图后端:" << backend << "截图大小:" << m_screenImage.size()
+                       << "复制字节:" << CaptureFrame::bytesCopied();
     
-    // 最后的尝试 - 如果所有方法都失败
-    if (m_screenPixmap.isNull()) {
+    // 所有后端都失败时提示安装截图工具
+    if (m_screenImage.isNull()) {
         QMessageBox::critical(nullptr, "截图失败", 
                              "无法捕获屏幕。\n\n"
                              "您使用的是Wayland显示服务器，请确保安装了以下工具之一:\n"
@@ -592,34 +1404,28 @@ void ScreenshotWindow::showAboutDialog()
 
 void ScreenshotWindow::saveScreenshot()
 {
-    if (m_hasSelected && !m_screenPixmap.isNull()) {
+    if (m_liveMode && m_hasSelected && m_screenImage.isNull()) {
+        captureLiveSelection([this]() { saveScreenshot(); });
+        return;
+    }
+    
+    if (m_hasSelected && !m_screenImage.isNull()) {
+        rememberSelection();
+        
         // 获取保存文件路径
         QString filePath = QFileDialog::getSaveFileName(
             this,
             "保存截图",
-            QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) + 
-                "/screenshot_" + QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss") + ".png",
+            defaultSavePath(),
             "图像文件 (*.png *.jpg *.bmp)");
         
         if (!filePath.isEmpty()) {
-            // 获取选择的区域
-            QRect rect = selectedRect();
-            QPixmap selectedPixmap = m_screenPixmap.copy(rect);
-            
-            // 将绘制的项目应用到截图上
-            if (!m_drawItems.isEmpty()) {
-                QPainter painter(&selectedPixmap);
-                painter.setRenderHint(QPainter::Antialiasing);
-                
-                // 相对于选择区域调整绘制位置
-                painter.translate(-rect.topLeft());
-                
-                drawOnPainter(painter);
-                painter.end();
-            }
+            QImage selectedImage = composeSelection();
             
             // 保存图像
-            if (selectedPixmap.save(filePath)) {
+            if (writeImageFile(selectedImage, filePath)) {
+                m_lastResult = filePath;
+                recordHistory(selectedImage);
                 QMessageBox::information(this, "保存成功", "截图已保存到:\n" + filePath);
             } else {
                 QMessageBox::critical(this, "保存失败", "无法保存截图到:\n" + filePath);
@@ -639,9 +1445,29 @@ void ScreenshotWindow::cancelScreenshot()
     m_currentMode = DrawMode::None;
     m_drawItems.clear();
     m_undoItems.clear();
-    m_rubberBand->hide();
+    m_selection.endDrag();
+    m_selection.setRect(QRect());
+    m_loupeVisible = false;
+    m_hoverWindow = QRect();
+    m_windowLookup = WindowLookup();
+    m_selection.setEdgeMap(nullptr);
+    m_edgeMap = EdgeMap();
+    setOverlayCursor(Qt::ArrowCursor);
     m_toolBar->hide();
-    hide();
+    hideOverlays();
+    
+    if (m_inputRecorder) {
+        m_inputRecorder->stop();
+    }
+    scheduleIdle();
+    
+    if (Trace::isEnabled() && m_traceSessionId != 0) {
+        Trace::endAsync("screenshot.session", m_traceSessionId);
+        // 每次会话结束都写一次，托盘进程不一定能正常退出
+        if (!m_traceOutput.isEmpty()) {
+            Trace::writeChromeTrace(m_traceOutput);
+        }
+    }
     
     // 在Wayland环境下，确保托盘图标重新显示
     if (QGuiApplication::platformName().contains("wayland", Qt::CaseInsensitive)) {
@@ -659,26 +1485,24 @@ void ScreenshotWindow::cancelScreenshot()
 
 void ScreenshotWindow::finishScreenshot()
 {
-    if (m_hasSelected && !m_screenPixmap.isNull()) {
-        // 获取选择的区域
-        QRect rect = selectedRect();
-        QPixmap selectedPixmap = m_screenPixmap.copy(rect);
-        
-        // 将绘制的项目应用到截图上
-        if (!m_drawItems.isEmpty()) {
-            QPainter painter(&selectedPixmap);
-            painter.setRenderHint(QPainter::Antialiasing);
-            
-            // 相对于选择区域调整绘制位置
-            painter.translate(-rect.topLeft());
-            
-            drawOnPainter(painter);
-            painter.end();
-        }
+    if (m_liveMode && m_hasSelected && m_screenImage.isNull()) {
+        captureLiveSelection([this]() { finishScreenshot(); });
+        return;
+    }
+    
+    if (m_hasSelected && !m_screenImage.isNull()) {
+        rememberSelection();
         
-        // 复制到剪贴板
+        // 复制到剪贴板：只登记可提供的格式，粘贴方请求时才编码
         QClipboard *clipboard = QGuiApplication::clipboard();
-        clipboard->setPixmap(selectedPixmap);
+        QImage selectedImage = composeSelection();
+        {
+            TRACE_SCOPE("export.clipboard");
+            clipboard->setMimeData(new LazyImageMimeData(selectedImage));
+        }
+        recordHistory(selectedImage);
+        qCDebug(lcExport) << "本次截图复制像素字节:" << CaptureFrame::bytesCopied();
+        m_lastResult = QStringLiteral("clipboard");
         
         // 显示成功消息
         QMessageBox::information(this, "截图完成", "截图已复制到剪贴板");
@@ -688,12 +1512,17 @@ void ScreenshotWindow::finishScreenshot()
     cancelScreenshot();
 }
 
+QImage ScreenshotWindow::composeSelection() const
+{
+    return AnnotationRenderer::compose(m_screenImage, selectedRect(), m_drawItems, m_canvasToCapture);
+}
+
 void ScreenshotWindow::drawRectangle()
 {
     // 保护选区状态，防止触发重新选择
     if (m_hasSelected) {
         m_currentMode = DrawMode::Rectangle;
-        qDebug() << "切换到矩形绘制模式，保持已选区状态";
+        qCDebug(lcOverlay) << "切换到矩形绘制模式，保持已选区状态";
     }
 }
 
@@ -702,7 +1531,7 @@ void ScreenshotWindow::drawCircle()
     // 保护选区状态，防止触发重新选择
     if (m_hasSelected) {
         m_currentMode = DrawMode::Circle;
-        qDebug() << "切换到圆形绘制模式，保持已选区状态";
+        qCDebug(lcOverlay) << "切换到圆形绘制模式，保持已选区状态";
     }
 }
 
@@ -711,7 +1540,7 @@ void ScreenshotWindow::drawArrow()
     // 保护选区状态，防止触发重新选择
     if (m_hasSelected) {
         m_currentMode = DrawMode::Arrow;
-        qDebug() << "切换到箭头绘制模式，保持已选区状态";
+        qCDebug(lcOverlay) << "切换到箭头绘制模式，保持已选区状态";
     }
 }
 
@@ -730,7 +1559,7 @@ void ScreenshotWindow::drawText()
         item.text = text;
         item.color = Qt::red; // 默认颜色
         m_drawItems.append(item);
-        update();
+        updateCanvas();
     }
 }
 
@@ -739,7 +1568,7 @@ void ScreenshotWindow::drawBrush()
     // 保护选区状态，防止触发重新选择
     if (m_hasSelected) {
         m_currentMode = DrawMode::Brush;
-        qDebug() << "切换到画笔绘制模式，保持已选区状态";
+        qCDebug(lcOverlay) << "切换到画笔绘制模式，保持已选区状态";
     }
 }
 
@@ -747,193 +1576,178 @@ void ScreenshotWindow::undo()
 {
     if (!m_drawItems.isEmpty()) {
         m_undoItems.append(m_drawItems.takeLast());
-        update();
+        updateCanvas();
     }
 }
 
-void ScreenshotWindow::drawOnPainter(QPainter &painter)
+void ScreenshotWindow::updateLoupe(const QPoint &pos)
 {
-    for (const DrawItem &item : m_drawItems) {
-        switch (item.mode) {
-            case DrawMode::Rectangle: {
-                painter.setPen(QPen(Qt::red, 2));
-                painter.drawRect(item.rect);
-                break;
-            }
-            case DrawMode::Circle: {
-                painter.setPen(QPen(Qt::red, 2));
-                painter.drawEllipse(item.rect);
-                break;
-            }
-            case DrawMode::Arrow: {
-                // 绘制箭头
-                painter.setPen(QPen(Qt::red, 2));
-                painter.drawLine(item.start, item.end);
-                
-                // 计算箭头角度
-                QLineF line(item.end, item.start);
-                double angle = std::atan2(-line.dy(), line.dx());
-                
-                // 绘制箭头头部
-                QPointF arrowP1 = item.end + QPointF(sin(angle + M_PI / 3) * 10,
-                                              cos(angle + M_PI / 3) * 10);
-                QPointF arrowP2 = item.end + QPointF(sin(angle + M_PI - M_PI / 3) * 10,
-                                              cos(angle + M_PI - M_PI / 3) * 10);
-                
-                QPolygonF arrowHead;
-                arrowHead << item.end << arrowP1 << arrowP2;
-                painter.setBrush(Qt::red);
-                painter.drawPolygon(arrowHead);
-                break;
-            }
-            case DrawMode::Text: {
-                painter.setPen(QPen(Qt::red, 2));
-                QFont font = painter.font();
-                font.setPointSize(12);
-                painter.setFont(font);
-                painter.drawText(item.rect.topLeft(), item.text);
-                break;
-            }
-            case DrawMode::Brush: {
-                painter.setPen(QPen(Qt::red, 3, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
-                if (item.brushPoints.size() > 1) {
-                    for (int i = 1; i < item.brushPoints.size(); ++i) {
-                        painter.drawLine(item.brushPoints[i-1], item.brushPoints[i]);
-                    }
-                }
-                break;
-            }
-            case DrawMode::Mosaic: {
-                // 马赛克效果实现
-                int blockSize = 10; // 马赛克块大小
-                QRect rect = item.rect.normalized();
-                
-                for (int y = rect.top(); y < rect.bottom(); y += blockSize) {
-                    for (int x = rect.left(); x < rect.right(); x += blockSize) {
-                        int w = qMin(blockSize, rect.right() - x);
-                        int h = qMin(blockSize, rect.bottom() - y);
-                        QRect block(x, y, w, h);
-                        
-                        // 获取块的平均颜色
-                        QRect globalBlock = block.translated(0, 0); // 转换为全局坐标
-                        if (globalBlock.left() >= 0 && globalBlock.top() >= 0 &&
-                            globalBlock.right() < m_screenPixmap.width() &&
-                            globalBlock.bottom() < m_screenPixmap.height()) {
-                            
-                            QImage blockImage = m_screenPixmap.copy(globalBlock).toImage();
-                            int r = 0, g = 0, b = 0, pixels = 0;
-                            
-                            for (int by = 0; by < blockImage.height(); ++by) {
-                                for (int bx = 0; bx < blockImage.width(); ++bx) {
-                                    QColor pixelColor = blockImage.pixelColor(bx, by);
-                                    r += pixelColor.red();
-                                    g += pixelColor.green();
-                                    b += pixelColor.blue();
-                                    pixels++;
-                                }
-                            }
-                            
-                            if (pixels > 0) {
-                                QColor avgColor(r / pixels, g / pixels, b / pixels);
-                                painter.fillRect(block, avgColor);
-                            }
-                        }
-                    }
-                }
-                break;
-            }
-            case DrawMode::None:
-                break;
+    QRegion dirty;
+    if (m_loupeVisible) {
+        dirty += m_magnifier.rectFor(m_cursorPos, screenRectAt(m_cursorPos));
+    }
+    m_cursorPos = pos;
+    m_loupeVisible = m_currentMode == DrawMode::None;
+    if (m_loupeVisible) {
+        dirty += m_magnifier.rectFor(m_cursorPos, screenRectAt(m_cursorPos));
+    }
+    if (!dirty.isEmpty()) {
+        updateCanvas(dirty);
+    }
+}
+
+void ScreenshotWindow::pollCaptureAnalysis()
+{
+    if (m_windowTreeFuture.valid() &&
+        m_windowTreeFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        m_windowLookup = m_windowTreeFuture.get();
+    }
+    if (m_edgeMapFuture.valid() &&
+        m_edgeMapFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        m_edgeMap = m_edgeMapFuture.get();
+        m_selection.setEdgeMap(m_edgeMap.isNull() ? nullptr : &m_edgeMap);
+    }
+}
+
+void ScreenshotWindow::startEdgeMap()
+{
+    if (!m_isScreenshotMode || m_screenImage.isNull()) {
+        return;
+    }
+    // 各块隐式共享，后台线程只读这一份像素
+    const TiledImage image = m_screenImage;
+    const QTransform toCapture = m_canvasToCapture;
+    m_edgeMapFuture = std::async(std::launch::async, [image, toCapture]() {
+        // 按截图的设备像素找边缘，吸附时换算回画布坐标
+        EdgeMap map = EdgeMap::build(image);
+        map.setCanvasScale(toCapture.m11(), toCapture.m22());
+        return map;
+    });
+}
+
+QPoint ScreenshotWindow::snapSelectionEnd(const QPoint &pos, bool snapEdges)
+{
+    // 与调整已有选区时相同：移动的竖边和横边各自在当前跨度内找连续的图像边缘，按住Alt时不吸附
+    pollCaptureAnalysis();
+    if (!snapEdges || m_edgeMap.isNull()) {
+        return pos;
+    }
+    const int maxDistance = m_selection.edgeSnapDistance();
+    int distance = INT_MAX;
+    const int x = m_edgeMap.snap(pos.x(), Qt::Horizontal, m_startPoint.y(), pos.y(), maxDistance, &distance);
+    const int y = m_edgeMap.snap(pos.y(), Qt::Vertical, m_startPoint.x(), pos.x(), maxDistance, &distance);
+    return QPoint(x, y);
+}
+
+void ScreenshotWindow::updateHoverWindow(const QPoint &pos)
+{
+    QRect hover;
+    // 只在还没开始拖动选择时高亮；按下后移动超过几个像素就当作拖动选择
+    const bool dragging = m_isSelecting && (pos - m_startPoint).manhattanLength() > 3;
+    if (!m_hasSelected && !dragging) {
+        pollCaptureAnalysis();
+        const QRect window = m_windowLookup.windowAt(pos + m_canvasOrigin);
+        if (window.isValid()) {
+            hover = window.translated(-m_canvasOrigin).intersected(canvasRect());
         }
     }
+    if (hover != m_hoverWindow) {
+        updateCanvas(hoverOutline(m_hoverWindow) + hoverOutline(hover));
+        m_hoverWindow = hover;
+    }
 }
 
 QRect ScreenshotWindow::selectedRect() const
 {
+    // 选区确定后由m_selection维护，拖动选择过程中由起止点决定
+    if (m_hasSelected) {
+        return m_selection.rect();
+    }
     QRect rect(m_startPoint, m_endPoint);
     return rect.normalized();
 }
 
 void ScreenshotWindow::paintEvent(QPaintEvent *event)
 {
-    Q_UNUSED(event);
-    
-    if (!m_isScreenshotMode || m_screenPixmap.isNull()) {
+    // 正常截图时由各屏幕的遮罩窗口绘制；基准测试和输入回放直接render()本窗口，画布坐标即窗口坐标
+    if (!m_isScreenshotMode || m_screenImage.isNull()) {
         return;
     }
     
+    TRACE_SCOPE("overlay.paint");
+    
     QPainter painter(this);
     
-    // 绘制截图
-    painter.drawPixmap(0, 0, m_screenPixmap);
+    // 绘制截图，只画与刷新区域相交的块
+    m_screenImage.draw(painter, event->rect(), m_canvasToCapture);
+    paintOverlay(painter, event->rect());
+}
+
+void ScreenshotWindow::paintOverlay(QPainter &painter, const QRect &dirty)
+{
+    // 实时选区模式下还没有截图，只绘制遮罩和选区
+    if (!m_isScreenshotMode || (m_screenImage.isNull() && !m_liveMode)) {
+        return;
+    }
     
     // 添加半透明遮罩，突出选择区域
     if (m_hasSelected) {
         QRect selectedRect = this->selectedRect();
         
-        // 创建整个屏幕的遮罩层
-        QRegion maskRegion(0, 0, width(), height());
-        // 从遮罩层中排除已选区域
-        QRegion selectedRegion(selectedRect);
-        // 最终的遮罩区域是整个屏幕减去选中区域
-        m_maskRegion = maskRegion.subtracted(selectedRegion);
-        
-        // 添加半透明遮罩效果
-        painter.setClipRegion(m_maskRegion);
-        painter.fillRect(0, 0, width(), height(), QColor(0, 0, 0, 128));
+        // 遮罩区域是整个画布减去选中区域
+        m_maskRegion = QRegion(canvasRect()).subtracted(QRegion(selectedRect));
         
-        // 清除裁剪区域以便后续绘制
-        painter.setClipRegion(QRegion(0, 0, width(), height()));
+        // 添加半透明遮罩效果，只填充本次刷新的部分
+        painter.save();
+        painter.setClipRegion(m_maskRegion.intersected(dirty));
+        painter.fillRect(dirty, QColor(0, 0, 0, 128));
+        painter.restore();
         
-        // 绘制四个角上的小方块，表示选择区域
-        int handleSize = 6;
-        QPen pen(Qt::white, 2);
-        painter.setPen(pen);
-        
-        // 左上角
-        QRect topLeft(selectedRect.left() - handleSize / 2, 
-                     selectedRect.top() - handleSize / 2, 
-                     handleSize, handleSize);
-        // 右上角
-        QRect topRight(selectedRect.right() - handleSize / 2, 
-                      selectedRect.top() - handleSize / 2, 
-                      handleSize, handleSize);
-        // 左下角
-        QRect bottomLeft(selectedRect.left() - handleSize / 2, 
-                        selectedRect.bottom() - handleSize / 2, 
-                        handleSize, handleSize);
-        // 右下角
-        QRect bottomRight(selectedRect.right() - handleSize / 2, 
-                         selectedRect.bottom() - handleSize / 2, 
-                         handleSize, handleSize);
-        
-        painter.fillRect(topLeft, Qt::white);
-        painter.fillRect(topRight, Qt::white);
-        painter.fillRect(bottomLeft, Qt::white);
-        painter.fillRect(bottomRight, Qt::white);
+        // 绘制8个控制点，选区太小时只画四个角
+        for (int i = SelectionTracker::HitTopLeft; i <= SelectionTracker::HitLeft; ++i) {
+            const auto hit = SelectionTracker::Hit(i);
+            if (m_selection.hasHandle(hit)) {
+                painter.fillRect(m_selection.handleRect(hit), Qt::white);
+            }
+        }
         
         // 绘制选择区域的边框
         painter.setPen(QPen(Qt::blue, 1, Qt::SolidLine));
         painter.drawRect(selectedRect);
         
-        // 绘制工具栏
-        if (m_toolBar) {
-            int toolBarX = selectedRect.left();
-            int toolBarY = selectedRect.bottom() + 10;
-            
-            if (toolBarY + m_toolBar->height() > height()) {
-                toolBarY = selectedRect.top() - m_toolBar->height() - 10;
-                if (toolBarY < 0) {
-                    toolBarY = 10;
-                }
-            }
-            
-            m_toolBar->move(toolBarX, toolBarY);
-            m_toolBar->show();
+        // 应用已经绘制的项目
+        AnnotationRenderer::render(painter, m_drawItems, m_screenImage, m_canvasToCapture);
+    } else if (m_isSelecting) {
+        // 拖动选择中的选区边框，可以跨越多个屏幕
+        painter.setPen(QPen(Qt::blue, 1, Qt::SolidLine));
+        painter.setBrush(Qt::NoBrush);
+        painter.drawRect(selectedRect());
+    }
+    
+    if (!m_hasSelected && !m_hoverWindow.isNull()) {
+        painter.setPen(QPen(QColor(0, 170, 255), 3));
+        painter.setBrush(Qt::NoBrush);
+        painter.drawRect(m_hoverWindow.adjusted(1, 1, -2, -2));
+    }
+    
+    // 放大镜最后绘制，只在本次刷新区域与它相交时才需要
+    const QRect loupeBounds = screenRectAt(m_cursorPos);
+    if (m_loupeVisible && !m_screenImage.isNull() && dirty.intersects(m_magnifier.rectFor(m_cursorPos, loupeBounds))) {
+        m_magnifier.paint(painter, m_screenImage, m_cursorPos, loupeBounds, selectedRect().size(), m_canvasToCapture);
+    }
+    
+    if (m_triggerPending) {
+        // 首帧绘制完成，记录触发到可交互的延迟
+        m_triggerPending = false;
+        m_firstFrameMs = m_triggerTimer.nsecsElapsed() / 1e6;
+        if (Trace::isEnabled()) {
+            Trace::endAsync("screenshot.triggerToFirstFrame", m_traceSessionId);
         }
+        qCDebug(lcOverlay) << "触发到首帧:" << m_firstFrameMs << "ms"
+                           << "截图:" << m_captureMs << "ms 显示:" << m_showMs << "ms";
         
-        // 应用已经绘制的项目
-        drawOnPainter(painter);
+        // 边缘图等首帧画完再开始，不和首帧争抢CPU
+        QTimer::singleShot(0, this, &ScreenshotWindow::startEdgeMap);
     }
 }
 
@@ -942,10 +1756,8 @@ void ScreenshotWindow::mousePressEvent(QMouseEvent *event)
     // 如果不是截图模式，直接返回
     if (!m_isScreenshotMode) return;
 
-    qDebug() << "鼠标按下，位置:" << event->pos()
-             << "m_hasSelected:" << m_hasSelected
-             << "m_currentMode:" << static_cast<int>(m_currentMode)
-             << "m_isSelecting:" << m_isSelecting;
+    // 每个事件都会经过这里，只写入环形日志，不做字符串格式化
+    RingLog::record("overlay.mousePress", event->pos().x(), event->pos().y());
 
     if (event->button() == Qt::LeftButton) {
         // 只在未选择区域时允许进入截图选择流程
@@ -954,15 +1766,23 @@ void ScreenshotWindow::mousePressEvent(QMouseEvent *event)
             m_startPoint = event->pos();
             m_endPoint = event->pos();
             m_isSelecting = true;
-            m_rubberBand->setGeometry(QRect(m_startPoint, QSize()));
-            m_rubberBand->show();
-            qDebug() << "开始选择区域";
+            qCDebug(lcOverlay) << "开始选择区域";
         } else {
+            // 控制点和边框可以调整选区；没有选择绘图工具时在选区内拖动可以移动选区
+            const SelectionTracker::Hit hit = m_selection.hitTest(event->pos());
+            if (hit != SelectionTracker::HitNothing &&
+                (m_currentMode == DrawMode::None || hit != SelectionTracker::HitMiddle)) {
+                m_selection.beginDrag(hit, event->pos());
+                m_toolBar->hide();
+                event->accept();
+                return;
+            }
+            
             // 已经有选区，只允许绘制，不允许重新选择截图区域
             if (m_maskRegion.contains(event->pos())) {
                 // 点击在遮罩区域内（即选区外），忽略这次点击事件
                 m_isSelecting = false;
-                qDebug() << "点击在遮罩区域内(选区外)，忽略此次点击";
+                qCDebug(lcOverlay) << "点击在遮罩区域内(选区外)，忽略此次点击";
                 event->accept();
                 return;
             } else {
@@ -970,7 +1790,7 @@ void ScreenshotWindow::mousePressEvent(QMouseEvent *event)
                 m_startPoint = event->pos();
                 m_endPoint = event->pos();
                 m_isSelecting = true;
-                qDebug() << "在已选区域内开始绘制，当前模式:" << static_cast<int>(m_currentMode);
+                qCDebug(lcOverlay) << "在已选区域内开始绘制，当前模式:" << static_cast<int>(m_currentMode);
                 // 处理不同的绘图模式
                 switch (m_currentMode) {
                     case DrawMode::Rectangle:
@@ -998,12 +1818,37 @@ void ScreenshotWindow::mouseMoveEvent(QMouseEvent *event)
 {
     if (!m_isScreenshotMode) return;
     
+    RingLog::record("overlay.mouseMove", event->pos().x(), event->pos().y());
+    
+    updateLoupe(event->pos());
+    updateHoverWindow(event->pos());
+    
+    // 调整选区时只重绘变化的部分，按住Alt暂时关闭吸附
+    if (m_selection.isDragging()) {
+        pollCaptureAnalysis();
+        updateCanvas(m_selection.dragTo(event->pos(), !(event->modifiers() & Qt::AltModifier)));
+        return;
+    }
+    
+    if (m_hasSelected && !(event->buttons() & Qt::LeftButton)) {
+        SelectionTracker::Hit hit = m_selection.hitTest(event->pos());
+        if (m_currentMode != DrawMode::None && hit == SelectionTracker::HitMiddle) {
+            hit = SelectionTracker::HitNothing;
+        }
+        const Qt::CursorShape shape = SelectionTracker::cursorForHit(hit);
+        if (m_cursorShape != shape) {
+            setOverlayCursor(shape);
+        }
+    }
+    
     if (m_isSelecting && (event->buttons() & Qt::LeftButton)) {
-        m_endPoint = event->pos();
+        const QRect before = selectedRect();
+        m_endPoint = m_hasSelected ? event->pos()
+                                   : snapSelectionEnd(event->pos(), !(event->modifiers() & Qt::AltModifier));
         
         if (!m_hasSelected) {
-            // 更新选择区域（仅在初次选择时）
-            m_rubberBand->setGeometry(QRect(m_startPoint, m_endPoint).normalized());
+            // 更新选择区域（仅在初次选择时），只刷新新旧两个边框
+            updateCanvas(selectionOutline(before) + selectionOutline(selectedRect()));
         } else {
             // 已经有选择区域，现在是在绘制
             if (m_currentMode != DrawMode::None) {
@@ -1013,12 +1858,12 @@ void ScreenshotWindow::mouseMoveEvent(QMouseEvent *event)
                     case DrawMode::Circle:
                     case DrawMode::Arrow:
                         // 记录终点并更新显示
-                        update();
+                        updateCanvas();
                         break;
                     case DrawMode::Brush:
                         // 添加到当前画笔路径并更新显示
                         m_currentBrushPoints.append(event->pos());
-                        update();
+                        updateCanvas();
                         break;
                     default:
                         break;
@@ -1032,17 +1877,28 @@ void ScreenshotWindow::mouseReleaseEvent(QMouseEvent *event)
 {
     if (!m_isScreenshotMode) return;
     
-    qDebug() << "鼠标释放，位置:" << event->pos() 
-             << "m_hasSelected:" << m_hasSelected 
-             << "m_isSelecting:" << m_isSelecting;
+    RingLog::record("overlay.mouseRelease", event->pos().x(), event->pos().y());
+    
+    if (m_selection.isDragging()) {
+        m_selection.endDrag();
+        positionToolBar();
+        qCDebug(lcOverlay) << "调整选区完成:" << m_selection.rect();
+        return;
+    }
     
     if (event->button() == Qt::LeftButton && m_isSelecting) {
-        m_endPoint = event->pos();
+        m_endPoint = m_hasSelected ? event->pos()
+                                   : snapSelectionEnd(event->pos(), !(event->modifiers() & Qt::AltModifier));
         m_isSelecting = false;
         
         if (!m_hasSelected) {
-            // 完成初次选择区域
-            m_hasSelected = true;
+            // 没有拖动的单击：选择光标下高亮的窗口
+            if ((m_endPoint - m_startPoint).manhattanLength() <= 3 && !m_hoverWindow.isNull()) {
+                m_startPoint = m_hoverWindow.topLeft();
+                m_endPoint = m_hoverWindow.bottomRight();
+                qCDebug(lcOverlay) << "单击选择窗口:" << m_hoverWindow;
+            }
+            m_hoverWindow = QRect();
             
             // 确保选择的区域有合理大小
             QRect rect = selectedRect();
@@ -1051,8 +1907,27 @@ void ScreenshotWindow::mouseReleaseEvent(QMouseEvent *event)
                 m_endPoint = m_startPoint + QPoint(100, 100);
             }
             
-            m_rubberBand->hide();
-            qDebug() << "完成选择区域:" << selectedRect();
+            // 完成初次选择区域，之后由m_selection负责调整
+            // 各屏幕的边缘作为吸附目标，多屏时选区可以对齐到单个屏幕
+            QVector<int> snapX, snapY;
+            for (QScreen *screen : QGuiApplication::screens()) {
+                const QRect screenRect = screen->geometry().translated(-m_canvasOrigin);
+                snapX << screenRect.left() << screenRect.right();
+                snapY << screenRect.top() << screenRect.bottom();
+            }
+            pollCaptureAnalysis();
+            for (const QRect &window : m_windowLookup.windows()) {
+                const QRect windowRect = window.translated(-m_canvasOrigin);
+                snapX << windowRect.left() << windowRect.right();
+                snapY << windowRect.top() << windowRect.bottom();
+            }
+            m_selection.setSnapTargets(snapX, snapY);
+            m_selection.setBounds(canvasRect());
+            m_selection.setRect(selectedRect());
+            m_hasSelected = true;
+            
+            positionToolBar();
+            qCDebug(lcOverlay) << "完成选择区域:" << selectedRect();
         } else if (m_currentMode != DrawMode::None) {
             // 已选择区域 + 处于绘图模式：完成绘制
             QRect selectedArea = selectedRect();
@@ -1064,7 +1939,7 @@ void ScreenshotWindow::mouseReleaseEvent(QMouseEvent *event)
                 DrawItem item;
                 item.color = Qt::red; // 默认颜色
                 
-                qDebug() << "完成绘制，当前模式:" << static_cast<int>(m_currentMode);
+                qCDebug(lcOverlay) << "完成绘制，当前模式:" << static_cast<int>(m_currentMode);
                 
                 switch (m_currentMode) {
                     case DrawMode::Rectangle:
@@ -1096,7 +1971,7 @@ void ScreenshotWindow::mouseReleaseEvent(QMouseEvent *event)
                         break;
                 }
             } else {
-                qDebug() << "起始点在遮罩区域内，忽略绘制操作";
+                qCDebug(lcOverlay) << "起始点在遮罩区域内，忽略绘制操作";
                 // 也要清空轨迹，防止残留
                 if (m_currentMode == DrawMode::Brush) {
                     m_currentBrushPoints.clear();
@@ -1104,7 +1979,7 @@ void ScreenshotWindow::mouseReleaseEvent(QMouseEvent *event)
             }
         }
         
-        update();
+        updateCanvas();
     }
 }
 
@@ -1131,6 +2006,16 @@ void ScreenshotWindow::keyPressEvent(QKeyEvent *event)
     } else if (event->key() == Qt::Key_Z && event->modifiers() == Qt::ControlModifier) {
         // Ctrl+Z撤销
         undo();
+    } else if (m_hasSelected && !m_selection.isDragging()) {
+        // 方向键微调选区，Shift加大步长，Ctrl调整大小
+        QRegion dirty = m_selection.nudge(event->key(), event->modifiers());
+        if (!dirty.isEmpty()) {
+            if (m_loupeVisible) {
+                dirty += m_magnifier.rectFor(m_cursorPos, screenRectAt(m_cursorPos)); // 放大镜里的选区大小也变了
+            }
+            updateCanvas(dirty);
+            positionToolBar();
+        }
     }
 }
 
@@ -1147,22 +2032,22 @@ void ScreenshotWindow::closeEvent(QCloseEvent *event)
 
 void ScreenshotWindow::quitApplication()
 {
-    qDebug() << "退出应用程序";
+    qCDebug(lcApp) << "退出应用程序";
     
     // 安全退出，先隐藏所有UI元素
     if (m_trayIcon) {
         m_trayIcon->hide();
     }
     
-    hide();
+    hideOverlays();
     
     // 确保不会立即退出（尤其是在Wayland环境中）
     bool isWayland = QGuiApplication::platformName().contains("wayland", Qt::CaseInsensitive);
     if (isWayland) {
-        qDebug() << "Wayland环境下安全退出";
+        qCDebug(lcApp) << "Wayland环境下安全退出";
         // 使用异步延迟退出，让其他操作有机会完成
         QTimer::singleShot(500, []() {
-            qDebug() << "执行实际的退出操作";
+            qCDebug(lcApp) << "执行实际的退出操作";
             QCoreApplication::quit();
         });
     } else {
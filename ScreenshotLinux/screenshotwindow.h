@@ -2,13 +2,12 @@
 #define SCREENSHOTWINDOW_H
 
 #include <QWidget>
-#include <QPixmap>
+#include <QImage>
 #include <QPoint>
 #include <QRect>
 #include <QPainter>
 #include <QPen>
 #include <QColor>
-#include <QRubberBand>
 #include <QToolBar>
 #include <QAction>
 #include <QSystemTrayIcon> // 添加系统托盘支持
@@ -16,10 +15,36 @@
 #include <QVector> // 用于存储画笔路径点
 #include <QPainterPath> // 用于画笔路径
 #include <QRegion> // 用于创建遮罩区域
+#include <QElapsedTimer> // 用于统计截图延迟
+#include <QTransform>
+#include "annotation.h"
+#include "selectiontracker.h"
+#include "magnifier.h"
+#include "windowtree.h"
+#include "edgemap.h"
+#include "tiledimage.h"
+#include "processstats.h"
+#include "recentregions.h"
+#include "screenrecorder.h"
+#include "scrollsession.h"
+#include "historystore.h"
+#include "imageencoder.h"
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+class QTimer;
+
+class InputRecorder;
+class OverlayWindow;
 
 class ScreenshotWindow : public QWidget
 {
     Q_OBJECT
+    friend class ScreenshotBench; // 基准测试直接构造截图状态
+    friend class ScreenshotReplay; // 回放工具直接构造截图状态并注入输入事件
+    friend class OverlayWindow;    // 各屏幕的遮罩窗口调用paintOverlay()
     
 public:
     ScreenshotWindow(QWidget *parent = nullptr);
@@ -27,6 +52,12 @@ public:
     
     void setupTrayIcon(); // 设置系统托盘图标
     void startScreenshot(); // 开始截图过程
+    void startLiveScreenshot(); // 实时选区模式：在不冻结的桌面上选择区域，确定后只截取选区
+    void prewarmOverlay(); // 空闲时预先创建遮罩窗口、后备存储和工具栏
+    void enterIdleMode(); // 释放截图、遮罩窗口的后备存储和缓存，重建隐藏的遮罩窗口，直到下一次截图
+    QString executeCommand(const QString &command); // 处理本地套接字转发的命令，返回一行回复
+    void setTraceOutput(const QString &filePath); // 打开追踪，每次截图会话结束后写出Chrome Trace JSON
+    void setInputRecordingPath(const QString &filePath); // 录制每次截图会话的输入事件，新会话覆盖旧文件
     
 protected:
     void paintEvent(QPaintEvent *event) override;
@@ -40,6 +71,7 @@ private slots:
     void saveScreenshot();
     void cancelScreenshot();
     void finishScreenshot();
+    void startScrollCapture(); // 工具栏“长截图”：结束本次截图，对选区开始长截图
     void drawRectangle();
     void drawCircle();
     void drawArrow();
@@ -51,42 +83,83 @@ private slots:
     void quitApplication(); // 退出应用程序
     
 private:
-    enum class DrawMode {
-        None,
-        Rectangle,
-        Circle,
-        Arrow,
-        Text,
-        Brush,
-        Mosaic
-    };
-    
-    struct DrawItem {
-        DrawMode mode;
-        QRect rect;
-        QPoint start;
-        QPoint end;
-        QString text;
-        QColor color;
-        QVector<QPoint> brushPoints; // 存储画笔路径上的点
-    };
-    
     void grabScreen();
-    void drawOnPainter(QPainter &painter);
+    QImage composeSelection() const; // 合成选区截图与绘制内容
     QRect selectedRect() const;
+    void markTrigger(); // 记录触发时间点，用于统计触发到首帧的延迟
+    void positionToolBar(); // 根据选区位置摆放工具栏
+    QString defaultSavePath() const; // 图片目录下带时间戳的默认文件名
+    QString captureRegionToFile(const QRect &region, const QString &filePath); // 无遮罩直接截取区域，后台截图和编码
+    QString repeatRecentRegion(int index, const QString &filePath, bool notify); // 无遮罩重复截取最近的选区，后台编码
+    void finishRepeatWrite(const QString &filePath, bool written, double totalMs, bool notify); // 后台写文件完成，在主线程调用
+    // 在后台线程上写文件、记入历史，完成后在主线程调用finishRepeatWrite()
+    void writeCapture(const QImage &image, const QString &filePath, ImageEncoder::Profile profile,
+                      const QElapsedTimer &timer, bool notify, bool history);
+    void rememberSelection(); // 导出时记录选区和屏幕布局
+    void updateRecentRegionsMenu(); // 按当前屏幕布局重建托盘的最近选区菜单
+    void recordHistory(const QImage &image); // 导出的截图在后台线程存入历史
+    void updateHistoryMenu(); // 从历史索引和缩略图图集重建托盘的最近截图菜单，不解码原图
+    void reapPendingWrites(); // 回收已完成的后台写文件任务
+    QString startRecording(const QRect &region, const QString &filePath, int fps); // 开始录制区域，编码在后台线程
+    QString stopRecording(); // 停止录制，等剩余的帧写完，回复中带丢帧数
+    QString startScrollSession(const QRect &region, const QString &filePath, bool notify); // 开始长截图，filePath为空时结果放到剪贴板
+    QString stopScrollSession(); // 结束长截图并导出已拼好的部分
+    QString finishScrollSession(const QImage &image, const QString &filePath, const QString &error, bool notify); // 导出长图，返回命令回复
+    void beginInputRecording(); // 遮罩显示后开始录制本次会话的输入事件
+    void updateLoupe(const QPoint &pos); // 移动放大镜，只刷新新旧两个位置
+    void updateHoverWindow(const QPoint &pos); // 未选择区域时高亮光标下的窗口
+    void pollCaptureAnalysis(); // 后台的窗口树、边缘图完成时取回结果，不等待
+    QPoint snapSelectionEnd(const QPoint &pos, bool snapEdges); // 初次框选时终点所在的两条边吸附到图像边缘
+    void startEdgeMap(); // 首帧绘制后在后台构建边缘图
+    void scheduleIdle(); // 截图会话结束后重新开始空闲计时
+    QString idleStats() const; // "stats" 命令的回复
     
-    QPixmap m_screenPixmap;        // 全屏截图
+    // 每个屏幕一个遮罩窗口，本窗口只保存状态、处理转发来的事件，不再显示
+    void rebuildOverlays(); // 按当前屏幕创建遮罩窗口，屏幕增减时重建
+    void releaseOverlays(); // 删除所有遮罩窗口及其后备存储
+    void captureLiveSelection(const std::function<void()> &then); // 实时选区模式下隐藏遮罩、截取选区后再继续导出
+    void showOverlays();
+    void hideOverlays();
+    void mapCaptureToDesktop(); // 截图尺寸与虚拟桌面不一致时（按设备像素截图）记录画布坐标到截图像素的比例
+    OverlayWindow *overlayAt(const QPoint &canvasPos) const;
+    QRect canvasRect() const;                      // 整个画布，即截图范围
+    QRect screenRectAt(const QPoint &canvasPos) const; // 点所在屏幕在画布中的范围
+    void updateCanvas(const QRegion &region);      // 画布坐标的区域分发给对应的遮罩窗口
+    void updateCanvas();
+    void setOverlayCursor(Qt::CursorShape shape);
+    void paintOverlay(QPainter &painter, const QRect &dirty); // 在截图之上绘制选区、标注和放大镜，画布坐标
+    
+    TiledImage m_screenImage;      // 全屏截图，分块保存，遮罩、合成、马赛克和放大镜按块读取；保持后端截到的设备像素
+    QTransform m_canvasToCapture;  // 画布坐标到m_screenImage像素的缩放，按逻辑像素截图时为恒等变换
+    QList<OverlayWindow*> m_overlays; // 每个屏幕一个遮罩窗口
+    bool m_liveMode;               // 本次会话是否为实时选区模式（遮罩透明，确定选区后才截图）
+    bool m_liveRequested;          // 下一次截图使用实时选区模式
+    bool m_liveByDefault;          // 配置 capture/liveSelection：默认使用实时选区模式
+    QPoint m_canvasOrigin;         // 画布原点对应的虚拟桌面坐标
+    Qt::CursorShape m_cursorShape; // 遮罩窗口当前的光标形状
     QPoint m_startPoint;           // 选择区域的起始点
     QPoint m_endPoint;             // 选择区域的结束点
     bool m_isSelecting;            // 是否正在选择区域
     bool m_hasSelected;            // 是否已经选择了区域
     bool m_isScreenshotMode;       // 是否处于截图模式
+    SelectionTracker m_selection;  // 已确定的选区，可拖动控制点或用方向键调整
+    Magnifier m_magnifier;         // 光标处的放大镜和颜色信息
+    QPoint m_cursorPos;            // 放大镜当前对应的光标位置
+    bool m_loupeVisible;           // 放大镜是否显示，绘图模式下隐藏
+    
+    // 与截图同时获取的窗口树，用于悬停高亮和单击选择窗口
+    std::future<WindowLookup> m_windowTreeFuture;
+    WindowLookup m_windowLookup;
+    QRect m_hoverWindow;           // 光标下的窗口（画布坐标），无效表示没有
+    
+    // 截图的边缘图，拖动选区边时吸附到界面元素边界
+    std::future<EdgeMap> m_edgeMapFuture;
+    EdgeMap m_edgeMap;
     
     DrawMode m_currentMode;        // 当前绘制模式
     QList<DrawItem> m_drawItems;   // 已绘制的图形项目
     QList<DrawItem> m_undoItems;   // 已撤销的图形项目
     
-    QRubberBand *m_rubberBand;     // 橡皮筋选择框
     QToolBar *m_toolBar;           // 工具栏
     
     // 当前正在绘制的画笔路径点
@@ -99,6 +172,7 @@ private:
     QAction *m_textAction;
     QAction *m_brushAction;
     QAction *m_mosaicAction;
+    QAction *m_scrollAction;
     QAction *m_undoAction;
     QAction *m_saveAction;
     QAction *m_cancelAction;
@@ -108,10 +182,48 @@ private:
     QSystemTrayIcon *m_trayIcon;   // 系统托盘图标
     QMenu *m_trayIconMenu;         // 托盘菜单
     QAction *m_screenshotAction;   // 截图动作
+    QAction *m_liveScreenshotAction; // 实时选区截图动作
+    QMenu *m_recentRegionsMenu;    // 重复截取最近选区的子菜单
+    QAction *m_recordAction;       // 录制最近选区 / 停止录制
+    QMenu *m_historyMenu;          // 最近截图的子菜单
     QAction *m_aboutAction;        // 关于动作
     QAction *m_quitAction;         // 退出动作
 
     QRegion m_maskRegion;          // 遮罩区域，用于防止区域外点击
+    QString m_lastResult;          // 最近一次截图结果：文件路径或 "clipboard"
+    
+    // 最近的选区；重复截取时在后台线程编码写文件，完成后回到主线程回收
+    RecentRegions m_recentRegions;
+    std::vector<std::future<void>> m_pendingWrites;
+    std::unique_ptr<ScreenRecorder> m_recorder; // 正在进行的录制
+    std::unique_ptr<ScreenRecorder> m_stoppingRecorder; // 已停止截图、还在后台编码和写出的录制
+    std::unique_ptr<ScrollSession> m_scrollSession; // 正在进行的长截图
+    
+    // 截图历史，配置 history/enabled 关闭；第一次使用时才打开，空闲模式下解除映射
+    HistoryStore m_history;
+    bool m_historyEnabled;
+    QString m_scrollReply;         // 最近一次长截图结束时的回复
+    
+    // 触发到首帧的延迟统计
+    QElapsedTimer m_triggerTimer;  // 从触发截图开始计时
+    bool m_triggerPending;         // 是否还在等待首帧绘制
+    double m_captureMs;            // 触发到截图完成
+    double m_showMs;               // 触发到窗口显示
+    double m_firstFrameMs;         // 触发到首帧绘制完成
+    double m_repeatMs;             // 重复截取最近选区：触发到文件写完
+    
+    // 空闲模式：最后一次截图后安静一段时间就释放缓冲区；
+    // 计时器是单次的，空闲期间进程不设置任何定时唤醒
+    QTimer *m_idleTimer;
+    bool m_idle;                   // 是否处于空闲模式
+    QElapsedTimer m_idleSince;     // 进入空闲模式的时间
+    ProcessStats::Snapshot m_idleSnapshot; // 进入空闲模式时的占用，用于计算空闲期间的唤醒次数
+    
+    quint64 m_traceSessionId;      // 追踪中异步区间的会话编号
+    QString m_traceOutput;         // --trace 指定的输出文件
+    
+    InputRecorder *m_inputRecorder; // --record-input 打开时录制输入事件
+    QString m_inputRecordingPath;
     
     void safeTrayIconActivated(QSystemTrayIcon::ActivationReason reason);
 };
@@ -0,0 +1,67 @@
+#include "scrollcapture.h"
+#include "commandline.h"
+#include "headlesscapture.h"
+#include "imageencoder.h"
+#include "scrollinput.h"
+#include "scrollsession.h"
+#include <QGuiApplication>
+#include <QSaveFile>
+#include <cstdio>
+
+namespace ScrollCapture {
+
+int run(int argc, char *argv[], const CommandLineOptions &options, const QElapsedTimer &startupTimer)
+{
+    // 自动滚动使用自己的XCB连接，不依赖Qt的平台插件，可以使用offscreen
+    HeadlessCapture::preparePlatform(argc, argv);
+
+    QGuiApplication app(argc, argv);
+    HeadlessCapture::checkOffscreenCapture(options.region);
+    const double startupMs = HeadlessCapture::elapsedMs(startupTimer);
+
+    ScrollSession::Options sessionOptions;
+    sessionOptions.region = options.region;
+    sessionOptions.autoScroll = ScrollInput::isAvailable();
+    if (!sessionOptions.autoScroll) {
+        // 用户自己滚动，停下来的时间留长一些
+        sessionOptions.idleMs = 5000;
+        std::fprintf(stderr, "无法自动滚动，请在区域内滚动要截取的内容，停止滚动5秒后结束\n");
+    }
+    ScrollSession session(sessionOptions);
+
+    QImage result;
+    QString error;
+    const bool started = session.start([&](const QImage &image, const QString &message) {
+        result = image;
+        error = message;
+        QMetaObject::invokeMethod(&app, &QGuiApplication::quit, Qt::QueuedConnection);
+    }, &error);
+    if (!started) {
+        std::fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    app.exec();
+
+    const ScrollSession::Stats stats = session.stats();
+    std::fprintf(stderr, "scrolled: frames=%d appended=%d unmatched=%d height=%d duration=%.2fs\n",
+                 stats.frames, stats.appended, stats.unmatched, stats.height, stats.seconds);
+    if (options.timings) {
+        std::fprintf(stderr, "timings: startup=%.2fms stitch_avg=%.3fms stitch_max=%.3fms auto_scroll=%d\n",
+                     startupMs, stats.frames > 0 ? stats.stitchMs / stats.frames : 0.0, stats.maxStitchMs,
+                     int(sessionOptions.autoScroll));
+    }
+    if (!error.isEmpty()) {
+        std::fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+
+    QSaveFile out(options.output);
+    const ImageEncoder::Profile profile = HeadlessCapture::outputProfile(options.format, options.output);
+    if (!out.open(QIODevice::WriteOnly) || !ImageEncoder::encode(result, &out, profile) || !out.commit()) {
+        std::fprintf(stderr, "无法写入截图: %s\n", qPrintable(options.output));
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace ScrollCapture
@@ -0,0 +1,15 @@
+#ifndef SCROLLCAPTURE_H
+#define SCROLLCAPTURE_H
+
+#include <QElapsedTimer>
+
+struct CommandLineOptions;
+
+// 命令行长截图：截取区域并在滚动时拼接，内容停止变化后写出长图并退出（见ScrollSession）
+namespace ScrollCapture {
+
+int run(int argc, char *argv[], const CommandLineOptions &options, const QElapsedTimer &startupTimer);
+
+} // namespace ScrollCapture
+
+#endif // SCROLLCAPTURE_H
@@ -0,0 +1,91 @@
+#include "scrollinput.h"
+#include "screencapture.h"
+#include <cstdlib>
+
+#ifdef SCREENSHOT_HAVE_XCB_XTEST
+#include <xcb/xcb.h>
+#include <xcb/xtest.h>
+#endif
+
+namespace ScrollInput {
+
+#ifdef SCREENSHOT_HAVE_XCB_XTEST
+namespace {
+
+// X11中滚轮是4（向上）、5（向下）号按钮
+constexpr quint8 kWheelUp = 4;
+constexpr quint8 kWheelDown = 5;
+
+xcb_connection_t *connectWithXTest(xcb_window_t *root)
+{
+    if (ScreenCapture::sessionIsWayland()) {
+        return nullptr;
+    }
+    int screenNumber = 0;
+    xcb_connection_t *connection = xcb_connect(nullptr, &screenNumber);
+    if (xcb_connection_has_error(connection)) {
+        xcb_disconnect(connection);
+        return nullptr;
+    }
+    xcb_test_get_version_reply_t *version =
+        xcb_test_get_version_reply(connection, xcb_test_get_version(connection, 2, 2), nullptr);
+    if (!version) {
+        xcb_disconnect(connection);
+        return nullptr;
+    }
+    std::free(version);
+
+    xcb_screen_iterator_t screens = xcb_setup_roots_iterator(xcb_get_setup(connection));
+    for (int i = 0; i < screenNumber && screens.rem > 0; ++i) {
+        xcb_screen_next(&screens);
+    }
+    *root = screens.data->root;
+    return connection;
+}
+
+} // namespace
+#endif
+
+bool isAvailable()
+{
+#ifdef SCREENSHOT_HAVE_XCB_XTEST
+    xcb_window_t root = 0;
+    xcb_connection_t *connection = connectWithXTest(&root);
+    if (!connection) {
+        return false;
+    }
+    xcb_disconnect(connection);
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool scroll(const QPoint &point, int clicks)
+{
+#ifdef SCREENSHOT_HAVE_XCB_XTEST
+    xcb_window_t root = 0;
+    xcb_connection_t *connection = connectWithXTest(&root);
+    if (!connection) {
+        return false;
+    }
+    // 所有事件一次发出，最后一次往返确认服务器已经处理完
+    xcb_test_fake_input(connection, XCB_MOTION_NOTIFY, 0, XCB_CURRENT_TIME, root,
+                        qint16(point.x()), qint16(point.y()), 0);
+    const quint8 button = clicks > 0 ? kWheelDown : kWheelUp;
+    for (int i = 0; i < qAbs(clicks); ++i) {
+        xcb_test_fake_input(connection, XCB_BUTTON_PRESS, button, XCB_CURRENT_TIME, root, 0, 0, 0);
+        xcb_test_fake_input(connection, XCB_BUTTON_RELEASE, button, XCB_CURRENT_TIME, root, 0, 0, 0);
+    }
+    std::free(xcb_get_input_focus_reply(connection, xcb_get_input_focus(connection), nullptr));
+    const bool ok = !xcb_connection_has_error(connection);
+    xcb_disconnect(connection);
+    return ok;
+#else
+    Q_UNUSED(point);
+    Q_UNUSED(clicks);
+    return false;
+#endif
+}
+
+} // namespace ScrollInput
@@ -0,0 +1,19 @@
+#ifndef SCROLLINPUT_H
+#define SCROLLINPUT_H
+
+#include <QPoint>
+
+// 长截图自动滚动：通过XTest扩展向X服务器注入滚轮事件，事件送到点所在的窗口
+// 使用独立的XCB连接；没有xcb-xtest、Wayland会话或服务器不支持XTest时不可用，
+// 此时长截图由用户自己滚动
+namespace ScrollInput {
+
+// 可在QGuiApplication创建之前调用
+bool isAvailable();
+
+// 把指针移到point（虚拟桌面坐标）后滚动clicks格，正数向下、负数向上
+bool scroll(const QPoint &point, int clicks);
+
+} // namespace ScrollInput
+
+#endif // SCROLLINPUT_H
@@ -0,0 +1,143 @@
+#include "scrollsession.h"
+#include "screencapture.h"
+#include "scrollinput.h"
+#include "trace.h"
+
+namespace {
+
+// 连续截图失败或连续没有重合的帧数达到上限就结束
+const int kMaxFailedGrabs = 3;
+const int kMaxUnmatchedFrames = 10;
+
+} // namespace
+
+ScrollSession::ScrollSession(const Options &options)
+    : m_options(options)
+{
+    m_options.intervalMs = qMax(10, m_options.intervalMs);
+    m_options.scrollClicks = qMax(1, m_options.scrollClicks);
+    m_timer.setInterval(m_options.intervalMs);
+    QObject::connect(&m_timer, &QTimer::timeout, &m_timer, [this]() { tick(); });
+}
+
+bool ScrollSession::start(const Finished &finished, QString *error)
+{
+    if (m_running) {
+        return true;
+    }
+    if (!m_options.region.isValid()) {
+        if (error) {
+            *error = QStringLiteral("长截图需要一个有效的区域");
+        }
+        return false;
+    }
+    m_finished = finished;
+    m_running = true;
+    m_clicks = m_options.scrollClicks;
+    m_failedGrabs = 0;
+    m_unmatchedInRow = 0;
+    m_stitcher.reset();
+    m_stats = Stats();
+    m_clock.start();
+    m_lastChangeMs = 0;
+    m_timer.start();
+    tick();
+    return true;
+}
+
+void ScrollSession::stop()
+{
+    if (m_running) {
+        finish(QString());
+    }
+}
+
+void ScrollSession::tick()
+{
+    if (!m_running) {
+        return;
+    }
+    const QImage frame = ScreenCapture::grabRegion(m_options.region);
+    if (frame.isNull()) {
+        if (++m_failedGrabs >= kMaxFailedGrabs) {
+            finish(QStringLiteral("截图失败"));
+        }
+        return;
+    }
+    m_failedGrabs = 0;
+    ++m_stats.frames;
+
+    QElapsedTimer stitchTimer;
+    stitchTimer.start();
+    ScrollStitcher::Result result;
+    {
+        TRACE_SCOPE("scroll.stitch");
+        result = m_stitcher.add(frame);
+    }
+    const double stitchMs = stitchTimer.nsecsElapsed() / 1e6;
+    m_stats.stitchMs += stitchMs;
+    m_stats.maxStitchMs = qMax(m_stats.maxStitchMs, stitchMs);
+    m_stats.height = m_stitcher.height();
+
+    const qint64 now = m_clock.elapsed();
+    const QPoint center = m_options.region.center();
+    switch (result) {
+    case ScrollStitcher::Result::Appended:
+        ++m_stats.appended;
+        m_lastChangeMs = now;
+        m_unmatchedInRow = 0;
+        break;
+    case ScrollStitcher::Result::Unchanged:
+        break;
+    case ScrollStitcher::Result::NoOverlap:
+        ++m_stats.unmatched;
+        // 一次滚得比一帧还多：滚回去，之后每次少滚一些；下一帧仍与上一次追加的帧对齐
+        if (m_options.autoScroll) {
+            ScrollInput::scroll(center, -m_clicks);
+            m_clicks = qMax(1, m_clicks / 2);
+        }
+        if (++m_unmatchedInRow >= kMaxUnmatchedFrames) {
+            finish(QString());
+            return;
+        }
+        return;
+    case ScrollStitcher::Result::SizeChanged:
+        // 缩放比例变化后的帧无法与之前的对齐，保留已经拼好的部分
+        finish(QString());
+        return;
+    }
+
+    if (m_stitcher.height() >= m_options.maxHeight ||
+        (m_options.idleMs > 0 && now - m_lastChangeMs >= m_options.idleMs)) {
+        finish(QString());
+        return;
+    }
+    // 没有变化时也继续发送：平滑滚动可能还没开始，滚到底后多发几次也没有影响
+    if (m_options.autoScroll && !ScrollInput::scroll(center, m_clicks)) {
+        m_options.autoScroll = false;
+    }
+}
+
+void ScrollSession::finish(const QString &error)
+{
+    m_timer.stop();
+    m_running = false;
+    m_stats.seconds = m_clock.nsecsElapsed() / 1e9;
+    m_stats.height = m_stitcher.height();
+
+    QImage image;
+    QString message = error;
+    if (message.isEmpty()) {
+        image = m_stitcher.result();
+        if (image.isNull()) {
+            message = QStringLiteral("没有截取到内容");
+        }
+    }
+    m_stitcher.reset();
+    // 回调可能结束整个程序，放在最后
+    const Finished finished = m_finished;
+    m_finished = nullptr;
+    if (finished) {
+        finished(image, message);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef SCROLLSESSION_H
+#define SCROLLSESSION_H
+
+#include <QElapsedTimer>
+#include <QImage>
+#include <QRect>
+#include <QString>
+#include <QTimer>
+#include <functional>
+#include "scrollstitcher.h"
+
+// 长截图会话：在调用start()的线程上按固定间隔截取区域，每帧交给ScrollStitcher拼接
+// 自动滚动时（X11且有XTest，见ScrollInput）每截一帧向区域中心发送滚轮事件，
+// 滚动过头没有重合时滚回去并减小步长；否则由用户自己滚动
+// 拼接只做行哈希和追加新露出的行，比截图本身快得多，在截图的线程上完成即可跟上截图速度
+// 内容一段时间没有变化（滚到底或用户停下）、达到最大高度或调用stop()时结束
+class ScrollSession
+{
+public:
+    struct Options {
+        QRect region;          // 虚拟桌面逻辑坐标
+        bool autoScroll = false;
+        int intervalMs = 80;   // 截图间隔
+        int scrollClicks = 3;  // 每帧滚动的滚轮格数，没有重合时减半
+        int maxHeight = 30000; // 拼接高度上限（像素）
+        int idleMs = 1500;     // 内容连续这么久没有新的行就结束，0表示只由stop()结束
+    };
+
+    struct Stats {
+        int frames = 0;        // 截取的帧
+        int appended = 0;      // 追加了新内容的帧
+        int unmatched = 0;     // 没有重合而被忽略的帧
+        int height = 0;        // 已拼接的高度
+        double seconds = 0;
+        double stitchMs = 0;   // 拼接总耗时（不含截图）
+        double maxStitchMs = 0;
+    };
+
+    // 结束时调用一次；error非空表示失败，否则image是拼好的长图
+    using Finished = std::function<void(const QImage &image, const QString &error)>;
+
+    explicit ScrollSession(const Options &options);
+
+    // 需要调用线程有事件循环，通常是界面线程
+    bool start(const Finished &finished, QString *error);
+    // 立即结束并调用Finished，回调返回之前不要销毁会话
+    void stop();
+    bool isRunning() const { return m_running; }
+    Stats stats() const { return m_stats; }
+    const Options &options() const { return m_options; }
+
+private:
+    void tick();
+    void finish(const QString &error);
+
+    Options m_options;
+    Finished m_finished;
+    bool m_running = false;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    qint64 m_lastChangeMs = 0;
+    int m_clicks = 0;
+    int m_failedGrabs = 0;
+    int m_unmatchedInRow = 0;
+    ScrollStitcher m_stitcher;
+    Stats m_stats;
+};
+
+#endif // SCROLLSESSION_H
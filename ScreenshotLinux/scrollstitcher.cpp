@@ -0,0 +1,129 @@
+#include "scrollstitcher.h"
+#include "captureframe.h"
+#include "fasthash.h"
+#include <vector>
+
+ScrollStitcher::Result ScrollStitcher::add(const QImage &frame)
+{
+    if (frame.isNull()) {
+        return Result::NoOverlap;
+    }
+    const QVector<quint64> hashes = rowHashes(frame);
+    if (m_height == 0) {
+        m_frameSize = frame.size();
+        m_devicePixelRatio = frame.devicePixelRatio();
+        m_frameTop = 0;
+        m_lastScroll = 0;
+        append(frame, 0);
+        m_previous = hashes;
+        return Result::Appended;
+    }
+    if (frame.size() != m_frameSize) {
+        return Result::SizeChanged;
+    }
+
+    // 与上一帧同一位置相同的顶部、底部行不参与对齐，它们是固定的标题栏、状态栏，
+    // 或者恰好没有变化的空白；无论哪种，中间部分的对齐结果都一样
+    const int rows = hashes.size();
+    int top = 0;
+    while (top < rows && hashes.at(top) == m_previous.at(top)) {
+        ++top;
+    }
+    if (top == rows) {
+        return Result::Unchanged;
+    }
+    int bottom = 0;
+    while (bottom < rows - top && hashes.at(rows - 1 - bottom) == m_previous.at(rows - 1 - bottom)) {
+        ++bottom;
+    }
+    const int band = rows - top - bottom;
+
+    // 向下滚动d行时，新帧中间部分的前band-d行就是上一帧中间部分的后band-d行
+    const int overlap = longestPrefixSuffix(hashes.constData() + top, band, m_previous.constData() + top, band);
+    const int minOverlap = qMin(band, qMax(int(MinOverlapRows), band / 8));
+    if (overlap < minOverlap) {
+        return Result::NoOverlap;
+    }
+    const int scroll = band - overlap;
+
+    // 新帧顶部下移scroll行；从新露出的行开始连同底部固定的行一起贴上，
+    // 上一帧的底部固定行被新内容覆盖，画布底部总是最新的状态栏
+    m_headerRows = top;
+    m_footerRows = bottom;
+    m_lastScroll = scroll;
+    m_frameTop += scroll;
+    append(frame, rows - bottom - scroll);
+    m_previous = hashes;
+    return Result::Appended;
+}
+
+void ScrollStitcher::reset()
+{
+    *this = ScrollStitcher();
+}
+
+QImage ScrollStitcher::result() const
+{
+    QImage image = m_canvas.copy(QRect(0, 0, m_canvas.width(), m_height));
+    image.setDevicePixelRatio(m_devicePixelRatio);
+    return image;
+}
+
+QVector<quint64> ScrollStitcher::rowHashes(const QImage &frame)
+{
+    // 截图后端给出的都是24/32位格式；每像素不足一字节的格式先转换
+    const QImage image = frame.depth() < 8 ? frame.convertToFormat(QImage::Format_ARGB32) : frame;
+    QVector<quint64> hashes(image.height());
+    const size_t rowBytes = size_t(image.width()) * (image.depth() / 8);
+    for (int y = 0; y < image.height(); ++y) {
+        hashes[y] = FastHash::hash64(image.constScanLine(y), rowBytes);
+    }
+    return hashes;
+}
+
+int ScrollStitcher::longestPrefixSuffix(const quint64 *pattern, int patternLength, const quint64 *text, int textLength)
+{
+    if (patternLength <= 0 || textLength <= 0) {
+        return 0;
+    }
+    // failure[i]：pattern[0..i]最长的真前缀同时也是后缀的长度
+    std::vector<int> failure(size_t(patternLength), 0);
+    for (int i = 1, length = 0; i < patternLength; ++i) {
+        while (length > 0 && pattern[i] != pattern[length]) {
+            length = failure[length - 1];
+        }
+        if (pattern[i] == pattern[length]) {
+            ++length;
+        }
+        failure[i] = length;
+    }
+    // 扫描完text后已匹配的长度就是pattern与text后缀的最长重合
+    int matched = 0;
+    for (int i = 0; i < textLength; ++i) {
+        while (matched > 0 && (matched == patternLength || text[i] != pattern[matched])) {
+            matched = failure[matched - 1];
+        }
+        if (text[i] == pattern[matched]) {
+            ++matched;
+        }
+    }
+    return matched;
+}
+
+void ScrollStitcher::append(const QImage &frame, int firstRow)
+{
+    const int bottom = m_frameTop + frame.height();
+    if (bottom > m_canvas.height()) {
+        // 按整块增高，已有的块原样保留
+        const int tile = TiledImage::TileSize;
+        m_canvas.resize(QSize(frame.width(), (bottom + tile - 1) / tile * tile));
+    }
+    // 截图帧可能引用共享内存段，只把新露出的行复制出来（需要时顺便转换格式），画布不引用整帧
+    const QImage view(frame.constScanLine(firstRow), frame.width(), frame.height() - firstRow,
+                      frame.bytesPerLine(), frame.format());
+    const QImage rows = view.format() == m_canvas.format() ? view.copy() : view.convertToFormat(m_canvas.format());
+    CaptureFrame::noteCopy(rows.sizeInBytes());
+    m_canvas.paste(QPoint(0, m_frameTop + firstRow), rows);
+    m_canvas.releaseSources();
+    m_height = qMax(m_height, bottom);
+}
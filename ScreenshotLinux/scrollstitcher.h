@@ -0,0 +1,59 @@
+#ifndef SCROLLSTITCHER_H
+#define SCROLLSTITCHER_H
+
+#include <QImage>
+#include <QVector>
+#include "tiledimage.h"
+
+// 长截图拼接：同一区域在滚动过程中连续截取的帧，按行对齐后拼成一张长图
+// 每帧每行算一个64位哈希（FastHash），对齐只比较哈希：
+// 先找出与上一帧同一位置完全相同的顶部和底部行（固定的标题栏、状态栏），
+// 中间滚动的部分用KMP找新帧开头与上一帧末尾最长的重合，整个过程是O(行数)
+// 新露出的行追加到按整块增高的分块画布上，已经拼好的部分不移动、不复制
+class ScrollStitcher
+{
+public:
+    enum class Result {
+        Appended,    // 找到重合并追加了新的行（第一帧也返回它）
+        Unchanged,   // 与上一帧相同，没有滚动
+        NoOverlap,   // 滚动距离超过一帧或反向滚动，这一帧被忽略，下一帧仍与上一次追加的帧比较
+        SizeChanged  // 帧尺寸与第一帧不同（缩放比例变化），无法继续拼接
+    };
+
+    // 重合行数至少为滚动部分的1/8且不少于16行，避免大片空白或重复图案造成误配
+    enum { MinOverlapRows = 16 };
+
+    ScrollStitcher() = default;
+
+    Result add(const QImage &frame);
+    void reset();
+
+    bool isEmpty() const { return m_height == 0; }
+    int height() const { return m_height; }       // 已拼接的高度（像素）
+    int lastScroll() const { return m_lastScroll; } // 最近一次追加时的滚动行数
+    int headerRows() const { return m_headerRows; } // 最近一次对齐时固定在顶部的行数
+    int footerRows() const { return m_footerRows; } // 最近一次对齐时固定在底部的行数
+
+    const TiledImage &canvas() const { return m_canvas; } // 高度按整块向上取整，超出height()的部分未分配
+    QImage result() const;
+
+    // 每行一个哈希，直接读取扫描行，不转换格式
+    static QVector<quint64> rowHashes(const QImage &frame);
+    // pattern最长的、同时是text后缀的前缀长度（KMP）
+    static int longestPrefixSuffix(const quint64 *pattern, int patternLength, const quint64 *text, int textLength);
+
+private:
+    void append(const QImage &frame, int firstRow);
+
+    TiledImage m_canvas;
+    QVector<quint64> m_previous; // 上一次追加的帧的行哈希
+    QSize m_frameSize;
+    qreal m_devicePixelRatio = 1.0;
+    int m_frameTop = 0;          // 上一次追加的帧顶部在画布中的位置
+    int m_height = 0;
+    int m_lastScroll = 0;
+    int m_headerRows = 0;
+    int m_footerRows = 0;
+};
+
+#endif // SCROLLSTITCHER_H
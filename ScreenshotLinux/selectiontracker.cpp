@@ -0,0 +1,347 @@
+#include "selectiontracker.h"
+#include "edgemap.h"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+// 按行(上/中/下)和列(左/中/右)查表得到命中部位
+const SelectionTracker::Hit kHitTable[3][3] = {
+    { SelectionTracker::HitTopLeft, SelectionTracker::HitTop, SelectionTracker::HitTopRight },
+    { SelectionTracker::HitLeft, SelectionTracker::HitMiddle, SelectionTracker::HitRight },
+    { SelectionTracker::HitBottomLeft, SelectionTracker::HitBottom, SelectionTracker::HitBottomRight },
+};
+
+// 点相对于[low, high]这条轴的位置：0靠近low边，2靠近high边，1在中间，-1在外面
+int classify(int value, int low, int high, int tolerance)
+{
+    const int toLow = qAbs(value - low);
+    const int toHigh = qAbs(value - high);
+    if (toLow <= tolerance || toHigh <= tolerance) {
+        return toLow <= toHigh ? 0 : 2;
+    }
+    return value > low && value < high ? 1 : -1;
+}
+
+bool movesLeft(SelectionTracker::Hit hit)
+{
+    return hit == SelectionTracker::HitTopLeft || hit == SelectionTracker::HitBottomLeft ||
+           hit == SelectionTracker::HitLeft;
+}
+
+bool movesRight(SelectionTracker::Hit hit)
+{
+    return hit == SelectionTracker::HitTopRight || hit == SelectionTracker::HitBottomRight ||
+           hit == SelectionTracker::HitRight;
+}
+
+bool movesTop(SelectionTracker::Hit hit)
+{
+    return hit == SelectionTracker::HitTopLeft || hit == SelectionTracker::HitTopRight ||
+           hit == SelectionTracker::HitTop;
+}
+
+bool movesBottom(SelectionTracker::Hit hit)
+{
+    return hit == SelectionTracker::HitBottomLeft || hit == SelectionTracker::HitBottomRight ||
+           hit == SelectionTracker::HitBottom;
+}
+
+} // namespace
+
+SelectionTracker::SelectionTracker()
+    : m_handleSize(6)
+    , m_snapDistance(8)
+    , m_edges(nullptr)
+    , m_edgeSnapDistance(4)
+    , m_dragHit(HitNothing)
+{
+}
+
+QRegion SelectionTracker::setRect(const QRect &rect)
+{
+    const QRect newRect = constrain(rect.normalized(), HitNothing);
+    const QRegion dirty = changeRegion(m_rect, newRect);
+    m_rect = newRect;
+    return dirty;
+}
+
+void SelectionTracker::setBounds(const QRect &bounds)
+{
+    m_bounds = bounds;
+}
+
+void SelectionTracker::setHandleSize(int size)
+{
+    m_handleSize = qMax(2, size);
+}
+
+QRect SelectionTracker::handleRect(Hit hit) const
+{
+    QPoint center;
+    switch (hit) {
+        case HitTopLeft:     center = m_rect.topLeft(); break;
+        case HitTopRight:    center = m_rect.topRight(); break;
+        case HitBottomRight: center = m_rect.bottomRight(); break;
+        case HitBottomLeft:  center = m_rect.bottomLeft(); break;
+        case HitTop:         center = QPoint(m_rect.center().x(), m_rect.top()); break;
+        case HitRight:       center = QPoint(m_rect.right(), m_rect.center().y()); break;
+        case HitBottom:      center = QPoint(m_rect.center().x(), m_rect.bottom()); break;
+        case HitLeft:        center = QPoint(m_rect.left(), m_rect.center().y()); break;
+        default:
+            return QRect();
+    }
+    return QRect(center - QPoint(m_handleSize / 2, m_handleSize / 2), QSize(m_handleSize, m_handleSize));
+}
+
+bool SelectionTracker::hasHandle(Hit hit) const
+{
+    switch (hit) {
+        case HitTopLeft:
+        case HitTopRight:
+        case HitBottomRight:
+        case HitBottomLeft:
+            return true;
+        case HitTop:
+        case HitBottom:
+            return m_rect.width() - m_handleSize * 3 > 4;
+        case HitLeft:
+        case HitRight:
+            return m_rect.height() - m_handleSize * 3 > 4;
+        default:
+            return false;
+    }
+}
+
+void SelectionTracker::setSnapTargets(const QVector<int> &xs, const QVector<int> &ys)
+{
+    m_snapX = xs;
+    m_snapY = ys;
+    std::sort(m_snapX.begin(), m_snapX.end());
+    std::sort(m_snapY.begin(), m_snapY.end());
+}
+
+SelectionTracker::Hit SelectionTracker::hitTest(const QPoint &point) const
+{
+    if (m_rect.isEmpty()) {
+        return HitNothing;
+    }
+    // 边缘容差与控制点大小一致，整条边都可以拖动，不只是控制点本身
+    const int tolerance = m_handleSize / 2 + 1;
+    const int column = classify(point.x(), m_rect.left(), m_rect.right(), tolerance);
+    const int row = classify(point.y(), m_rect.top(), m_rect.bottom(), tolerance);
+    if (column < 0 || row < 0) {
+        return HitNothing;
+    }
+    // 落在某条边的容差内，但另一方向已经超出选区的点不算命中
+    if ((column != 1 && (point.y() < m_rect.top() - tolerance || point.y() > m_rect.bottom() + tolerance)) ||
+        (row != 1 && (point.x() < m_rect.left() - tolerance || point.x() > m_rect.right() + tolerance))) {
+        return HitNothing;
+    }
+    return kHitTable[row][column];
+}
+
+Qt::CursorShape SelectionTracker::cursorForHit(Hit hit)
+{
+    switch (hit) {
+        case HitTopLeft:
+        case HitBottomRight:
+            return Qt::SizeFDiagCursor;
+        case HitTopRight:
+        case HitBottomLeft:
+            return Qt::SizeBDiagCursor;
+        case HitTop:
+        case HitBottom:
+            return Qt::SizeVerCursor;
+        case HitLeft:
+        case HitRight:
+            return Qt::SizeHorCursor;
+        case HitMiddle:
+            return Qt::SizeAllCursor;
+        default:
+            return Qt::CrossCursor;
+    }
+}
+
+void SelectionTracker::beginDrag(Hit hit, const QPoint &point)
+{
+    m_dragHit = hit;
+    m_dragOrigin = point;
+    m_dragStartRect = m_rect;
+}
+
+QRegion SelectionTracker::dragTo(const QPoint &point, bool snapEdges)
+{
+    if (m_dragHit == HitNothing) {
+        return QRegion();
+    }
+
+    const QPoint delta = point - m_dragOrigin;
+    int left = m_dragStartRect.left();
+    int top = m_dragStartRect.top();
+    int right = m_dragStartRect.right();
+    int bottom = m_dragStartRect.bottom();
+
+    if (m_dragHit == HitMiddle) {
+        left += delta.x();
+        right += delta.x();
+        top += delta.y();
+        bottom += delta.y();
+        if (snapEdges) {
+            // 整体移动时取离吸附目标更近的一条边，保持选区大小
+            int leftDistance = INT_MAX, rightDistance = INT_MAX;
+            const int snappedLeft = snap(left, Qt::Horizontal, top, bottom, &leftDistance);
+            const int snappedRight = snap(right, Qt::Horizontal, top, bottom, &rightDistance);
+            const int dx = leftDistance <= rightDistance ? snappedLeft - left : snappedRight - right;
+            int topDistance = INT_MAX, bottomDistance = INT_MAX;
+            const int snappedTop = snap(top, Qt::Vertical, left, right, &topDistance);
+            const int snappedBottom = snap(bottom, Qt::Vertical, left, right, &bottomDistance);
+            const int dy = topDistance <= bottomDistance ? snappedTop - top : snappedBottom - bottom;
+            left += dx;
+            right += dx;
+            top += dy;
+            bottom += dy;
+        }
+    } else {
+        // 先移动再吸附，吸附时用移动后的另一方向范围判断边缘是否连续
+        left += movesLeft(m_dragHit) ? delta.x() : 0;
+        right += movesRight(m_dragHit) ? delta.x() : 0;
+        top += movesTop(m_dragHit) ? delta.y() : 0;
+        bottom += movesBottom(m_dragHit) ? delta.y() : 0;
+        if (snapEdges) {
+            int unused = 0;
+            const int spanTop = qMin(top, bottom), spanBottom = qMax(top, bottom);
+            const int spanLeft = qMin(left, right), spanRight = qMax(left, right);
+            if (movesLeft(m_dragHit)) {
+                left = snap(left, Qt::Horizontal, spanTop, spanBottom, &unused);
+            }
+            if (movesRight(m_dragHit)) {
+                right = snap(right, Qt::Horizontal, spanTop, spanBottom, &unused);
+            }
+            if (movesTop(m_dragHit)) {
+                top = snap(top, Qt::Vertical, spanLeft, spanRight, &unused);
+            }
+            if (movesBottom(m_dragHit)) {
+                bottom = snap(bottom, Qt::Vertical, spanLeft, spanRight, &unused);
+            }
+        }
+    }
+
+    // 拖过对边时选区翻转，与CMyTracker允许反转的行为一致
+    const QRect newRect = constrain(QRect(QPoint(left, top), QPoint(right, bottom)).normalized(), m_dragHit);
+    const QRegion dirty = changeRegion(m_rect, newRect);
+    m_rect = newRect;
+    return dirty;
+}
+
+void SelectionTracker::endDrag()
+{
+    m_dragHit = HitNothing;
+}
+
+QRegion SelectionTracker::nudge(int key, Qt::KeyboardModifiers modifiers)
+{
+    const int step = (modifiers & Qt::ShiftModifier) ? 10 : 1;
+    QPoint delta;
+    switch (key) {
+        case Qt::Key_Left:  delta = QPoint(-step, 0); break;
+        case Qt::Key_Right: delta = QPoint(step, 0); break;
+        case Qt::Key_Up:    delta = QPoint(0, -step); break;
+        case Qt::Key_Down:  delta = QPoint(0, step); break;
+        default:
+            return QRegion();
+    }
+
+    QRect newRect;
+    if (modifiers & Qt::ControlModifier) {
+        newRect = m_rect.adjusted(0, 0, delta.x(), delta.y());
+        newRect.setWidth(qMax(1, newRect.width()));
+        newRect.setHeight(qMax(1, newRect.height()));
+        newRect = constrain(newRect, HitBottomRight);
+    } else {
+        newRect = constrain(m_rect.translated(delta), HitMiddle);
+    }
+    const QRegion dirty = changeRegion(m_rect, newRect);
+    m_rect = newRect;
+    return dirty;
+}
+
+QRegion SelectionTracker::frameRegion(const QRect &rect) const
+{
+    if (rect.isEmpty()) {
+        return QRegion();
+    }
+    // 边框线宽1像素，控制点以边为中心向两侧各伸出一半
+    const int margin = m_handleSize / 2 + 2;
+    QRegion region(rect.adjusted(-margin, -margin, margin, margin));
+    const QRect inner = rect.adjusted(margin, margin, -margin, -margin);
+    if (inner.isValid()) {
+        region -= QRegion(inner);
+    }
+    return region;
+}
+
+QRegion SelectionTracker::changeRegion(const QRect &oldRect, const QRect &newRect) const
+{
+    if (oldRect == newRect) {
+        return QRegion();
+    }
+    // 遮罩只在两个选区的对称差内变化，再加上新旧边框和控制点
+    return QRegion(oldRect).xored(QRegion(newRect)) + frameRegion(oldRect) + frameRegion(newRect);
+}
+
+int SelectionTracker::snap(int value, Qt::Orientation orientation, int spanBegin, int spanEnd, int *distance) const
+{
+    const bool horizontal = orientation == Qt::Horizontal;
+    const QVector<int> &targets = horizontal ? m_snapX : m_snapY;
+    int best = value;
+    int bestDistance = m_snapDistance + 1;
+    auto consider = [&](int target) {
+        const int d = qAbs(target - value);
+        if (d < bestDistance) {
+            best = target;
+            bestDistance = d;
+        }
+    };
+
+    // 目标已排序，只需要比较二分查找位置两侧的两个
+    const auto it = std::lower_bound(targets.begin(), targets.end(), value);
+    if (it != targets.end()) {
+        consider(*it);
+    }
+    if (it != targets.begin()) {
+        consider(*(it - 1));
+    }
+    if (m_bounds.isValid()) {
+        consider(horizontal ? m_bounds.left() : m_bounds.top());
+        consider(horizontal ? m_bounds.right() : m_bounds.bottom());
+    }
+
+    // 图像边缘只在更近时才替换窗口/屏幕边
+    if (m_edges) {
+        int edgeDistance = INT_MAX;
+        const int edge = m_edges->snap(value, orientation, spanBegin, spanEnd,
+                                       qMin(m_edgeSnapDistance, bestDistance - 1), &edgeDistance);
+        if (edgeDistance < bestDistance) {
+            best = edge;
+            bestDistance = edgeDistance;
+        }
+    }
+
+    *distance = bestDistance <= m_snapDistance ? bestDistance : INT_MAX;
+    return bestDistance <= m_snapDistance ? best : value;
+}
+
+QRect SelectionTracker::constrain(QRect rect, Hit hit) const
+{
+    if (!m_bounds.isValid() || rect.isEmpty()) {
+        return rect;
+    }
+    if (hit == HitMiddle) {
+        // 整体移动时平移回范围内，不改变大小
+        rect.moveLeft(qBound(m_bounds.left(), rect.left(), qMax(m_bounds.left(), m_bounds.right() - rect.width() + 1)));
+        rect.moveTop(qBound(m_bounds.top(), rect.top(), qMax(m_bounds.top(), m_bounds.bottom() - rect.height() + 1)));
+        return rect.intersected(m_bounds);
+    }
+    return rect.intersected(m_bounds);
+}
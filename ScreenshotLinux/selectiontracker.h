@@ -0,0 +1,78 @@
+#ifndef SELECTIONTRACKER_H
+#define SELECTIONTRACKER_H
+
+#include <QPoint>
+#include <QRect>
+#include <QRegion>
+#include <QVector>
+#include <Qt>
+
+class EdgeMap;
+
+// 可调整的选区：8个控制点加整体移动、键盘微调和边缘吸附
+// 移植自Windows版的CMyTracker（MFC CRectTracker），命中编号与之相同；
+// 不依赖窗口，所有修改都返回需要重绘的区域，由调用方交给update()
+class SelectionTracker
+{
+public:
+    enum Hit {
+        HitNothing = -1,
+        HitTopLeft = 0, HitTopRight = 1, HitBottomRight = 2, HitBottomLeft = 3,
+        HitTop = 4, HitRight = 5, HitBottom = 6, HitLeft = 7, HitMiddle = 8
+    };
+
+    SelectionTracker();
+
+    QRect rect() const { return m_rect; }
+    QRegion setRect(const QRect &rect);
+    void setBounds(const QRect &bounds); // 选区不能超出的范围，通常是整个截图
+    QRect bounds() const { return m_bounds; }
+
+    int handleSize() const { return m_handleSize; }
+    void setHandleSize(int size);
+    QRect handleRect(Hit hit) const;
+    bool hasHandle(Hit hit) const; // 选区太小时不显示边中点的控制点，与CMyTracker::GetHandleMask一致
+
+    // 吸附目标，例如窗口边缘或检测到的图像边缘；截图边界总是吸附目标
+    void setSnapTargets(const QVector<int> &xs, const QVector<int> &ys);
+    void setSnapDistance(int distance) { m_snapDistance = distance; }
+    // 图像边缘吸附，距离比窗口边更小；edges由调用方持有，传nullptr关闭
+    void setEdgeMap(const EdgeMap *edges) { m_edges = edges; }
+    void setEdgeSnapDistance(int distance) { m_edgeSnapDistance = distance; }
+    int edgeSnapDistance() const { return m_edgeSnapDistance; }
+
+    // 只比较点与四条边的距离再查表，与控制点数量无关
+    Hit hitTest(const QPoint &point) const;
+    static Qt::CursorShape cursorForHit(Hit hit);
+
+    void beginDrag(Hit hit, const QPoint &point);
+    QRegion dragTo(const QPoint &point, bool snap);
+    void endDrag();
+    bool isDragging() const { return m_dragHit != HitNothing; }
+    Hit dragHit() const { return m_dragHit; }
+
+    // 方向键移动选区，Shift每次10像素，Ctrl改为移动右/下边调整大小；不是方向键时返回空区域
+    QRegion nudge(int key, Qt::KeyboardModifiers modifiers);
+
+private:
+    QRegion frameRegion(const QRect &rect) const;  // 边框和控制点覆盖的区域
+    QRegion changeRegion(const QRect &oldRect, const QRect &newRect) const;
+    // spanBegin..spanEnd是这条边在另一方向上的范围，用于判断图像边缘是否连续
+    int snap(int value, Qt::Orientation orientation, int spanBegin, int spanEnd, int *distance) const;
+    QRect constrain(QRect rect, Hit hit) const;
+
+    QRect m_rect;
+    QRect m_bounds;
+    int m_handleSize;
+    int m_snapDistance;
+    QVector<int> m_snapX;   // 已排序
+    QVector<int> m_snapY;
+    const EdgeMap *m_edges;
+    int m_edgeSnapDistance;
+
+    Hit m_dragHit;
+    QPoint m_dragOrigin;
+    QRect m_dragStartRect;
+};
+
+#endif // SELECTIONTRACKER_H
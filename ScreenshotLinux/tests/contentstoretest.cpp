@@ -0,0 +1,270 @@
+// 去重存储的单元测试：对象目录、保存的文件和历史都放在临时目录里，检查硬链接的共享、
+// 历史删除记录与用户保存的文件之间的引用关系、垃圾回收、跨文件系统时的直接写入、
+// 只读对象和被修改的对象、多个线程同时存同一张截图
+//   ctest --test-dir build -R ContentStoreTest
+#include "contentstore.h"
+#include "historystore.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <memory>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const ImageEncoder::Profile kProfile = ImageEncoder::Profile::PngFast;
+
+QImage testImage(int seed)
+{
+    QImage image(40, 24, QImage::Format_RGB32);
+    image.fill(qRgb(seed * 53 % 256, seed * 17 % 256, 200));
+    image.setPixel(0, 0, qRgb((seed >> 16) & 0xff, (seed >> 8) & 0xff, seed & 0xff));
+    return image;
+}
+
+// 路径不存在时返回全0
+struct stat fileStat(const QString &path)
+{
+    struct stat info = {};
+    ::stat(QFile::encodeName(path).constData(), &info);
+    return info;
+}
+
+int objectCount(const QString &root)
+{
+    int count = 0;
+    QDirIterator it(root, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        ++count;
+    }
+    return count;
+}
+
+} // namespace
+
+class ContentStoreTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void savesShareInode();
+    void retentionKeepsSavedObject();
+    void garbageCollection();
+    void crossFilesystemFallback();
+    void modifiedObjectNotReused();
+    void concurrentStore();
+
+private:
+    QString objectRoot() const { return m_dir->path() + "/objects"; }
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+void ContentStoreTest::init()
+{
+    m_dir.reset(new QTemporaryDir);
+    QVERIFY(m_dir->isValid());
+}
+
+void ContentStoreTest::cleanup()
+{
+    m_dir.reset();
+}
+
+void ContentStoreTest::savesShareInode()
+{
+    // 同一张截图保存两次：两个文件和对象是同一个inode，只编码一次
+    const QImage image = testImage(1);
+    const QString first = m_dir->path() + "/first.png";
+    const QString second = m_dir->path() + "/second.png";
+    QVERIFY(ContentStore::save(image, first, kProfile, objectRoot()));
+    QVERIFY(ContentStore::save(image, second, kProfile, objectRoot()));
+
+    const QString object = ContentStore::objectPath(ContentStore::pixelHash(image), kProfile, objectRoot());
+    const struct stat objectInfo = fileStat(object);
+    QVERIFY(objectInfo.st_ino != 0);
+    QCOMPARE(fileStat(first).st_ino, objectInfo.st_ino);
+    QCOMPARE(fileStat(second).st_ino, objectInfo.st_ino);
+    QCOMPARE(quint64(objectInfo.st_nlink), quint64(3));
+    QCOMPARE(objectCount(objectRoot()), 1);
+    QCOMPARE(QImage(second).convertToFormat(QImage::Format_RGB32), image);
+
+    // 再次保存到已有的链接上不改变链接数
+    QVERIFY(ContentStore::save(image, first, kProfile, objectRoot()));
+    QCOMPARE(quint64(fileStat(object).st_nlink), quint64(3));
+}
+
+void ContentStoreTest::retentionKeepsSavedObject()
+{
+    // 历史删除旧记录时只释放自己的链接，用户另外保存的同一张截图仍然引用对象，不能被删除
+    HistoryStore history(m_dir->path() + "/history");
+    history.setContentDirectory(objectRoot());
+    HistoryStore::Retention retention;
+    retention.maxEntries = 1;
+    history.setRetention(retention);
+    QVERIFY(history.open());
+
+    const QImage image = testImage(1);
+    HistoryStore::Entry added;
+    QVERIFY(history.add(image, QDateTime::currentDateTime(), &added));
+    const QString saved = m_dir->path() + "/saved.png";
+    QVERIFY(ContentStore::save(image, saved, kProfile, objectRoot()));
+    const QString object = ContentStore::objectPath(ContentStore::pixelHash(image), kProfile, objectRoot());
+    QCOMPARE(fileStat(added.filePath).st_ino, fileStat(object).st_ino);
+    QCOMPARE(quint64(fileStat(object).st_nlink), quint64(3));
+
+    // 第二条截图挤掉第一条
+    QVERIFY(history.add(testImage(2)));
+    QCOMPARE(history.count(), 1);
+    QVERIFY(!QFile::exists(added.filePath));
+    QVERIFY(QFile::exists(object));
+    QCOMPARE(quint64(fileStat(object).st_nlink), quint64(2));
+    QCOMPARE(fileStat(saved).st_ino, fileStat(object).st_ino);
+    QCOMPARE(QImage(saved).convertToFormat(QImage::Format_RGB32), image);
+
+    // 用户删除保存的文件后对象没有其他链接，垃圾回收删除它；历史中的对象保留
+    QVERIFY(QFile::remove(saved));
+    QCOMPARE(ContentStore::collectGarbage(objectRoot()), 1);
+    QVERIFY(!QFile::exists(object));
+    QCOMPARE(objectCount(objectRoot()), 1);
+    QVERIFY(QFile::exists(history.entry(0).filePath));
+}
+
+void ContentStoreTest::garbageCollection()
+{
+    // 只删除链接数为1（只有对象自己）的对象
+    const QImage orphanImage = testImage(1);
+    const QImage linkedImage = testImage(2);
+    bool created = false;
+    const QString orphan = ContentStore::store(orphanImage, ContentStore::pixelHash(orphanImage), kProfile,
+                                               &created, objectRoot());
+    QVERIFY(created);
+    const QString linked = ContentStore::store(linkedImage, ContentStore::pixelHash(linkedImage), kProfile,
+                                               &created, objectRoot());
+    QVERIFY(created);
+    const QString target = m_dir->path() + "/linked.png";
+    QVERIFY(ContentStore::link(linked, target));
+
+    // 已有的对象不重新编码
+    QCOMPARE(ContentStore::store(linkedImage, ContentStore::pixelHash(linkedImage), kProfile, &created, objectRoot()),
+             linked);
+    QVERIFY(!created);
+
+    QCOMPARE(ContentStore::collectGarbage(objectRoot()), 1);
+    QVERIFY(!QFile::exists(orphan));
+    QVERIFY(QFile::exists(linked));
+    QCOMPARE(fileStat(target).st_ino, fileStat(linked).st_ino);
+    QCOMPARE(ContentStore::collectGarbage(objectRoot()), 0);
+
+    // release()同样只在没有其他链接时删除
+    ContentStore::release(linked);
+    QVERIFY(QFile::exists(linked));
+    QVERIFY(QFile::remove(target));
+    ContentStore::release(linked);
+    QVERIFY(!QFile::exists(linked));
+}
+
+void ContentStoreTest::crossFilesystemFallback()
+{
+    // 目标与对象目录不在同一文件系统时不能硬链接，直接编码写入，对象目录里不留对象
+    QVERIFY(QDir().mkpath(objectRoot()));
+    const dev_t rootDevice = fileStat(objectRoot()).st_dev;
+    std::unique_ptr<QTemporaryDir> other;
+    const QStringList candidates = { QStringLiteral("/dev/shm"), QStringLiteral("/run/user/%1").arg(::getuid()),
+                                     QDir::homePath(), QDir::currentPath() };
+    for (const QString &candidate : candidates) {
+        if (!QFileInfo(candidate).isDir() || fileStat(candidate).st_dev == rootDevice) {
+            continue;
+        }
+        other.reset(new QTemporaryDir(candidate + "/contentstoretest-XXXXXX"));
+        if (other->isValid()) {
+            break;
+        }
+        other.reset();
+    }
+    if (!other) {
+        QSKIP("没有与临时目录不同的可写文件系统");
+    }
+
+    const QImage image = testImage(3);
+    const QString target = other->path() + "/direct.png";
+    QVERIFY(ContentStore::save(image, target, kProfile, objectRoot()));
+    QCOMPARE(quint64(fileStat(target).st_nlink), quint64(1));
+    QCOMPARE(QImage(target).convertToFormat(QImage::Format_RGB32), image);
+    QCOMPARE(objectCount(objectRoot()), 0);
+}
+
+void ContentStoreTest::modifiedObjectNotReused()
+{
+    // 对象和保存的文件都是只读的
+    const QImage image = testImage(1);
+    const QString saved = m_dir->path() + "/saved.png";
+    QVERIFY(ContentStore::save(image, saved, kProfile, objectRoot()));
+    const QString object = ContentStore::objectPath(ContentStore::pixelHash(image), kProfile, objectRoot());
+    QCOMPARE(fileStat(object).st_mode & 0222, mode_t(0));
+    QCOMPARE(fileStat(saved).st_ino, fileStat(object).st_ino);
+
+    // 改回可写后原地改写保存的文件（以root运行时只读也挡不住），对象随之改变；
+    // 之后存同一哈希的截图不再复用它，而是重新写入一个对象，被改写的文件保留自己的内容
+    QVERIFY(QFile::setPermissions(saved, QFile::ReadOwner | QFile::WriteOwner));
+    {
+        QFile file(saved);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        QVERIFY(ImageEncoder::encode(testImage(2), &file, kProfile));
+    }
+    QCOMPARE(fileStat(saved).st_ino, fileStat(object).st_ino);
+
+    const QString second = m_dir->path() + "/second.png";
+    bool created = false;
+    QCOMPARE(ContentStore::store(image, ContentStore::pixelHash(image), kProfile, &created, objectRoot()), object);
+    QVERIFY(created);
+    QVERIFY(ContentStore::save(image, second, kProfile, objectRoot()));
+    QVERIFY(fileStat(object).st_ino != fileStat(saved).st_ino);
+    QCOMPARE(fileStat(second).st_ino, fileStat(object).st_ino);
+    QCOMPARE(fileStat(object).st_mode & 0222, mode_t(0));
+    QCOMPARE(QImage(second).convertToFormat(QImage::Format_RGB32), image);
+    QCOMPARE(QImage(saved).convertToFormat(QImage::Format_RGB32), testImage(2));
+}
+
+void ContentStoreTest::concurrentStore()
+{
+    // 保存文件和记入历史在两个线程上同时存同一张截图：只创建一次对象，两个文件是同一个inode
+    for (int seed = 1; seed <= 20; ++seed) {
+        const QImage image = testImage(seed);
+        const quint64 hash = ContentStore::pixelHash(image);
+        bool created[2] = { false, false };
+        QString paths[2];
+        std::thread other([&]() {
+            paths[1] = ContentStore::store(image, hash, kProfile, &created[1], objectRoot());
+        });
+        paths[0] = ContentStore::store(image, hash, kProfile, &created[0], objectRoot());
+        other.join();
+        QVERIFY(!paths[0].isEmpty());
+        QCOMPARE(paths[1], paths[0]);
+        QVERIFY(created[0] != created[1]);
+    }
+
+    const QImage image = testImage(100);
+    const QString first = m_dir->path() + "/first.png";
+    const QString second = m_dir->path() + "/second.png";
+    std::thread other([&]() {
+        ContentStore::save(image, second, kProfile, objectRoot());
+    });
+    QVERIFY(ContentStore::save(image, first, kProfile, objectRoot()));
+    other.join();
+    QCOMPARE(fileStat(first).st_ino, fileStat(second).st_ino);
+    // 对象目录里没有留下临时文件
+    QCOMPARE(objectCount(objectRoot()), 21);
+}
+
+QTEST_GUILESS_MAIN(ContentStoreTest)
+
+#include "contentstoretest.moc"
@@ -0,0 +1,296 @@
+// 截图历史的单元测试：在临时目录上写入、关闭、重新打开，检查保留策略、索引重写、缩略图槽位复用和旧版索引的升级
+//   ctest --test-dir build -R HistoryStoreTest
+#include "historystore.h"
+#include "imagediff.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <memory>
+
+namespace {
+
+// 内容随seed变化的小图，编码很快；左上角的像素就是seed，每张的像素都不同
+QImage testImage(int seed)
+{
+    QImage image(32, 20, QImage::Format_RGB32);
+    image.fill(qRgb(seed * 37 % 256, seed * 91 % 256, seed * 13 % 256));
+    for (int i = 0; i < 8; ++i) {
+        image.setPixel((seed + i * 5) % image.width(), (seed * 3 + i) % image.height(), qRgb(255 - i, i * 30, seed % 256));
+    }
+    image.setPixel(0, 0, qRgb((seed >> 16) & 0xff, (seed >> 8) & 0xff, seed & 0xff));
+    return image;
+}
+
+const QDateTime kBaseTime = QDateTime::fromMSecsSinceEpoch(1760000000000);
+
+} // namespace
+
+class HistoryStoreTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void reopen();
+    void countRetention();
+    void byteRetention();
+    void compactThreshold();
+    void thumbnailSlotWrap();
+    void legacyIndexUpgrade();
+    void recentAndSimilar();
+
+private:
+    // 打开临时目录上的历史；去重的对象存储另有测试，这里直接写文件
+    std::unique_ptr<HistoryStore> openStore(const HistoryStore::Retention &retention = HistoryStore::Retention());
+    void addImages(HistoryStore &store, int first, int count);
+
+    std::unique_ptr<QTemporaryDir> m_dir;
+};
+
+void HistoryStoreTest::init()
+{
+    m_dir.reset(new QTemporaryDir);
+    QVERIFY(m_dir->isValid());
+}
+
+void HistoryStoreTest::cleanup()
+{
+    m_dir.reset();
+}
+
+std::unique_ptr<HistoryStore> HistoryStoreTest::openStore(const HistoryStore::Retention &retention)
+{
+    std::unique_ptr<HistoryStore> store(new HistoryStore(m_dir->path()));
+    store->setDeduplicate(false);
+    store->setRetention(retention);
+    return store->open() ? std::move(store) : nullptr;
+}
+
+void HistoryStoreTest::addImages(HistoryStore &store, int first, int count)
+{
+    for (int i = first; i < first + count; ++i) {
+        QVERIFY(store.add(testImage(i), kBaseTime.addSecs(i)));
+    }
+}
+
+void HistoryStoreTest::reopen()
+{
+    // 条目、缩略图和序号都在映射的文件里，关闭后重新打开应完全一致
+    QVector<HistoryStore::Entry> entries;
+    QVector<QImage> thumbnails;
+    {
+        std::unique_ptr<HistoryStore> store = openStore();
+        QVERIFY(store);
+        addImages(*store, 1, 3);
+        QCOMPARE(store->count(), 3);
+        for (int i = 0; i < store->count(); ++i) {
+            entries.append(store->entry(i));
+            thumbnails.append(store->thumbnail(i));
+            QVERIFY(!thumbnails.last().isNull());
+        }
+        store->close();
+        QVERIFY(!store->isOpen());
+        QCOMPARE(store->count(), 0);
+    }
+
+    std::unique_ptr<HistoryStore> store = openStore();
+    QVERIFY(store);
+    QCOMPARE(store->count(), 3);
+    qint64 total = 0;
+    for (int i = 0; i < store->count(); ++i) {
+        const HistoryStore::Entry entry = store->entry(i);
+        QCOMPARE(entry.sequence, entries.at(i).sequence);
+        QCOMPARE(entry.time, entries.at(i).time);
+        QCOMPARE(entry.filePath, entries.at(i).filePath);
+        QCOMPARE(entry.size, QSize(32, 20));
+        QCOMPARE(entry.bytes, entries.at(i).bytes);
+        QCOMPARE(entry.perceptualHash, entries.at(i).perceptualHash);
+        QVERIFY(QFile::exists(entry.filePath));
+        QCOMPARE(store->thumbnail(i), thumbnails.at(i));
+        total += entry.bytes;
+    }
+    QCOMPARE(store->entry(0).sequence, quint64(3));
+    QCOMPARE(store->totalBytes(), total);
+
+    // 序号接着上次的继续
+    HistoryStore::Entry added;
+    QVERIFY(store->add(testImage(4), kBaseTime.addSecs(4), &added));
+    QCOMPARE(added.sequence, quint64(4));
+    QCOMPARE(store->entry(0).sequence, quint64(4));
+}
+
+void HistoryStoreTest::countRetention()
+{
+    HistoryStore::Retention retention;
+    retention.maxEntries = 3;
+    std::unique_ptr<HistoryStore> store = openStore(retention);
+    QVERIFY(store);
+    addImages(*store, 1, 5);
+
+    QCOMPARE(store->count(), 3);
+    qint64 total = 0;
+    for (int i = 0; i < 3; ++i) {
+        const HistoryStore::Entry entry = store->entry(i);
+        QCOMPARE(entry.sequence, quint64(5 - i));
+        QVERIFY(QFile::exists(entry.filePath));
+        total += entry.bytes;
+    }
+    QCOMPARE(store->totalBytes(), total);
+    QCOMPARE(store->entry(3).sequence, quint64(0));
+    // 被删除的记录连同文件一起删除
+    QCOMPARE(QDir(m_dir->path() + "/files").entryList(QDir::Files).size(), 3);
+}
+
+void HistoryStoreTest::byteRetention()
+{
+    std::unique_ptr<HistoryStore> store = openStore();
+    QVERIFY(store);
+    addImages(*store, 1, 3);
+    const HistoryStore::Entry oldest = store->entry(2);
+    const qint64 newestTwo = store->entry(0).bytes + store->entry(1).bytes;
+
+    // 总大小上限恰好容纳最新的两条
+    HistoryStore::Retention retention;
+    retention.maxBytes = newestTwo;
+    store->setRetention(retention);
+    QCOMPARE(store->count(), 2);
+    QCOMPARE(store->totalBytes(), newestTwo);
+    QVERIFY(!QFile::exists(oldest.filePath));
+
+    // 至少保留最新的一条，即使它本身就超过上限
+    retention.maxBytes = 1;
+    store->setRetention(retention);
+    QCOMPARE(store->count(), 1);
+    QCOMPARE(store->entry(0).sequence, quint64(3));
+    QCOMPARE(store->totalBytes(), store->entry(0).bytes);
+}
+
+void HistoryStoreTest::compactThreshold()
+{
+    // 只保留一条时每次追加都跳过一条旧记录，第1025条写入后跳过了1024条，重写索引；
+    // 之后记录从头开始写，索引文件不再增长（不重写时写到第1281条会再扩大256条），重新打开后记录仍然正确
+    HistoryStore::Retention retention;
+    retention.maxEntries = 1;
+    std::unique_ptr<HistoryStore> store = openStore(retention);
+    QVERIFY(store);
+    const QString indexPath = m_dir->path() + "/index.bin";
+    const int compactAt = 1025;
+    addImages(*store, 1, compactAt);
+    const qint64 peakSize = QFileInfo(indexPath).size();
+
+    const int total = 1300;
+    addImages(*store, compactAt + 1, total - compactAt);
+    QCOMPARE(store->count(), 1);
+    QCOMPARE(store->entry(0).sequence, quint64(total));
+    QCOMPARE(QFileInfo(indexPath).size(), peakSize);
+    QCOMPARE(QDir(m_dir->path() + "/files").entryList(QDir::Files).size(), 1);
+
+    store->close();
+    store = openStore(retention);
+    QVERIFY(store);
+    QCOMPARE(store->count(), 1);
+    const HistoryStore::Entry latest = store->entry(0);
+    QCOMPARE(latest.sequence, quint64(total));
+    QCOMPARE(latest.time, kBaseTime.addSecs(total));
+    QVERIFY(QFile::exists(latest.filePath));
+    QCOMPARE(store->totalBytes(), latest.bytes);
+    QVERIFY(!store->thumbnail(0).isNull());
+}
+
+void HistoryStoreTest::thumbnailSlotWrap()
+{
+    // 图集按序号轮流使用槽位，超过槽位数后最旧一条的槽位被新的截图占用，它的缩略图变为空
+    HistoryStore::Retention retention;
+    retention.maxEntries = HistoryStore::ThumbnailSlots + 10;
+    std::unique_ptr<HistoryStore> store = openStore(retention);
+    QVERIFY(store);
+    addImages(*store, 1, HistoryStore::ThumbnailSlots + 1);
+
+    const int oldest = HistoryStore::ThumbnailSlots;
+    QCOMPARE(store->count(), HistoryStore::ThumbnailSlots + 1);
+    QCOMPARE(store->entry(oldest).sequence, quint64(1));
+    QVERIFY(store->thumbnail(oldest).isNull());
+    QVERIFY(!store->thumbnail(oldest - 1).isNull());
+
+    const QImage newest = store->thumbnail(0);
+    QVERIFY(!newest.isNull());
+    QCOMPARE(newest.size(), QSize(32, 20));
+    // 缩略图就是原图（比槽位小时不放大），与写入的像素一致
+    QCOMPARE(newest.convertToFormat(QImage::Format_RGB32), testImage(HistoryStore::ThumbnailSlots + 1));
+}
+
+void HistoryStoreTest::legacyIndexUpgrade()
+{
+    // 第1版的索引记录大小相同，最后8字节是文件名的尾部；打开时原地升级，条目保留，感知哈希为0
+    QVector<HistoryStore::Entry> entries;
+    {
+        std::unique_ptr<HistoryStore> store = openStore();
+        QVERIFY(store);
+        addImages(*store, 1, 2);
+        entries = { store->entry(0), store->entry(1) };
+    }
+    // 文件头64字节，版本在第4字节；每条记录128字节，最后8字节写成旧文件名的尾部
+    const int headerSize = 64;
+    const int recordSize = 128;
+    QFile index(m_dir->path() + "/index.bin");
+    QVERIFY(index.open(QIODevice::ReadWrite));
+    const quint32 legacyVersion = 1;
+    QVERIFY(index.seek(4));
+    QCOMPARE(index.write(reinterpret_cast<const char *>(&legacyVersion), sizeof(legacyVersion)), qint64(4));
+    for (int i = 0; i < 2; ++i) {
+        QVERIFY(index.seek(headerSize + (i + 1) * recordSize - 8));
+        QCOMPARE(index.write(QByteArray(8, 'x')), qint64(8));
+    }
+    index.close();
+
+    std::unique_ptr<HistoryStore> store = openStore();
+    QVERIFY(store);
+    QCOMPARE(store->count(), 2);
+    for (int i = 0; i < 2; ++i) {
+        const HistoryStore::Entry entry = store->entry(i);
+        QCOMPARE(entry.sequence, entries.at(i).sequence);
+        QCOMPARE(entry.filePath, entries.at(i).filePath);
+        QCOMPARE(entry.perceptualHash, quint64(0));
+        QVERIFY(!store->thumbnail(i).isNull());
+    }
+    QVERIFY(index.open(QIODevice::ReadOnly));
+    QVERIFY(index.seek(4));
+    quint32 version = 0;
+    QCOMPARE(index.read(reinterpret_cast<char *>(&version), sizeof(version)), qint64(4));
+    QCOMPARE(version, quint32(2));
+}
+
+void HistoryStoreTest::recentAndSimilar()
+{
+    // recent()和findSimilar()直接返回记录，不返回之后可能移动的下标
+    std::unique_ptr<HistoryStore> store = openStore();
+    QVERIFY(store);
+    addImages(*store, 1, 4);
+
+    const QVector<HistoryStore::Recent> items = store->recent(3);
+    QCOMPARE(items.size(), 3);
+    for (int i = 0; i < items.size(); ++i) {
+        QCOMPARE(items.at(i).entry.sequence, quint64(4 - i));
+        QCOMPARE(items.at(i).entry.filePath, store->entry(i).filePath);
+        QCOMPARE(items.at(i).thumbnail.convertToFormat(QImage::Format_RGB32), testImage(4 - i));
+    }
+    QCOMPARE(store->recent(10).size(), 4);
+
+    const HistoryStore::Entry query = store->entry(1);
+    const QVector<HistoryStore::Match> matches = store->findSimilar(query.perceptualHash, 64, query.sequence);
+    QCOMPARE(matches.size(), 3);
+    addImages(*store, 5, 2);
+    for (const HistoryStore::Match &match : matches) {
+        QVERIFY(match.entry.sequence != query.sequence);
+        QVERIFY(QFile::exists(match.entry.filePath));
+        QCOMPARE(match.distance, ImageDiff::distance(query.perceptualHash, match.entry.perceptualHash));
+    }
+}
+
+QTEST_GUILESS_MAIN(HistoryStoreTest)
+
+#include "historystoretest.moc"
@@ -0,0 +1,277 @@
+#include "tiledimage.h"
+#include "captureframe.h"
+#include <cstring>
+
+TiledImage::SpanIterator::SpanIterator(const TiledImage *image, const QRect &area, int column, int row)
+    : m_image(image)
+    , m_area(area)
+    , m_firstColumn(area.isEmpty() ? 0 : area.left() / TileSize)
+    , m_lastColumn(area.isEmpty() ? -1 : area.right() / TileSize)
+    , m_column(column)
+    , m_row(row)
+{
+}
+
+TiledImage::Span TiledImage::SpanIterator::operator*() const
+{
+    const QRect tile = m_image->tileRect(m_column, m_row);
+    return Span{ m_area.intersected(tile), m_image->tileAt(m_column, m_row), tile.topLeft() };
+}
+
+TiledImage::SpanIterator &TiledImage::SpanIterator::operator++()
+{
+    if (++m_column > m_lastColumn) {
+        m_column = m_firstColumn;
+        ++m_row;
+    }
+    return *this;
+}
+
+TiledImage::SpanRange::SpanRange(const TiledImage *image, const QRect &area)
+    : m_image(image)
+    , m_area(area.intersected(image->rect()))
+{
+}
+
+TiledImage::SpanIterator TiledImage::SpanRange::begin() const
+{
+    if (m_area.isEmpty()) {
+        return end();
+    }
+    return SpanIterator(m_image, m_area, m_area.left() / TileSize, m_area.top() / TileSize);
+}
+
+TiledImage::SpanIterator TiledImage::SpanRange::end() const
+{
+    if (m_area.isEmpty()) {
+        return SpanIterator(m_image, m_area, 0, 0);
+    }
+    return SpanIterator(m_image, m_area, m_area.left() / TileSize, m_area.bottom() / TileSize + 1);
+}
+
+TiledImage::TiledImage(const QSize &size, QImage::Format format)
+    : m_size(size)
+    , m_format(format)
+{
+    if (!size.isEmpty()) {
+        m_tiles.resize(columns() * rows());
+    }
+}
+
+TiledImage TiledImage::fromImage(const QImage &image)
+{
+    if (image.isNull()) {
+        return TiledImage();
+    }
+    // 32位格式直接引用image的像素，其他格式由paste()转换
+    TiledImage result(image.size(), image.depth() == 32 ? image.format() : QImage::Format_ARGB32_Premultiplied);
+    result.paste(QPoint(0, 0), image);
+    return result;
+}
+
+QRect TiledImage::tileRect(int column, int row) const
+{
+    return QRect(column * TileSize, row * TileSize, TileSize, TileSize).intersected(rect());
+}
+
+const QImage *TiledImage::tileAt(int column, int row) const
+{
+    const QImage &tile = m_tiles.at(row * columns() + column);
+    return tile.isNull() ? nullptr : &tile;
+}
+
+QImage &TiledImage::tileForWrite(int column, int row, const QRect &coverage)
+{
+    // 非const访问会让共享的块各自分离，只复制被写入的那些
+    QImage &tile = m_tiles[row * columns() + column];
+    if (tile.isNull()) {
+        const QRect area = tileRect(column, row);
+        tile = QImage(area.size(), m_format);
+        if (coverage != area) {
+            tile.fill(0);
+        }
+    }
+    return tile;
+}
+
+void TiledImage::paste(const QPoint &position, const QImage &image)
+{
+    if (isNull() || image.isNull()) {
+        return;
+    }
+    QImage pixels = image;
+    if (pixels.format() != m_format) {
+        pixels = image.convertToFormat(m_format);
+        CaptureFrame::noteCopy(pixels.sizeInBytes());
+    }
+    const QRect target = QRect(position, pixels.size()).intersected(rect());
+    if (target.isEmpty()) {
+        return;
+    }
+    m_sources.append(Source{ QRect(position, pixels.size()), pixels });
+
+    qint64 copied = 0;
+    for (const Span &span : spans(target)) {
+        const int column = span.tileOrigin.x() / TileSize;
+        const int row = span.tileOrigin.y() / TileSize;
+        const QRect local = span.rect.translated(-position);
+        QImage &slot = m_tiles[row * columns() + column];
+        if (slot.isNull() && span.rect == tileRect(column, row)) {
+            // 整块都在这一帧里：直接引用帧的内存
+            slot = CaptureFrame::view(pixels, local);
+            continue;
+        }
+
+        QImage &tile = tileForWrite(column, row, span.rect);
+        const size_t bytes = size_t(span.rect.width()) * 4;
+        for (int y = span.rect.top(); y <= span.rect.bottom(); ++y) {
+            std::memcpy(tile.scanLine(y - span.tileOrigin.y()) + (span.rect.left() - span.tileOrigin.x()) * 4,
+                        pixels.constScanLine(y - position.y()) + (span.rect.left() - position.x()) * 4,
+                        bytes);
+        }
+        copied += qint64(bytes) * span.rect.height();
+    }
+    CaptureFrame::noteCopy(copied);
+}
+
+void TiledImage::resize(const QSize &size)
+{
+    if (size == m_size) {
+        return;
+    }
+    if (m_format == QImage::Format_Invalid) {
+        m_format = QImage::Format_ARGB32_Premultiplied;
+    }
+    const int oldColumns = columns();
+    QVector<QImage> oldTiles;
+    oldTiles.swap(m_tiles);
+    const QSize oldSize = m_size;
+    m_size = size;
+    m_tiles.resize(size.isEmpty() ? 0 : columns() * rows());
+
+    const int keepColumns = qMin(oldColumns, columns());
+    const int keepRows = oldColumns > 0 ? qMin(int(oldTiles.size()) / oldColumns, rows()) : 0;
+    qint64 copied = 0;
+    for (int row = 0; row < keepRows; ++row) {
+        for (int column = 0; column < keepColumns; ++column) {
+            QImage tile = oldTiles.at(row * oldColumns + column);
+            const QRect area = tileRect(column, row);
+            if (!tile.isNull() && tile.size() != area.size()) {
+                // 原来的边缘块不满一块，按新的范围重新分配，多出的部分透明
+                QImage grown(area.size(), m_format);
+                grown.fill(0);
+                const QRect kept = QRect(QPoint(0, 0), tile.size()).intersected(QRect(QPoint(0, 0), area.size()));
+                for (int y = 0; y < kept.height(); ++y) {
+                    std::memcpy(grown.scanLine(y), tile.constScanLine(y), size_t(kept.width()) * 4);
+                }
+                copied += qint64(kept.width()) * kept.height() * 4;
+                tile = grown;
+            }
+            m_tiles[row * columns() + column] = tile;
+        }
+    }
+    CaptureFrame::noteCopy(copied);
+
+    // 画布缩小后来源帧可能超出范围，只保留仍在范围内的
+    if (size.width() < oldSize.width() || size.height() < oldSize.height()) {
+        for (int i = m_sources.size() - 1; i >= 0; --i) {
+            if (!rect().contains(m_sources.at(i).rect)) {
+                m_sources.remove(i);
+            }
+        }
+    }
+}
+
+QImage TiledImage::copy(const QRect &area) const
+{
+    if (isNull() || area.isEmpty()) {
+        return QImage();
+    }
+    QImage result(area.size(), m_format);
+    if (!rect().contains(area)) {
+        result.fill(0);
+    }
+
+    for (const Span &span : spans(area)) {
+        const size_t bytes = size_t(span.rect.width()) * 4;
+        for (int y = span.rect.top(); y <= span.rect.bottom(); ++y) {
+            uchar *out = result.scanLine(y - area.top()) + (span.rect.left() - area.left()) * 4;
+            if (span.tile) {
+                std::memcpy(out, span.scanLine(y), bytes);
+            } else {
+                std::memset(out, 0, bytes);
+            }
+        }
+    }
+    CaptureFrame::noteCopy(result.sizeInBytes());
+    return result;
+}
+
+QImage TiledImage::view(const QRect &area) const
+{
+    // 后放入的帧覆盖先放入的，只有区域不与更晚的帧相交时才能直接引用
+    for (int i = m_sources.size() - 1; i >= 0; --i) {
+        const Source &source = m_sources.at(i);
+        if (source.rect.contains(area)) {
+            return CaptureFrame::view(source.image, area.translated(-source.rect.topLeft()));
+        }
+        if (source.rect.intersects(area)) {
+            break;
+        }
+    }
+    return copy(area);
+}
+
+QRgb TiledImage::pixel(const QPoint &point) const
+{
+    if (!rect().contains(point)) {
+        return 0;
+    }
+    const QImage *tile = tileAt(point.x() / TileSize, point.y() / TileSize);
+    if (!tile) {
+        return 0;
+    }
+    return reinterpret_cast<const QRgb *>(tile->constScanLine(point.y() % TileSize))[point.x() % TileSize];
+}
+
+void TiledImage::draw(QPainter &painter, const QRect &area, const QColor &background) const
+{
+    for (const Span &span : spans(area)) {
+        if (span.tile) {
+            painter.drawImage(span.rect.topLeft(), *span.tile, span.sourceRect());
+        } else {
+            painter.fillRect(span.rect, background);
+        }
+    }
+}
+
+void TiledImage::draw(QPainter &painter, const QRect &area, const QTransform &toImage, const QColor &background) const
+{
+    if (toImage.isIdentity()) {
+        draw(painter, area, background);
+        return;
+    }
+    painter.save();
+    painter.setTransform(toImage.inverted(), true);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    draw(painter, toImage.mapRect(area), background);
+    painter.restore();
+}
+
+int TiledImage::allocatedTiles() const
+{
+    int count = 0;
+    for (const QImage &tile : m_tiles) {
+        count += tile.isNull() ? 0 : 1;
+    }
+    return count;
+}
+
+qint64 TiledImage::allocatedBytes() const
+{
+    qint64 bytes = 0;
+    for (const QImage &tile : m_tiles) {
+        bytes += qint64(tile.width()) * tile.height() * (tile.depth() / 8);
+    }
+    return bytes;
+}
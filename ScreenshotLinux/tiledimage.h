@@ -0,0 +1,131 @@
+#ifndef TILEDIMAGE_H
+#define TILEDIMAGE_H
+
+#include <QColor>
+#include <QImage>
+#include <QPainter>
+#include <QPoint>
+#include <QRect>
+#include <QSize>
+#include <QTransform>
+#include <QVector>
+
+// 分块保存的截图：按256×256切块，只分配被屏幕覆盖到的块，
+// 多屏布局外接矩形中没有屏幕的部分不占内存
+// 每块是一个QImage，复制TiledImage只增加引用计数，写入时只复制被改动的块（写时复制）
+// 所有块使用同一种32位格式；读取通过spans()按块迭代，不需要拼成一整张图
+// 被一帧完整覆盖的块只是该帧的视图（见CaptureFrame），只有跨屏和边缘的块才复制像素
+class TiledImage
+{
+public:
+    enum { TileSize = 256 };
+
+    // 迭代得到的一段：rect是请求区域落在这一块内的部分（画布坐标）
+    // tile为空表示这一块没有分配，按透明像素处理
+    struct Span {
+        QRect rect;
+        const QImage *tile;
+        QPoint tileOrigin; // 这一块左上角的画布坐标
+
+        QRect sourceRect() const { return rect.translated(-tileOrigin); }
+        // 画布第y行从rect.left()开始的像素，tile为空时返回nullptr
+        const QRgb *scanLine(int y) const
+        {
+            return tile ? reinterpret_cast<const QRgb *>(tile->constScanLine(y - tileOrigin.y()))
+                              + (rect.left() - tileOrigin.x())
+                        : nullptr;
+        }
+    };
+
+    // 按行优先顺序遍历与区域相交的块
+    class SpanIterator
+    {
+    public:
+        SpanIterator(const TiledImage *image, const QRect &area, int column, int row);
+        Span operator*() const;
+        SpanIterator &operator++();
+        bool operator!=(const SpanIterator &other) const { return m_column != other.m_column || m_row != other.m_row; }
+
+    private:
+        const TiledImage *m_image;
+        QRect m_area;
+        int m_firstColumn;
+        int m_lastColumn;
+        int m_column;
+        int m_row;
+    };
+
+    class SpanRange
+    {
+    public:
+        SpanRange(const TiledImage *image, const QRect &area);
+        SpanIterator begin() const;
+        SpanIterator end() const;
+
+    private:
+        const TiledImage *m_image;
+        QRect m_area;
+    };
+
+    TiledImage() = default;
+    explicit TiledImage(const QSize &size, QImage::Format format = QImage::Format_ARGB32_Premultiplied);
+
+    // 整张图放入块中，32位格式不复制像素，其他格式先转换
+    static TiledImage fromImage(const QImage &image);
+
+    bool isNull() const { return m_size.isEmpty(); }
+    QSize size() const { return m_size; }
+    int width() const { return m_size.width(); }
+    int height() const { return m_size.height(); }
+    QRect rect() const { return QRect(QPoint(0, 0), m_size); }
+    QImage::Format format() const { return m_format; }
+
+    // 把image放到position处，完整覆盖的块直接引用image，其余的块按需分配并复制
+    void paste(const QPoint &position, const QImage &image);
+
+    // 改变画布大小，保留已有的块；新增部分未分配（透明），只有原来不满一块的边缘块需要复制
+    // 长截图按整块的倍数逐步增高画布，已有的块不移动也不复制
+    void resize(const QSize &size);
+    // 不再需要view()直接引用整帧时调用：只被来源列表引用的帧随之释放，已有的块不受影响
+    void releaseSources() { m_sources.clear(); }
+
+    // 取出一块区域，超出范围和未分配的部分为透明
+    QImage copy(const QRect &rect) const;
+    // 区域完整落在某一帧内时返回该帧的视图，否则同copy()
+    QImage view(const QRect &rect) const;
+    QImage toImage() const { return copy(rect()); }
+
+    // 未分配的块返回0（透明黑）
+    QRgb pixel(const QPoint &point) const;
+
+    SpanRange spans(const QRect &area) const { return SpanRange(this, area); }
+
+    // 把area内的块按画布坐标画到painter上，未分配的块填background
+    void draw(QPainter &painter, const QRect &area, const QColor &background = Qt::black) const;
+    // 块是设备像素、area是画布坐标时：toImage把画布坐标换算到块的像素，按块的像素绘制后缩放回画布；
+    // 缩放比例等于窗口的设备像素比时最终是一一对应的拷贝
+    void draw(QPainter &painter, const QRect &area, const QTransform &toImage, const QColor &background = Qt::black) const;
+
+    int allocatedTiles() const;
+    qint64 allocatedBytes() const; // 块覆盖的像素字节数，视图也计入
+
+private:
+    int columns() const { return (m_size.width() + TileSize - 1) / TileSize; }
+    int rows() const { return (m_size.height() + TileSize - 1) / TileSize; }
+    QRect tileRect(int column, int row) const;
+    const QImage *tileAt(int column, int row) const;
+    QImage &tileForWrite(int column, int row, const QRect &coverage);
+
+    QSize m_size;
+    QImage::Format m_format = QImage::Format_Invalid;
+    QVector<QImage> m_tiles; // 行优先，未分配的块为空QImage
+
+    // paste()放入的帧及其位置，导出时用来直接取视图
+    struct Source {
+        QRect rect;
+        QImage image;
+    };
+    QVector<Source> m_sources;
+};
+
+#endif // TILEDIMAGE_H
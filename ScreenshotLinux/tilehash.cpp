@@ -0,0 +1,59 @@
+#include "tilehash.h"
+#include "fasthash.h"
+#include "tiledimage.h"
+
+TileHashes TileHashes::compute(const QImage &frame)
+{
+    TileHashes result;
+    if (frame.isNull()) {
+        return result;
+    }
+    // 截图后端给出的都是24/32位格式；每像素不足一字节的格式无法按字节切块，先转换
+    const QImage image = frame.depth() < 8 ? frame.convertToFormat(QImage::Format_ARGB32) : frame;
+    result.m_size = image.size();
+    result.m_format = image.format();
+    result.m_hashes.resize(result.columns() * result.rows());
+
+    // 直接读取帧的扫描行，不转换格式；每行的哈希作为下一行的种子，串成整块的哈希
+    const int bytesPerPixel = image.depth() / 8;
+    for (int index = 0; index < result.m_hashes.size(); ++index) {
+        const QRect tile = result.tileRect(index);
+        const size_t rowBytes = size_t(tile.width()) * bytesPerPixel;
+        quint64 hash = 0;
+        for (int y = tile.top(); y <= tile.bottom(); ++y) {
+            hash = FastHash::hash64(image.constScanLine(y) + tile.left() * bytesPerPixel, rowBytes, hash);
+        }
+        result.m_hashes[index] = hash;
+    }
+    return result;
+}
+
+int TileHashes::columns() const
+{
+    return (m_size.width() + TiledImage::TileSize - 1) / TiledImage::TileSize;
+}
+
+int TileHashes::rows() const
+{
+    return (m_size.height() + TiledImage::TileSize - 1) / TiledImage::TileSize;
+}
+
+QRect TileHashes::tileRect(int index) const
+{
+    const int column = index % qMax(1, columns());
+    const int row = index / qMax(1, columns());
+    return QRect(column * TiledImage::TileSize, row * TiledImage::TileSize,
+                 TiledImage::TileSize, TiledImage::TileSize).intersected(QRect(QPoint(0, 0), m_size));
+}
+
+QVector<int> TileHashes::changedTiles(const TileHashes &previous) const
+{
+    QVector<int> changed;
+    const bool comparable = previous.m_size == m_size && previous.m_format == m_format;
+    for (int index = 0; index < m_hashes.size(); ++index) {
+        if (!comparable || previous.m_hashes.at(index) != m_hashes.at(index)) {
+            changed.append(index);
+        }
+    }
+    return changed;
+}
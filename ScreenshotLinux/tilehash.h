@@ -0,0 +1,35 @@
+#ifndef TILEHASH_H
+#define TILEHASH_H
+
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+
+// 一帧按TiledImage的256×256网格分块后各块像素的64位哈希（FastHash）
+// 只保存哈希、不保留像素，比较前后两帧得到内容变化的块；
+// 定时截图用它跳过没有变化的帧、只保存变化的块
+class TileHashes
+{
+public:
+    TileHashes() = default;
+
+    static TileHashes compute(const QImage &image);
+
+    bool isNull() const { return m_size.isEmpty(); }
+    QSize imageSize() const { return m_size; }
+    int columns() const;
+    int rows() const;
+    int tileCount() const { return m_hashes.size(); }
+    QRect tileRect(int index) const; // 行优先编号的块在图像中的范围，边缘块较小
+
+    // 与previous相比内容变化的块编号；尺寸或格式不同时所有块都算变化
+    QVector<int> changedTiles(const TileHashes &previous) const;
+
+private:
+    QSize m_size;
+    QImage::Format m_format = QImage::Format_Invalid;
+    QVector<quint64> m_hashes; // 行优先
+};
+
+#endif // TILEHASH_H
@@ -0,0 +1,140 @@
+#include "trace.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <mutex>
+#include <vector>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace Trace {
+
+std::atomic<bool> g_enabled{false};
+
+namespace {
+
+struct Event {
+    const char *name;
+    char phase;        // 'X' 完整区间，'i' 瞬时事件，'b'/'e' 异步区间
+    int64_t timestampUs;
+    int64_t durationUs;
+    uint64_t id;
+    int threadId;
+    QString detail;
+};
+
+// 最多保留这么多事件，超过后覆盖最旧的：常驻的托盘进程打开追踪后每次绘制、录制的每一帧都会记录，
+// 内存和每次会话结束时写出的文件大小都不随运行时间增长
+const size_t kMaxEvents = 65536;
+
+std::mutex g_mutex;
+std::vector<Event> g_events;
+size_t g_oldest = 0; // 缓冲区满后最旧的事件所在位置，也是下一个要覆盖的位置
+
+int currentThreadId()
+{
+    thread_local const int tid = int(::syscall(SYS_gettid));
+    return tid;
+}
+
+void append(Event event)
+{
+    event.threadId = currentThreadId();
+    std::lock_guard<std::mutex> lock(g_mutex);
+    if (g_events.size() < kMaxEvents) {
+        g_events.push_back(std::move(event));
+    } else {
+        g_events[g_oldest] = std::move(event);
+        g_oldest = (g_oldest + 1) % kMaxEvents;
+    }
+}
+
+} // namespace
+
+void setEnabled(bool enabled)
+{
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+int64_t nowUs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void addComplete(const char *name, int64_t startUs, int64_t durationUs, const QString &detail)
+{
+    append(Event{ name, 'X', startUs, durationUs, 0, 0, detail });
+}
+
+void addInstant(const char *name, const QString &detail)
+{
+    append(Event{ name, 'i', nowUs(), 0, 0, 0, detail });
+}
+
+void beginAsync(const char *name, uint64_t id)
+{
+    append(Event{ name, 'b', nowUs(), 0, id, 0, QString() });
+}
+
+void endAsync(const char *name, uint64_t id)
+{
+    append(Event{ name, 'e', nowUs(), 0, id, 0, QString() });
+}
+
+bool writeChromeTrace(const QString &filePath)
+{
+    std::vector<Event> events;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        events.reserve(g_events.size());
+        events.insert(events.end(), g_events.begin() + ptrdiff_t(g_oldest), g_events.end());
+        events.insert(events.end(), g_events.begin(), g_events.begin() + ptrdiff_t(g_oldest));
+    }
+
+    const qint64 pid = ::getpid();
+    QJsonArray traceEvents;
+    for (const Event &event : events) {
+        QJsonObject object;
+        const QString name = QString::fromLatin1(event.name);
+        object["name"] = name;
+        // 名称中第一个点之前的部分作为分类，例如 capture.grim -> capture
+        object["cat"] = name.section('.', 0, 0);
+        object["ph"] = QString(QChar::fromLatin1(event.phase));
+        object["ts"] = double(event.timestampUs);
+        object["pid"] = pid;
+        object["tid"] = event.threadId;
+        if (event.phase == 'X') {
+            object["dur"] = double(event.durationUs);
+        } else if (event.phase == 'i') {
+            object["s"] = "t";
+        } else {
+            object["id"] = QString::number(event.id);
+        }
+        if (!event.detail.isEmpty()) {
+            object["args"] = QJsonObject{ { "detail", event.detail } };
+        }
+        traceEvents.append(object);
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    QJsonObject root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+    return file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) > 0;
+}
+
+void clear()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_events.clear();
+    g_oldest = 0;
+}
+
+} // namespace Trace
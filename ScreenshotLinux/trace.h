@@ -0,0 +1,81 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <atomic>
+#include <cstdint>
+
+// 端到端延迟追踪，导出为Chrome Trace Event JSON（chrome://tracing 或 Perfetto 打开）
+// 关闭时每个追踪点只有一次relaxed原子读取
+namespace Trace {
+
+extern std::atomic<bool> g_enabled;
+
+inline bool isEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void setEnabled(bool enabled);
+
+int64_t nowUs(); // CLOCK_MONOTONIC，微秒
+
+// 以下函数只应在isEnabled()为真时调用，name必须是静态字符串
+void addComplete(const char *name, int64_t startUs, int64_t durationUs, const QString &detail = QString());
+void addInstant(const char *name, const QString &detail = QString());
+// 跨事件循环的异步区间，例如从托盘点击到首帧绘制
+void beginAsync(const char *name, uint64_t id);
+void endAsync(const char *name, uint64_t id);
+
+bool writeChromeTrace(const QString &filePath); // 写出已记录的事件，只保留最近的65536个
+void clear();
+
+// 作用域内的同步区间
+class Scope
+{
+public:
+    explicit Scope(const char *name)
+        : m_name(isEnabled() ? name : nullptr)
+        , m_startUs(m_name ? nowUs() : 0)
+    {
+    }
+
+    // detail是生成说明文字的可调用对象，只有追踪打开时才调用，关闭时不构造任何字符串
+    template <typename MakeDetail>
+    Scope(const char *name, MakeDetail makeDetail)
+        : m_name(isEnabled() ? name : nullptr)
+        , m_startUs(m_name ? nowUs() : 0)
+    {
+        if (m_name) {
+            m_detail = makeDetail();
+        }
+    }
+
+    ~Scope()
+    {
+        if (m_name) {
+            addComplete(m_name, m_startUs, nowUs() - m_startUs, m_detail);
+        }
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+private:
+    const char *m_name;
+    int64_t m_startUs;
+    QString m_detail;
+};
+
+} // namespace Trace
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// TRACE_SCOPE(name) 或 TRACE_SCOPE(name, detail)：detail表达式包在lambda里，追踪关闭时不求值
+#define TRACE_SCOPE_NAME(name) Trace::Scope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_SCOPE_DETAIL(name, detail) \
+    Trace::Scope TRACE_CONCAT(traceScope_, __LINE__)(name, [&]() { return QString(detail); })
+#define TRACE_SCOPE_SELECT(_1, _2, macro, ...) macro
+#define TRACE_SCOPE(...) TRACE_SCOPE_SELECT(__VA_ARGS__, TRACE_SCOPE_DETAIL, TRACE_SCOPE_NAME, )(__VA_ARGS__)
+
+#endif // TRACE_H
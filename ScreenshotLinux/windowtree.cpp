@@ -0,0 +1,186 @@
+#include "windowtree.h"
+#include "screencapture.h"
+#include "logging.h"
+#include "trace.h"
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+
+#ifdef SCREENSHOT_HAVE_XCB
+#include <xcb/xcb.h>
+#endif
+
+namespace WindowTree {
+
+QVector<QRect> queryStackedWindows(const QVector<quint32> &excludeWindows)
+{
+    QVector<QRect> result;
+#ifdef SCREENSHOT_HAVE_XCB
+    if (ScreenCapture::sessionIsWayland()) {
+        return result;
+    }
+    TRACE_SCOPE("capture.windowTree");
+
+    // 独立连接，不与Qt的XCB连接共享事件队列，可以在任意线程使用
+    int screenNumber = 0;
+    xcb_connection_t *connection = xcb_connect(nullptr, &screenNumber);
+    if (xcb_connection_has_error(connection)) {
+        xcb_disconnect(connection);
+        return result;
+    }
+
+    xcb_screen_iterator_t screens = xcb_setup_roots_iterator(xcb_get_setup(connection));
+    for (int i = 0; i < screenNumber && screens.rem > 0; ++i) {
+        xcb_screen_next(&screens);
+    }
+    const xcb_window_t root = screens.data->root;
+
+    xcb_query_tree_reply_t *tree = xcb_query_tree_reply(connection, xcb_query_tree(connection, root), nullptr);
+
+    // 重新父化的窗口管理器把遮罩窗口包在自己的框架窗口里，根窗口的子窗口是框架而不是遮罩本身；
+    // 沿父窗口逐层向上，排除根窗口下的那一层。同一层的请求一起发出，每层一次往返
+    QVector<quint32> excluded;
+    std::vector<xcb_window_t> pending(excludeWindows.begin(), excludeWindows.end());
+    while (!pending.empty()) {
+        std::vector<xcb_query_tree_cookie_t> parentCookies;
+        parentCookies.reserve(pending.size());
+        for (xcb_window_t window : pending) {
+            parentCookies.push_back(xcb_query_tree(connection, window));
+        }
+        std::vector<xcb_window_t> parents;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            xcb_query_tree_reply_t *reply = xcb_query_tree_reply(connection, parentCookies[i], nullptr);
+            if (!reply) {
+                continue;
+            }
+            if (reply->parent == root || reply->parent == XCB_WINDOW_NONE) {
+                excluded.append(pending[i]);
+            } else {
+                parents.push_back(reply->parent);
+            }
+            std::free(reply);
+        }
+        pending.swap(parents);
+    }
+
+    if (tree) {
+        const int count = xcb_query_tree_children_length(tree);
+        const xcb_window_t *children = xcb_query_tree_children(tree);
+
+        // 先发出全部请求再逐个取回复，整个查询只有一次往返延迟
+        std::vector<xcb_get_window_attributes_cookie_t> attributeCookies(size_t(count));
+        std::vector<xcb_get_geometry_cookie_t> geometryCookies(size_t(count));
+        for (int i = 0; i < count; ++i) {
+            attributeCookies[size_t(i)] = xcb_get_window_attributes(connection, children[i]);
+            geometryCookies[size_t(i)] = xcb_get_geometry(connection, children[i]);
+        }
+
+        // query_tree按从下到上的堆叠顺序返回子窗口，倒序得到从上到下
+        for (int i = count - 1; i >= 0; --i) {
+            xcb_get_window_attributes_reply_t *attributes =
+                xcb_get_window_attributes_reply(connection, attributeCookies[size_t(i)], nullptr);
+            xcb_get_geometry_reply_t *geometry =
+                xcb_get_geometry_reply(connection, geometryCookies[size_t(i)], nullptr);
+            if (attributes && geometry && !excluded.contains(children[i]) &&
+                attributes->map_state == XCB_MAP_STATE_VIEWABLE &&
+                attributes->_class == XCB_WINDOW_CLASS_INPUT_OUTPUT) {
+                const int border = geometry->border_width;
+                const QRect rect(geometry->x, geometry->y,
+                                 geometry->width + 2 * border, geometry->height + 2 * border);
+                if (!rect.isEmpty()) {
+                    result.append(rect);
+                }
+            }
+            std::free(attributes);
+            std::free(geometry);
+        }
+        std::free(tree);
+    }
+    xcb_disconnect(connection);
+    qCDebug(lcCapture) << "窗口树快照:" << result.size() << "个可见顶层窗口";
+#else
+    Q_UNUSED(excludeWindows);
+#endif
+    return result;
+}
+
+} // namespace WindowTree
+
+WindowLookup::WindowLookup(const QVector<QRect> &stackedTopFirst)
+    : m_windows(stackedTopFirst)
+{
+    if (m_windows.isEmpty()) {
+        return;
+    }
+
+    // 所有窗口的左边和右边+1，相邻两个之间的竖条内覆盖情况不变
+    std::vector<int> edges;
+    edges.reserve(size_t(m_windows.size()) * 2);
+    for (const QRect &window : m_windows) {
+        edges.push_back(window.left());
+        edges.push_back(window.right() + 1);
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    m_slabs.reserve(int(edges.size()));
+    for (size_t e = 0; e + 1 < edges.size(); ++e) {
+        Slab slab;
+        slab.left = edges[e];
+
+        // 从上到下加入覆盖该竖条的窗口，只保留还没被上层窗口遮住的部分
+        for (int w = 0; w < m_windows.size(); ++w) {
+            const QRect &window = m_windows.at(w);
+            if (window.left() > slab.left || window.right() < slab.left) {
+                continue;
+            }
+            int top = window.top();
+            const int bottom = window.bottom();
+            QVector<Interval> added;
+            for (const Interval &covered : slab.intervals) {
+                if (covered.bottom < top) {
+                    continue;
+                }
+                if (covered.top > bottom) {
+                    break;
+                }
+                if (covered.top > top) {
+                    added.append({ top, covered.top - 1, w });
+                }
+                top = qMax(top, covered.bottom + 1);
+                if (top > bottom) {
+                    break;
+                }
+            }
+            if (top <= bottom) {
+                added.append({ top, bottom, w });
+            }
+            if (!added.isEmpty()) {
+                slab.intervals += added;
+                std::sort(slab.intervals.begin(), slab.intervals.end(),
+                          [](const Interval &a, const Interval &b) { return a.top < b.top; });
+            }
+        }
+        m_slabs.append(slab);
+    }
+    // 最右边的哨兵竖条，不属于任何窗口
+    m_slabs.append(Slab{ edges.back(), {} });
+}
+
+QRect WindowLookup::windowAt(const QPoint &point) const
+{
+    auto slab = std::upper_bound(m_slabs.begin(), m_slabs.end(), point.x(),
+                                 [](int x, const Slab &s) { return x < s.left; });
+    if (slab == m_slabs.begin()) {
+        return QRect();
+    }
+    --slab;
+
+    auto interval = std::upper_bound(slab->intervals.begin(), slab->intervals.end(), point.y(),
+                                     [](int y, const Interval &i) { return y < i.top; });
+    if (interval == slab->intervals.begin()) {
+        return QRect();
+    }
+    --interval;
+    return point.y() <= interval->bottom ? m_windows.at(interval->window) : QRect();
+}
@@ -0,0 +1,48 @@
+#ifndef WINDOWTREE_H
+#define WINDOWTREE_H
+
+#include <QRect>
+#include <QVector>
+
+// 顶层窗口几何信息的快照，与截图一起保存，用于选区吸附到窗口
+namespace WindowTree {
+
+// 查询X11顶层窗口（根窗口的可见子窗口）的外框，按堆叠顺序从上到下排列，坐标为虚拟桌面坐标
+// 使用独立的XCB连接，所有请求一次发出后再收回复，可在后台线程调用；
+// 没有XCB支持、Wayland会话或连接失败时返回空列表。excludeWindows为遮罩窗口自身，
+// 被窗口管理器放进框架窗口时排除的是框架
+QVector<QRect> queryStackedWindows(const QVector<quint32> &excludeWindows = {});
+
+} // namespace WindowTree
+
+// 堆叠窗口的可见部分分解：按所有窗口的左右边把桌面切成竖条，
+// 每个竖条内记录从上到下互不重叠的区间及覆盖它的最上层窗口，
+// 查询时两次二分查找，O(log n)
+class WindowLookup
+{
+public:
+    WindowLookup() = default;
+    explicit WindowLookup(const QVector<QRect> &stackedTopFirst);
+
+    bool isEmpty() const { return m_windows.isEmpty(); }
+    const QVector<QRect> &windows() const { return m_windows; }
+
+    // 点所在位置可见的最上层窗口，没有则返回无效矩形
+    QRect windowAt(const QPoint &point) const;
+
+private:
+    struct Interval {
+        int top;     // 包含
+        int bottom;  // 包含
+        int window;  // m_windows 下标
+    };
+    struct Slab {
+        int left;    // 包含，右边界是下一个竖条的left
+        QVector<Interval> intervals; // 按top排序
+    };
+
+    QVector<QRect> m_windows;
+    QVector<Slab> m_slabs;  // 按left排序，最后一个竖条之后不属于任何窗口
+};
+
+#endif // WINDOWTREE_H